@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include "../uEmbedded/uassert.h"
 
@@ -28,16 +29,40 @@ namespace upp { namespace impl {
 //!             iterator)
 //! @{
 
+//! @brief      Layout policy of free space list.
+//! @tparam     interleaved__
+//!              If true, each node is stored next to its value (AoS), so
+//!             iteration touches single memory stream. Otherwise nodes and
+//!             values are kept in separate arrays, which packs nodes densely.
+//! @tparam     bidirectional__
+//!              If false, nodes have no back link. Saves one index per node,
+//!             but operations which need a predecessor walk from the head.
+template <bool interleaved__, bool bidirectional__>
+struct fslist_layout
+{
+    enum
+    {
+        interleaved   = interleaved__,
+        bidirectional = bidirectional__
+    };
+};
+
+using fslist_layout_split               = fslist_layout<false, true>;
+using fslist_layout_interleaved         = fslist_layout<true, true>;
+using fslist_layout_forward             = fslist_layout<false, false>;
+using fslist_layout_forward_interleaved = fslist_layout<true, false>;
+
 //! @brief      This class represents a node in a free space list.
 //! @tparam     nty_
 //!              The free space list accepts the node index type as a
 //!             template argument. If you don't use that many nodes, you can
 //!             save memory by reducing the space taken up by one node.
+//! @tparam     bidir__ Whether the node keeps back link.
 //! @note
 //!             Unlike the C language version of the library, the C ++ version
 //!             does not  use this node class directly. If you need to access an
 //!             element of a list, use an iterator instead.
-template <typename nty_>
+template <typename nty_, bool bidir__ = true>
 struct fslist_node
 {
     enum
@@ -49,21 +74,27 @@ struct fslist_node
 
     nty_ cur() { return cur_; }
 
-    fslist_node<nty_>& prev() { return by_( prv_ ); }
-    fslist_node<nty_>& next() { return by_( nxt_ ); }
-
 private:
-    //! \brief
-    //!         Calculate distance from given argument using offset
-    fslist_node<nty_>& by_( int absolute )
+    nty_ cur_;
+    template <typename t_, bool b_, size_t s_>
+    friend class fslist_alloc_base;
+};
+
+//! @brief      Forward-only node without back link.
+template <typename nty_>
+struct fslist_node<nty_, false>
+{
+    enum
     {
-        uassert( absolute != NODE_NONE );
-        uassert( cur_ != NODE_NONE );
-        return *( this - cur_ + absolute );
-    }
+        NODE_NONE = (nty_)-1
+    };
+    nty_ nxt_;
+
+    nty_ cur() { return cur_; }
 
+private:
     nty_ cur_;
-    template <typename t_>
+    template <typename t_, bool b_, size_t s_>
     friend class fslist_alloc_base;
 };
 
@@ -79,6 +110,10 @@ private:
 //!             compatible with STL containers and can be called externally
 //!             through class instances.
 //! @tparam     nty_ \ref upp::impl::fslist_node
+//! @tparam     bidir__ Whether nodes keep back link.
+//! @tparam     stride__
+//!              Distance between adjacent nodes in bytes. Larger than node
+//!             size when nodes are interleaved with values.
 //!
 //! @todo       Provide functionality for dynamic capacity features.
 //!              Due to the nature of the free space list, it is difficult to
@@ -86,13 +121,17 @@ private:
 //!             extend are implemented by connecting the active node to the new
 //!             node buffer from the front.
 //! @todo       Implement heap based fslist
-template <typename nty_>
+template <
+  typename nty_,
+  bool   bidir__  = true,
+  size_t stride__ = sizeof( fslist_node<nty_, bidir__> )>
 class fslist_alloc_base
 {
 protected:
     using size_type       = nty_;
     using difference_type = ptrdiff_t;
-    using node_type       = fslist_node<size_type>;
+    using node_type       = fslist_node<size_type, bidir__>;
+    using bidir_tag       = std::integral_constant<bool, bidir__>;
     enum
     {
         NODE_NONE = (size_type)-1
@@ -100,7 +139,7 @@ protected:
 
     //! @brief      Constructor of node management class
     //! @param      capacity Given node array's capacity.
-    //! @param      narray Provided node array
+    //! @param      narray Provided node array. Nodes are stride__ bytes apart.
     fslist_alloc_base( size_type capacity, node_type* narray ) noexcept
         : size_( 0 )
         , capacity_( capacity )
@@ -108,17 +147,36 @@ protected:
         , tail_( NODE_NONE )
         , idle_front_( 0 )
         , idle_back_( capacity - 1 )
-        , narray_( narray )
+        , nbase_( reinterpret_cast<char*>( narray ) )
     {
         // Link all available nodes
         for ( size_t i = 0; i < capacity; i++ ) {
-            auto p  = narray_ + i;
-            p->nxt_ = static_cast<size_type>( i + 1 );
-            p->cur_ = NODE_NONE;
-            p->prv_ = static_cast<size_type>( i - 1 );
+            auto& n = node( static_cast<size_type>( i ) );
+            n.nxt_  = static_cast<size_type>( i + 1 );
+            n.cur_  = NODE_NONE;
+            set_prev( n, static_cast<size_type>( i - 1 ) );
         }
-        narray_[0].prv_             = NODE_NONE;
-        narray_[capacity_ - 1].nxt_ = NODE_NONE;
+        set_prev( node( 0 ), NODE_NONE );
+        node( capacity_ - 1 ).nxt_ = NODE_NONE;
+    }
+
+    //! @brief      Access node by index.
+    node_type& node( size_type i ) const noexcept
+    {
+        return *reinterpret_cast<node_type*>( nbase_ + (size_t)i * stride__ );
+    }
+
+    //! @brief      Get previous node of active node. Walks from the head if
+    //!             nodes have no back link.
+    size_type get_prev( size_type i ) const noexcept
+    {
+        return get_prev( i, bidir_tag() );
+    }
+
+    //! @brief      Set back link. No-op if nodes have no back link.
+    static void set_prev( node_type& n, size_type v ) noexcept
+    {
+        set_prev( n, v, bidir_tag() );
     }
 
     //! @brief      Insert new node at given location
@@ -126,7 +184,7 @@ protected:
     //! @param      at
     void insert_node( size_type i, size_type at ) noexcept
     {
-        node_type& n = narray_[i];
+        node_type& n = node( i );
         if ( at == NODE_NONE ) { // Insert at last
             push_back_node( i );
         }
@@ -134,43 +192,62 @@ protected:
             push_front_node( i );
         }
         else {
-            node_type& m = narray_[at];
+            node_type& m   = node( at );
+            size_type  prv = get_prev( at );
             uassert( n.cur_ != NODE_NONE );
             uassert( m.cur_ != NODE_NONE );
-            uassert( m.prv_ != NODE_NONE );
+            uassert( prv != NODE_NONE );
 
-            m.prev().nxt_ = i;
-            n.prv_        = m.prv_;
-            m.prv_        = i;
-            n.nxt_        = at;
+            node( prv ).nxt_ = i;
+            set_prev( n, prv );
+            set_prev( m, i );
+            n.nxt_ = at;
         }
     }
 
+    //! @brief      Insert new node next to given node. O(1) regardless of
+    //!             back link.
+    void insert_node_after( size_type i, size_type at ) noexcept
+    {
+        node_type& n = node( i );
+        node_type& m = node( at );
+        uassert( n.cur_ != NODE_NONE );
+        uassert( m.cur_ != NODE_NONE );
+
+        n.nxt_ = m.nxt_;
+        set_prev( n, at );
+        if ( m.nxt_ != NODE_NONE )
+            set_prev( node( m.nxt_ ), i );
+        else
+            tail_ = i;
+        m.nxt_ = i;
+    }
+
     //! @brief      Append new node to backward
     void push_back_node( size_type i ) noexcept
     {
-        node_type& n = narray_[i];
+        node_type& n = node( i );
         uassert( n.cur_ != NODE_NONE );
 
         if ( tail_ != NODE_NONE )
-            narray_[tail_].nxt_ = i;
+            node( tail_ ).nxt_ = i;
         else {
             uassert( head_ == NODE_NONE );
             head_ = i;
         }
 
-        n.prv_ = tail_;
-        tail_  = i;
+        set_prev( n, tail_ );
+        tail_ = i;
     }
 
     //! @brief      Insert front-most node
     void push_front_node( size_type i ) noexcept
     {
-        node_type& n = narray_[i];
+        node_type& n = node( i );
         uassert( n.cur_ != NODE_NONE );
 
         if ( head_ != NODE_NONE )
-            narray_[head_].prv_ = i;
+            set_prev( node( head_ ), i );
         else {
             uassert( tail_ == NODE_NONE );
             tail_ = i;
@@ -187,15 +264,15 @@ protected:
     size_type alloc_node() noexcept
     {
         uassert( size_ < capacity_ );
-        auto& n     = narray_[idle_front_];
+        auto& n     = node( idle_front_ );
         n.cur_      = idle_front_;
         idle_front_ = n.nxt_;
         if ( idle_front_ == NODE_NONE )
             idle_back_ = NODE_NONE;
         else
-            narray_[idle_front_].prv_ = NODE_NONE;
+            set_prev( node( idle_front_ ), NODE_NONE );
         n.nxt_ = NODE_NONE;
-        n.prv_ = NODE_NONE;
+        set_prev( n, NODE_NONE );
         ++size_;
         return n.cur_;
     }
@@ -204,50 +281,122 @@ protected:
     //! @param      i Node index to unlink
     void dealloc_node( size_type i ) noexcept
     {
-        auto& n = narray_[i];
+        dealloc_node( i, get_prev( i ) );
+    }
+
+    //! @brief      Unlink given node whose predecessor is known.
+    void dealloc_node( size_type i, size_type prv ) noexcept
+    {
+        auto& n = node( i );
         uassert( n.cur_ != NODE_NONE );
         uassert( i >= 0 && i < capacity_ );
 
         if ( n.nxt_ != NODE_NONE ) {
-            n.next().prv_ = n.prv_;
+            set_prev( node( n.nxt_ ), prv );
         }
         else { // It's tail
-            tail_ = n.prv_;
+            tail_ = prv;
         }
 
-        if ( n.prv_ != NODE_NONE ) {
-            n.prev().nxt_ = n.nxt_;
+        if ( prv != NODE_NONE ) {
+            node( prv ).nxt_ = n.nxt_;
         }
         else { // It's head
             head_ = n.nxt_;
         }
 
         if ( idle_back_ != NODE_NONE ) {
-            narray_[idle_back_].nxt_ = i;
+            node( idle_back_ ).nxt_ = i;
         }
         else {
             uassert( idle_front_ == NODE_NONE );
             idle_front_ = i;
         }
-        n.prv_     = idle_back_;
+        set_prev( n, idle_back_ );
         n.nxt_     = NODE_NONE;
         n.cur_     = NODE_NONE;
         idle_back_ = i;
         --size_;
     }
 
+    //! @brief      Detach chain [first, last] from active list. Both ends are
+    //!             inclusive.
+    void unlink_chain( size_type first, size_type last ) noexcept
+    {
+        size_type  prv = get_prev( first );
+        node_type& l   = node( last );
+
+        if ( prv != NODE_NONE )
+            node( prv ).nxt_ = l.nxt_;
+        else
+            head_ = l.nxt_;
+
+        if ( l.nxt_ != NODE_NONE )
+            set_prev( node( l.nxt_ ), prv );
+        else
+            tail_ = prv;
+    }
+
+    //! @brief      Attach chain [first, last] before given node. NODE_NONE
+    //!             appends at the back.
+    void link_chain( size_type first, size_type last, size_type at ) noexcept
+    {
+        size_type prv = at != NODE_NONE ? get_prev( at ) : tail_;
+
+        set_prev( node( first ), prv );
+        node( last ).nxt_ = at;
+
+        if ( prv != NODE_NONE )
+            node( prv ).nxt_ = first;
+        else
+            head_ = first;
+
+        if ( at != NODE_NONE )
+            set_prev( node( at ), last );
+        else
+            tail_ = last;
+    }
+
+    //! @brief      Unlink nodes in range [first, end) and put them back to
+    //!             memory pool at once.
+    //! @param      end Exclusive end of range. NODE_NONE for the tail.
+    void dealloc_range( size_type first, size_type end ) noexcept
+    {
+        if ( first == end )
+            return;
+
+        size_type last = end != NODE_NONE ? get_prev( end ) : tail_;
+        unlink_chain( first, last );
+
+        for ( size_type i = first;; i = node( i ).nxt_ ) {
+            uassert( node( i ).cur_ != NODE_NONE );
+            node( i ).cur_ = NODE_NONE;
+            --size_;
+            if ( i == last )
+                break;
+        }
+
+        if ( idle_back_ != NODE_NONE )
+            node( idle_back_ ).nxt_ = first;
+        else
+            idle_front_ = first;
+        set_prev( node( first ), idle_back_ );
+        node( last ).nxt_ = NODE_NONE;
+        idle_back_        = last;
+    }
+
     //! @brief      Get front node index
     size_type head() const noexcept { return head_; }
 
     //! @brief      Get last valid node index.
     size_type tail() const noexcept { return tail_; }
 
-    size_type next( size_type n ) const noexcept { return narray_[n].nxt_; }
-    size_type prev( size_type n ) const noexcept { return narray_[n].prv_; }
+    size_type next( size_type n ) const noexcept { return node( n ).nxt_; }
+    size_type prev( size_type n ) const noexcept { return get_prev( n ); }
 
     bool valid_node( size_type n ) const noexcept
     {
-        return n != NODE_NONE && narray_[n].cur_ != NODE_NONE;
+        return n != NODE_NONE && node( n ).cur_ != NODE_NONE;
     }
 
 public:
@@ -260,48 +409,75 @@ public:
     //! @brief      Check if list is empty
     bool empty() const noexcept { return size_ == 0; }
 
-    template <typename ty1_, typename ty_2>
+    template <typename ty1_, typename ty2_, typename ty3_>
     friend class fslist_const_iterator;
 
 private:
-    size_type  size_;
-    size_type  capacity_;
-    size_type  head_;
-    size_type  tail_;
-    size_type  idle_front_;
-    size_type  idle_back_;
-    node_type* narray_;
+    size_type get_prev( size_type i, std::true_type ) const noexcept
+    {
+        return node( i ).prv_;
+    }
+
+    size_type get_prev( size_type i, std::false_type ) const noexcept
+    {
+        size_type prv = NODE_NONE;
+        for ( size_type k = head_; k != i; prv = k, k = node( k ).nxt_ )
+            uassert( k != NODE_NONE );
+        return prv;
+    }
+
+    static void set_prev( node_type& n, size_type v, std::true_type ) noexcept
+    {
+        n.prv_ = v;
+    }
+
+    static void set_prev( node_type&, size_type, std::false_type ) noexcept { }
+
+private:
+    size_type size_;
+    size_type capacity_;
+    size_type head_;
+    size_type tail_;
+    size_type idle_front_;
+    size_type idle_back_;
+    char*     nbase_;
 };
 
+template <typename dty_, typename nty_, typename layout_>
+class fslist_base;
+
 //! @brief      list iterator definition
-template <typename dty_, typename nty_>
+template <typename dty_, typename nty_, typename layout_>
 class fslist_const_iterator
 {
 public:
-    using iterator_category = std::bidirectional_iterator_tag;
-    using value_type        = dty_;
-    using difference_type   = ptrdiff_t;
-    using pointer           = dty_ const*;
-    using reference         = dty_ const&;
-    using size_type         = nty_;
-    using container_type    = fslist_alloc_base<nty_>;
+    using iterator_category = typename std::conditional<
+      layout_::bidirectional,
+      std::bidirectional_iterator_tag,
+      std::forward_iterator_tag>::type;
+    using value_type      = dty_;
+    using difference_type = ptrdiff_t;
+    using pointer         = dty_ const*;
+    using reference       = dty_ const&;
+    using size_type       = nty_;
+    using container_type  = fslist_base<dty_, nty_, layout_>;
     enum
     {
         NODE_NONE = (size_type)-1
     };
 
-    fslist_const_iterator<dty_, nty_>& operator++() noexcept;
-    fslist_const_iterator<dty_, nty_>  operator++( int ) noexcept;
-    fslist_const_iterator<dty_, nty_>& operator--() noexcept;
-    fslist_const_iterator<dty_, nty_>  operator--( int ) noexcept;
-    reference                          operator*() const noexcept;
-    pointer                            operator->() const noexcept;
+    fslist_const_iterator& operator++() noexcept;
+    fslist_const_iterator  operator++( int ) noexcept;
+    fslist_const_iterator& operator--() noexcept;
+    fslist_const_iterator  operator--( int ) noexcept;
+    reference              operator*() const noexcept;
+    pointer                operator->() const noexcept;
 
-    bool operator!=( const fslist_const_iterator<dty_, nty_>& r ) const noexcept
+    bool operator!=( const fslist_const_iterator& r ) const noexcept
     {
         return r.container_ != container_ || r.cur_ != cur_;
     }
-    bool operator==( const fslist_const_iterator<dty_, nty_>& r ) const noexcept
+    bool operator==( const fslist_const_iterator& r ) const noexcept
     {
         return r.container_ == container_ && r.cur_ == cur_;
     }
@@ -316,39 +492,42 @@ private:
     size_type             cur_;
 
 private:
-    template <typename ty1_, typename ty2_>
+    template <typename ty1_, typename ty2_, typename ty3_>
     friend class fslist_base;
 };
 
 //! @brief      Modifiable list iterator
-template <typename dty_, typename nty_>
-class fslist_iterator : public fslist_const_iterator<dty_, nty_>
+template <typename dty_, typename nty_, typename layout_>
+class fslist_iterator : public fslist_const_iterator<dty_, nty_, layout_>
 {
 public:
-    using iterator_category = std::bidirectional_iterator_tag;
-    using value_type        = dty_;
-    using difference_type   = ptrdiff_t;
-    using pointer           = dty_*;
-    using reference         = dty_&;
-    using size_type         = nty_;
-    using container_type    = fslist_alloc_base<nty_>;
-    using super             = fslist_const_iterator<dty_, nty_>;
+    using iterator_category = typename std::conditional<
+      layout_::bidirectional,
+      std::bidirectional_iterator_tag,
+      std::forward_iterator_tag>::type;
+    using value_type      = dty_;
+    using difference_type = ptrdiff_t;
+    using pointer         = dty_*;
+    using reference       = dty_&;
+    using size_type       = nty_;
+    using container_type  = fslist_base<dty_, nty_, layout_>;
+    using super           = fslist_const_iterator<dty_, nty_, layout_>;
 
-    fslist_iterator<dty_, nty_>& operator++() noexcept
+    fslist_iterator& operator++() noexcept
     {
-        return static_cast<fslist_iterator<dty_, nty_>&>( super::operator++() );
+        return static_cast<fslist_iterator&>( super::operator++() );
     }
-    fslist_iterator<dty_, nty_> operator++( int ) noexcept
+    fslist_iterator operator++( int ) noexcept
     {
         auto r = *this;
         return ++r;
     }
 
-    fslist_iterator<dty_, nty_>& operator--() noexcept
+    fslist_iterator& operator--() noexcept
     {
         return static_cast<fslist_iterator&>( super::operator--() );
     }
-    fslist_iterator<dty_, nty_> operator--( int ) noexcept
+    fslist_iterator operator--( int ) noexcept
     {
         auto r = *this;
         return ++r;
@@ -374,17 +553,34 @@ public:
     operator super() const noexcept { return static_cast<super&>( *this ); }
 };
 
+//! @brief      Node and value stored side by side, for interleaved layout.
+template <typename dty_, typename nty_, typename layout_>
+struct fslist_slot
+{
+    fslist_node<nty_, layout_::bidirectional> node;
+    typename std::aligned_storage<sizeof( dty_ ), alignof( dty_ )>::type value;
+};
+
 //! @brief      Base class for list
 //! @details
 //!              It provides an interface that can be used similar to a list of
 //!             common STL containers. Complex behaviors, such as nodes managed
 //!             by indexes, are simplified by implementing them in classes that
 //!             inherit them.
-template <typename dty_, typename nty_ = size_t>
-class fslist_base : public fslist_alloc_base<nty_>
+//! @tparam     layout_ \ref upp::impl::fslist_layout
+template <
+  typename dty_,
+  typename nty_    = size_t,
+  typename layout_ = fslist_layout_split>
+class fslist_base
+    : public fslist_alloc_base<
+        nty_,
+        layout_::bidirectional,
+        layout_::interleaved
+          ? sizeof( fslist_slot<dty_, nty_, layout_> )
+          : sizeof( fslist_node<nty_, layout_::bidirectional> )>
 {
 public:
-    using super_type      = fslist_alloc_base<nty_>;
     using value_type      = dty_;
     using size_type       = nty_;
     using difference_type = ptrdiff_t;
@@ -392,35 +588,51 @@ public:
     using reference       = value_type&;
     using const_pointer   = value_type const*;
     using const_reference = value_type const;
-    using node_type       = fslist_node<size_type>;
-    using iterator        = fslist_iterator<value_type, size_type>;
-    using const_iterator  = fslist_const_iterator<value_type, size_type>;
-    using super           = fslist_alloc_base<nty_>;
+    using layout_type     = layout_;
+    using node_type       = fslist_node<size_type, layout_::bidirectional>;
+    using slot_type       = fslist_slot<value_type, size_type, layout_>;
+    using iterator        = fslist_iterator<value_type, size_type, layout_>;
+    using const_iterator
+      = fslist_const_iterator<value_type, size_type, layout_>;
+    using super_type = fslist_alloc_base<
+      nty_,
+      layout_::bidirectional,
+      layout_::interleaved ? sizeof( slot_type ) : sizeof( node_type )>;
+    using super = super_type;
     enum
     {
         NODE_NONE = (size_type)-1
     };
 
+    //! Distance between adjacent values in bytes.
+    enum : size_t
+    {
+        VALUE_STRIDE
+        = layout_::interleaved ? sizeof( slot_type ) : sizeof( value_type )
+    };
+
 public:
     ~fslist_base() noexcept { clear(); }
 
-    void clear() noexcept
-    {
-        for ( size_type i = super::head(); i != NODE_NONE; ) {
-            varray_[i].~value_type();
-            auto k = i;
-            i      = super::next( i );
-            super::dealloc_node( k );
-        }
-    }
+    void clear() noexcept { erase( cbegin(), cend() ); }
 
+    //! @brief      Construct over separate value and node arrays.
     fslist_base(
       size_type  capacity,
       pointer    varray,
       node_type* narray ) noexcept
         : super_type( capacity, narray )
-        , varray_( varray )
+        , vbase_( reinterpret_cast<char*>( varray ) )
     {
+        static_assert( !layout_::interleaved, "Requires slot array" );
+    }
+
+    //! @brief      Construct over array of interleaved slots.
+    fslist_base( size_type capacity, slot_type* sarray ) noexcept
+        : super_type( capacity, &sarray->node )
+        , vbase_( reinterpret_cast<char*>( &sarray->value ) )
+    {
+        static_assert( layout_::interleaved, "Requires value and node array" );
     }
 
     template <typename... arg_>
@@ -429,7 +641,7 @@ public:
         auto n = super::alloc_node();
         super::push_front_node( n );
         auto p
-          = new ( varray_ + n ) value_type( std::forward<arg_>( args )... );
+          = new ( value_at( n ) ) value_type( std::forward<arg_>( args )... );
         return *p;
     }
 
@@ -439,7 +651,7 @@ public:
         auto n = super::alloc_node();
         super::push_back_node( n );
         auto p
-          = new ( varray_ + n ) value_type( std::forward<arg_>( args )... );
+          = new ( value_at( n ) ) value_type( std::forward<arg_>( args )... );
         return *p;
     }
 
@@ -477,25 +689,25 @@ public:
     const_reference front() const noexcept
     {
         uassert( super::valid_node( super::head() ) );
-        return varray_[super::head()];
+        return *value_at( super::head() );
     }
 
     const_reference back() const noexcept
     {
         uassert( super::valid_node( super::tail() ) );
-        return varray_[super::tail()];
+        return *value_at( super::tail() );
     }
 
     reference front() noexcept
     {
         uassert( super::valid_node( super::head() ) );
-        return varray_[super::head()];
+        return *value_at( super::head() );
     }
 
     reference back() noexcept
     {
         uassert( super::valid_node( super::tail() ) );
-        return varray_[super::tail()];
+        return *value_at( super::tail() );
     }
 
     template <typename... ty__>
@@ -505,7 +717,7 @@ public:
         auto n = super::alloc_node();
         super::insert_node( n, pos.cur_ );
 
-        new ( varray_ + n ) value_type( std::forward<ty__>( args )... );
+        new ( value_at( n ) ) value_type( std::forward<ty__>( args )... );
 
         const_iterator r;
         r.container_ = this;
@@ -530,62 +742,180 @@ public:
 
     void pop_front() noexcept { release( super::head() ); }
 
+    //! @note       Forward-only layouts walk from the head to find the
+    //!             predecessor. Use erase_after() there.
     void erase( const_iterator pos ) noexcept { release( pos.cur_ ); }
 
+    //! @brief      Construct new element next to pos. O(1) in every layout.
+    template <typename... ty__>
+    iterator emplace_after( const_iterator pos, ty__&&... args ) noexcept
+    {
+        auto n = super::alloc_node();
+        super::insert_node_after( n, pos.cur_ );
+
+        new ( value_at( n ) ) value_type( std::forward<ty__>( args )... );
+
+        const_iterator r;
+        r.container_ = this;
+        r.cur_       = n;
+        return static_cast<iterator&>( r );
+    }
+
+    //! @brief      Erase element next to pos. O(1) in every layout.
+    //! @returns    Iterator to the element next to erased one.
+    iterator erase_after( const_iterator pos ) noexcept
+    {
+        auto n = super::next( pos.cur_ );
+        uassert( n != NODE_NONE );
+
+        const_iterator r;
+        r.container_ = this;
+        r.cur_       = super::next( n );
+
+        value_at( n )->~value_type();
+        super::dealloc_node( n, pos.cur_ );
+        return static_cast<iterator&>( r );
+    }
+
+    //! @brief      Erase elements in range [first, last).
+    //! @details    Nodes of the range are returned to the pool at once.
+    iterator erase( const_iterator first, const_iterator last ) noexcept
+    {
+        for ( auto i = first.cur_; i != last.cur_; i = super::next( i ) )
+            value_at( i )->~value_type();
+        super::dealloc_range( first.cur_, last.cur_ );
+        return static_cast<iterator&>( last );
+    }
+
+    //! @brief      Erase every element which satisfies given predicate.
+    //! @returns    Number of erased elements.
+    template <typename pred_>
+    size_type remove_if( pred_&& pred )
+    {
+        size_type cnt = 0, prv = NODE_NONE;
+        for ( size_type i = super::head(); i != NODE_NONE; ) {
+            auto k = i;
+            i      = super::next( i );
+            if ( pred( *value_at( k ) ) ) {
+                release( k, prv );
+                ++cnt;
+            }
+            else {
+                prv = k;
+            }
+        }
+        return cnt;
+    }
+
+    //! @brief      Move elements in range [first, last) of other before pos.
+    //! @details
+    //!              Within the same list, nodes are relinked in O(1) and
+    //!             elements never move. As each list owns its storage,
+    //!             elements from the other list are move-constructed into
+    //!             this list.
+    void splice(
+      const_iterator pos,
+      fslist_base&   other,
+      const_iterator first,
+      const_iterator last ) noexcept
+    {
+        if ( first.cur_ == last.cur_ )
+            return;
+
+        if ( &other == this ) {
+            auto l = last.cur_ != NODE_NONE ? super::prev( last.cur_ )
+                                            : super::tail();
+            super::unlink_chain( first.cur_, l );
+            super::link_chain( first.cur_, l, pos.cur_ );
+            return;
+        }
+
+        // Predecessors on both sides are looked up once, then carried along.
+        auto     prv = other.prev( first.cur_ );
+        iterator at;
+        for ( auto i = first.cur_; i != last.cur_; ) {
+            auto  k = i;
+            auto& v = *other.value_at( k );
+            i       = other.next( i );
+            at      = k == first.cur_ ? emplace( pos, std::move( v ) )
+                                      : emplace_after( at, std::move( v ) );
+            other.release( k, prv );
+        }
+    }
+
+    //! @brief      Move every element of other before pos.
+    void splice( const_iterator pos, fslist_base& other ) noexcept
+    {
+        splice( pos, other, other.cbegin(), other.cend() );
+    }
+
     const_pointer at__( size_type fs_idx ) const noexcept
     {
-        return super::valid_node( fs_idx ) ? varray_ + fs_idx : nullptr;
+        return super::valid_node( fs_idx ) ? value_at( fs_idx ) : nullptr;
     }
 
     pointer at__( size_type fs_idx ) noexcept
     {
-        return super::valid_node( fs_idx ) ? varray_ + fs_idx : nullptr;
+        return super::valid_node( fs_idx ) ? value_at( fs_idx ) : nullptr;
     }
 
 private:
-    template <typename ty1_, typename ty2_>
+    template <typename ty1_, typename ty2_, typename ty3_>
     friend class fslist_const_iterator;
 
     void release( size_type n )
     {
         uassert( n != NODE_NONE );
-        varray_[n].~value_type();
+        value_at( n )->~value_type();
         super::dealloc_node( n );
     }
 
+    void release( size_type n, size_type prv )
+    {
+        uassert( n != NODE_NONE );
+        value_at( n )->~value_type();
+        super::dealloc_node( n, prv );
+    }
+
     pointer get_arg( size_type node ) noexcept
     {
         uassert( node != NODE_NONE );
         uassert( super::valid_node( node ) );
-        return varray_ + node;
+        return value_at( node );
+    }
+
+    pointer value_at( size_type n ) const noexcept
+    {
+        return reinterpret_cast<pointer>( vbase_ + (size_t)n * VALUE_STRIDE );
     }
 
 private:
-    pointer varray_;
+    char* vbase_;
 };
 
-template <typename dty_, typename nty_>
-inline fslist_const_iterator<dty_, nty_>&
-fslist_const_iterator<dty_, nty_>::operator++() noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline fslist_const_iterator<dty_, nty_, layout_>&
+fslist_const_iterator<dty_, nty_, layout_>::operator++() noexcept
 {
     uassert( container_ && cur_ != NODE_NONE );
     cur_ = container_->next( cur_ );
     return *this;
 }
 
-template <typename dty_, typename nty_>
-inline fslist_const_iterator<dty_, nty_>
-fslist_const_iterator<dty_, nty_>::operator++( int ) noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline fslist_const_iterator<dty_, nty_, layout_>
+fslist_const_iterator<dty_, nty_, layout_>::operator++( int ) noexcept
 {
     auto ret = *this;
     return ++ret;
 }
 
-template <typename dty_, typename nty_>
-inline fslist_const_iterator<dty_, nty_>&
-fslist_const_iterator<dty_, nty_>::operator--() noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline fslist_const_iterator<dty_, nty_, layout_>&
+fslist_const_iterator<dty_, nty_, layout_>::operator--() noexcept
 {
-    uassert( container_ && cur_ != container_.head() );
+    static_assert( layout_::bidirectional, "Forward-only list" );
+    uassert( container_ && cur_ != container_->head() );
     if ( cur_ == NODE_NONE ) {
         cur_ = container_->tail();
     }
@@ -595,29 +925,27 @@ fslist_const_iterator<dty_, nty_>::operator--() noexcept
     return *this;
 }
 
-template <typename dty_, typename nty_>
-inline fslist_const_iterator<dty_, nty_>
-fslist_const_iterator<dty_, nty_>::operator--( int ) noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline fslist_const_iterator<dty_, nty_, layout_>
+fslist_const_iterator<dty_, nty_, layout_>::operator--( int ) noexcept
 {
     auto ret = *this;
     return --ret;
 }
 
-template <typename dty_, typename nty_>
-inline typename fslist_const_iterator<dty_, nty_>::reference
-fslist_const_iterator<dty_, nty_>::operator*() const noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline typename fslist_const_iterator<dty_, nty_, layout_>::reference
+fslist_const_iterator<dty_, nty_, layout_>::operator*() const noexcept
 {
-    auto c = static_cast<fslist_base<dty_, nty_>*>(
-      const_cast<fslist_alloc_base<nty_>*>( container_ ) );
+    auto c = const_cast<container_type*>( container_ );
     return *c->get_arg( cur_ );
 }
 
-template <typename dty_, typename nty_>
-inline typename fslist_const_iterator<dty_, nty_>::pointer
-fslist_const_iterator<dty_, nty_>::operator->() const noexcept
+template <typename dty_, typename nty_, typename layout_>
+inline typename fslist_const_iterator<dty_, nty_, layout_>::pointer
+fslist_const_iterator<dty_, nty_, layout_>::operator->() const noexcept
 {
-    auto c = static_cast<fslist_base<dty_, nty_>*>(
-      const_cast<fslist_alloc_base<nty_>*>( container_ ) );
+    auto c = const_cast<container_type*>( container_ );
     return c->get_arg( cur_ );
 }
 
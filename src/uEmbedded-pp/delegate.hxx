@@ -1,4 +1,11 @@
 #pragma once
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+#include "../uEmbedded/allocator.h"
+#include "../uEmbedded/uassert.h"
+
 namespace upp {
 //! @addtogroup uEmbedded_Cpp
 //! @{
@@ -29,11 +36,214 @@ namespace upp {
 //!             are completely equal can be bound in one delegate. No specific
 //!             alignment happens during appending or removing operation.Thus
 //!             every lookup operation takes O(n) complexity. \n
+//!              The vector keeps first few bindings inline, and spills to an
+//!             allocator_t beyond that. Invocation is a linear scan over one
+//!             contiguous array. Bindings whose object is expired are dropped
+//!             on invocation. \n
 //!              Removing delegate operation is queued in internal storage when
 //!             the delegate is on execution to prevent data race. It does not
 //!             assure callback execution order.
 //! @{
 
+template <typename ptr_, typename sig_, size_t inline__ = 4>
+class delegate;
+
+//! @brief      Multicast delegate.
+//! @tparam     ptr_ Weak pointer-like type of bound objects.
+//! @tparam     args_ Event arguments.
+//! @tparam     inline__ Number of bindings stored without allocation.
+template <typename ptr_, typename... args_, size_t inline__>
+class delegate<ptr_, void( args_... ), inline__>
+{
+    static_assert( inline__ > 0, "At least one binding must be inline" );
+
+public:
+    using pointer_type = ptr_;
+    using locked_type  = decltype( std::declval<ptr_ const&>().lock() );
+
+    //! @brief      Callback receives locked object pointer.
+    using function_type = void ( * )( locked_type const&, args_... );
+
+private:
+    struct binding
+    {
+        ptr_          obj;
+        function_type fn;
+    };
+
+public:
+    explicit delegate( allocator_ref_t alloc = &g_mallocator ) noexcept
+        : alloc_( alloc )
+        , data_( reinterpret_cast<binding*>( inline_ ) )
+    {
+    }
+
+    delegate( delegate const& ) = delete;
+    delegate& operator=( delegate const& ) = delete;
+
+    ~delegate() noexcept
+    {
+        uassert( depth_ == 0 );
+        clear();
+        if ( data_ != reinterpret_cast<binding*>( inline_ ) )
+            alloc_->release( alloc_->object, data_ );
+    }
+
+    //! @brief      Bind callback with object.
+    //! @returns    false if allocation failed.
+    bool add( ptr_ const& obj, function_type fn ) noexcept
+    {
+        uassert( fn );
+        if ( size_ == cap_ && !grow() )
+            return false;
+
+        new ( data_ + size_ ) binding { obj, fn };
+        ++size_;
+        return true;
+    }
+
+    //! @brief      Remove every binding of the function.
+    size_t remove( function_type fn ) noexcept
+    {
+        return remove_if( [fn]( binding const& b ) { return b.fn == fn; } );
+    }
+
+    //! @brief      Remove every binding of the object.
+    size_t remove( ptr_ const& obj ) noexcept
+    {
+        auto l = obj.lock();
+        return remove_if( [&l]( binding const& b ) {
+            return b.obj.lock() == l;
+        } );
+    }
+
+    //! @brief      Remove every binding of the object and the function.
+    size_t remove( ptr_ const& obj, function_type fn ) noexcept
+    {
+        auto l = obj.lock();
+        return remove_if( [&l, fn]( binding const& b ) {
+            return b.fn == fn && b.obj.lock() == l;
+        } );
+    }
+
+    //! @brief      Remove every binding.
+    void clear() noexcept
+    {
+        remove_if( []( binding const& ) { return true; } );
+    }
+
+    //! @brief      Call every binding. Bindings added meanwhile are called
+    //!             from next invocation. If a callback throws, the rest are
+    //!             skipped and deferred removals are applied.
+    template <typename... fwd_>
+    void operator()( fwd_&&... args )
+    {
+        struct depth_guard
+        {
+            delegate* s;
+            ~depth_guard()
+            {
+                if ( --s->depth_ == 0 && s->numPending_ )
+                    s->compact();
+            }
+        };
+
+        size_t n = size_;
+
+        ++depth_;
+        depth_guard guard { this };
+        for ( size_t i = 0; i < n; ++i ) {
+            // Storage may move when callback adds bindings.
+            function_type fn = data_[i].fn;
+            if ( fn == nullptr )
+                continue;
+
+            auto l = data_[i].obj.lock();
+            if ( !l ) {
+                data_[i].fn = nullptr;
+                ++numPending_;
+                continue;
+            }
+
+            fn( l, args... );
+        }
+    }
+
+    //! @brief      Number of bindings, excluding removed ones.
+    size_t size() const noexcept { return size_ - numPending_; }
+    bool   empty() const noexcept { return size() == 0; }
+
+private:
+    template <typename pred_>
+    size_t remove_if( pred_&& pred ) noexcept
+    {
+        size_t num = 0;
+
+        for ( size_t i = 0; i < size_; ++i ) {
+            if ( data_[i].fn && pred( data_[i] ) ) {
+                data_[i].fn = nullptr;
+                ++num;
+            }
+        }
+
+        numPending_ += num;
+        if ( depth_ == 0 && numPending_ )
+            compact();
+        return num;
+    }
+
+    //! Drop removed bindings, keeping order of the rest.
+    void compact() noexcept
+    {
+        size_t d = 0;
+
+        for ( size_t i = 0; i < size_; ++i ) {
+            if ( data_[i].fn == nullptr )
+                continue;
+            if ( d != i )
+                data_[d] = std::move( data_[i] );
+            ++d;
+        }
+
+        for ( size_t i = d; i < size_; ++i )
+            data_[i].~binding();
+
+        size_       = d;
+        numPending_ = 0;
+    }
+
+    bool grow() noexcept
+    {
+        size_t   cap = cap_ * 2;
+        binding* p   = static_cast<binding*>(
+            alloc_->allocate( alloc_->object, cap * sizeof( binding ) ) );
+        if ( p == nullptr )
+            return false;
+
+        for ( size_t i = 0; i < size_; ++i ) {
+            new ( p + i ) binding( std::move( data_[i] ) );
+            data_[i].~binding();
+        }
+
+        if ( data_ != reinterpret_cast<binding*>( inline_ ) )
+            alloc_->release( alloc_->object, data_ );
+
+        data_ = p;
+        cap_  = cap;
+        return true;
+    }
+
+private:
+    allocator_ref_t alloc_;
+    binding*        data_;
+    size_t          size_       = 0;
+    size_t          cap_        = inline__;
+    size_t          numPending_ = 0;
+    size_t          depth_      = 0;
+
+    alignas( binding ) unsigned char inline_[inline__ * sizeof( binding )];
+};
+
 //! @}
 //! @}
-} // namespace upp
\ No newline at end of file
+} // namespace upp
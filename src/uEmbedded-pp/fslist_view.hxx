@@ -0,0 +1,124 @@
+//! @brief      Typed C++ view over C free space list
+//! @file       fslist_view.hxx
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             Wraps struct fslist which is shared with C code, so that it can
+//!             be iterated by range-based for, with the loop body inlined. Like
+//!             FSLIST_FOREACH(), nodes and data are prefetched ahead.
+#pragma once
+#include <iterator>
+#include <stddef.h>
+#include "../uEmbedded/fslist.h"
+
+namespace upp {
+//! @addtogroup uEmbedded_Cpp
+//! @{
+//! @weakgroup  uEmbedded_Cpp_FreeSpaceList
+//! @{
+
+//! @brief      Non-owning typed view of struct fslist.
+//! @tparam     dty_ Element type. Its size must match elemSize of the list.
+template <typename dty_>
+class fslist_view
+{
+public:
+    using value_type = dty_;
+    using size_type  = size_t;
+    using pointer    = dty_*;
+    using reference  = dty_&;
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = dty_;
+        using difference_type   = ptrdiff_t;
+        using pointer           = dty_*;
+        using reference         = dty_&;
+
+        iterator& operator++() noexcept
+        {
+            cur_   = s_->get[cur_].next;
+            ahead_ = fslist_prefetch_next_( s_, ahead_ );
+            return *this;
+        }
+        iterator operator++( int ) noexcept
+        {
+            auto r = *this;
+            ++*this;
+            return r;
+        }
+
+        reference operator*() const noexcept { return *operator->(); }
+        pointer   operator->() const noexcept
+        {
+            return static_cast<pointer>( fslist_at( s_, cur_ ) );
+        }
+
+        bool operator==( iterator const& r ) const noexcept
+        {
+            return cur_ == r.cur_;
+        }
+        bool operator!=( iterator const& r ) const noexcept
+        {
+            return cur_ != r.cur_;
+        }
+
+        //! @brief      Index of current node.
+        fslist_idx_t fs_idx__() const noexcept { return cur_; }
+
+    private:
+        iterator( fslist* s, fslist_idx_t cur, fslist_idx_t ahead ) noexcept
+            : s_( s )
+            , cur_( cur )
+            , ahead_( ahead )
+        {
+        }
+
+        fslist*      s_;
+        fslist_idx_t cur_;
+        fslist_idx_t ahead_;
+
+        friend class fslist_view;
+    };
+
+public:
+    explicit fslist_view( fslist* s ) noexcept : s_( s )
+    {
+        uassert( s->elemSize == sizeof( dty_ ) );
+    }
+
+    iterator begin() const noexcept
+    {
+        return iterator( s_, s_->head, fslist_prefetch_begin_( s_ ) );
+    }
+    iterator end() const noexcept
+    {
+        return iterator( s_, FSLIST_NODEIDX_NONE, FSLIST_NODEIDX_NONE );
+    }
+
+    size_type size() const noexcept { return s_->size; }
+    bool      empty() const noexcept { return s_->size == 0; }
+
+    //! @brief      Apply given function to every element in list order.
+    template <typename fn_>
+    void for_each( fn_&& fn ) const
+    {
+        FSLIST_FOREACH( s_, i )
+        {
+            fn( *static_cast<pointer>( fslist_at( s_, i ) ) );
+        }
+    }
+
+    fslist* get() const noexcept { return s_; }
+
+private:
+    fslist* s_;
+};
+
+//! @}
+//! @}
+} // namespace upp
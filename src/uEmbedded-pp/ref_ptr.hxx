@@ -0,0 +1,261 @@
+//! @brief      Typed RAII wrappers over managed_reference_pool
+//! @file       ref_ptr.hxx
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!             ref_pool<T> owns a pool whose objects are T, constructed in
+//!             place in pool memory. Its finalizer runs ~T() whenever an object
+//!             is reclaimed, which is on the last unlock after free, or on
+//!             destruction of the pool.
+//!
+//!             ref_ptr<T> owns a reference and frees it on destruction, while
+//!             ref_guard<T> keeps the object locked for a scope. Both are thin
+//!             inline wrappers of ref_*() calls and hold nothing but the
+//!             handle, plus the locked pointer for the guard.
+#pragma once
+#include <cstddef>
+#include <new>
+#include <stddef.h>
+#include <type_traits>
+#include <utility>
+#include "../uEmbedded/managed_reference_pool.h"
+
+namespace upp {
+//! @addtogroup uEmbedded_Cpp
+//! @{
+//! @defgroup   uEmbedded_Cpp_RefPtr
+//! @{
+
+//! @brief      Locks referenced object for its lifetime.
+template <typename ty_>
+class ref_guard
+{
+public:
+    ref_guard() noexcept
+        : h_ { nullptr, nullptr, OBJECTID_NULL }
+        , p_( nullptr )
+    {
+    }
+
+    //! @brief      Lock. Empty if the reference is gone or pending free.
+    explicit ref_guard( refhandle_t const& h ) noexcept
+        : h_( h )
+        , p_( h.id != OBJECTID_NULL ? static_cast<ty_*>( ref_lock( &h_ ) )
+                                    : nullptr )
+    {
+    }
+
+    ref_guard( ref_guard&& r ) noexcept
+        : h_( r.h_ )
+        , p_( r.p_ )
+    {
+        r.p_ = nullptr;
+    }
+
+    ref_guard& operator=( ref_guard&& r ) noexcept
+    {
+        unlock();
+        h_   = r.h_;
+        p_   = r.p_;
+        r.p_ = nullptr;
+        return *this;
+    }
+
+    ref_guard( ref_guard const& ) = delete;
+    ref_guard& operator=( ref_guard const& ) = delete;
+
+    ~ref_guard() noexcept { unlock(); }
+
+    //! @brief      Unlock before the scope ends.
+    void unlock() noexcept
+    {
+        if ( p_ )
+            ref_unlock( &h_ );
+        p_ = nullptr;
+    }
+
+    ty_* get() const noexcept { return p_; }
+    ty_* operator->() const noexcept { return p_; }
+    ty_& operator*() const noexcept { return *p_; }
+
+    explicit operator bool() const noexcept { return p_ != nullptr; }
+
+private:
+    refhandle_t h_;
+    ty_*        p_;
+};
+
+//! @brief      Move-only owner of a reference. Frees it on destruction; the
+//!             object is destroyed once every lock on it is released.
+template <typename ty_>
+class ref_ptr
+{
+public:
+    using element_type = ty_;
+
+    ref_ptr() noexcept
+        : h_ { nullptr, nullptr, OBJECTID_NULL }
+    {
+    }
+
+    //! @brief      Adopt handle of an object of type ty_.
+    explicit ref_ptr( refhandle_t const& h ) noexcept
+        : h_( h )
+    {
+    }
+
+    ref_ptr( ref_ptr&& r ) noexcept
+        : h_( r.release() )
+    {
+    }
+
+    ref_ptr& operator=( ref_ptr&& r ) noexcept
+    {
+        if ( this != &r ) {
+            reset();
+            h_ = r.release();
+        }
+        return *this;
+    }
+
+    ref_ptr( ref_ptr const& ) = delete;
+    ref_ptr& operator=( ref_ptr const& ) = delete;
+
+    ~ref_ptr() noexcept { reset(); }
+
+    //! @brief      Free the reference now.
+    void reset() noexcept
+    {
+        if ( h_.id != OBJECTID_NULL )
+            ref_free( &h_ );
+        h_.id = OBJECTID_NULL;
+    }
+
+    //! @brief      Give up ownership without freeing.
+    refhandle_t release() noexcept
+    {
+        refhandle_t h = h_;
+        h_.id         = OBJECTID_NULL;
+        return h;
+    }
+
+    refhandle_t const& handle() const noexcept { return h_; }
+
+    //! @brief      Lock the object for a scope.
+    ref_guard<ty_> lock() const noexcept { return ref_guard<ty_>( h_ ); }
+
+    bool valid() const noexcept
+    {
+        return h_.id != OBJECTID_NULL && ref_is_valid( &h_ );
+    }
+    explicit operator bool() const noexcept { return valid(); }
+
+private:
+    refhandle_t h_;
+};
+
+//! @brief      Pool of objects of type ty_.
+//! @details    Objects are aligned as the pool's allocator does; blocks of
+//!             REFPOOL_FLAG_SLAB pools are aligned to SLAB_ALIGN. Types
+//!             aligned beyond max_align_t aren't supported.
+template <typename ty_>
+class ref_pool
+{
+public:
+    //! @param      numMaxRef
+    //!              References per chunk.
+    //! @param      numMaxChunk
+    //!              Maximum chunks to grow into. 1 for fixed capacity.
+    //! @param      flags
+    //!              Combination of REFPOOL_FLAG_* values.
+    explicit ref_pool(
+        size_t          numMaxRef,
+        size_t          numMaxChunk = 1,
+        uint32_t        flags       = 0,
+        allocator_ref_t alloc       = nullptr ) noexcept
+    {
+        refpool_desc desc = {};
+        desc.numMaxRef    = numMaxRef;
+        desc.numMaxChunk  = numMaxChunk;
+        desc.flags        = flags;
+        desc.alloc        = alloc;
+        desc.finalize     = std::is_trivially_destructible<ty_>::value
+                                ? nullptr
+                                : &finalize_;
+        p_                = refpool_create_ex( &desc );
+    }
+
+    ref_pool( ref_pool const& ) = delete;
+    ref_pool& operator=( ref_pool const& ) = delete;
+
+    //! @warning    Every reference of the pool becomes invalid.
+    ~ref_pool() noexcept
+    {
+        if ( p_ )
+            refpool_destroy( p_ );
+    }
+
+    explicit operator bool() const noexcept { return p_ != nullptr; }
+    managed_reference_pool_t* get() const noexcept { return p_; }
+
+    //! @brief      Construct ty_ in pool memory.
+    //! @returns    Empty pointer if the pool is full.
+    template <typename... args_>
+    ref_ptr<ty_> make( args_&&... args )
+    {
+        static_assert(
+            alignof( ty_ ) <= alignof( std::max_align_t ),
+            "Pool memory isn't aligned beyond max_align_t" );
+
+        refhandle_t h = refpool_malloc( p_, sizeof( ty_ ) );
+        if ( h.id == OBJECTID_NULL )
+            return {};
+
+        // Reclaimed without the finalizer if the constructor throws.
+        struct undo_t
+        {
+            refhandle_t* h;
+            ~undo_t()
+            {
+                if ( h )
+                    ref_discard( h );
+            }
+        } undo { &h };
+
+        void* mem = ref_lock( &h );
+        ref_unlock( &h );
+        new ( mem ) ty_( std::forward<args_>( args )... );
+
+        undo.h = nullptr;
+        return ref_ptr<ty_>( h );
+    }
+
+    //! @brief      See refpool_compact(). Objects are moved by memcpy.
+    size_t compact() noexcept
+    {
+        static_assert(
+            std::is_trivially_copyable<ty_>::value,
+            "Relocated objects must be trivially copyable" );
+        return refpool_compact( p_ );
+    }
+
+    size_t num_available() const noexcept
+    {
+        return refpool_num_available( p_ );
+    }
+
+private:
+    static void finalize_( void* obj ) noexcept
+    {
+        static_cast<ty_*>( obj )->~ty_();
+    }
+
+private:
+    managed_reference_pool_t* p_;
+};
+
+//! @}
+//! @}
+} // namespace upp
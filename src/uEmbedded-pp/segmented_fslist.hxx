@@ -0,0 +1,422 @@
+//! @brief      Growable free space list built from fixed-size chunks
+//! @file       segmented_fslist.hxx
+//!
+//! @author     Seungwoo Kang (ki6080@gmail.com)
+//! @copyright  Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+//!
+//! @details
+//!              Nodes and elements are stored in chunks of 2^chunk_log__
+//!             entries, each allocated from an allocator_t on demand. As
+//!             chunks are never moved, element addresses and node indices stay
+//!             valid until the element is erased. Growing never copies
+//!             elements; only the small chunk directory is reallocated.
+//!              Index of a node is (chunk number << chunk_log__ | offset), thus
+//!             index type limits maximum number of chunks.
+#pragma once
+#include <iterator>
+#include <new>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+#include "../uEmbedded/allocator.h"
+#include "../uEmbedded/uassert.h"
+
+namespace upp {
+//! @addtogroup uEmbedded_Cpp
+//! @{
+//! @weakgroup  uEmbedded_Cpp_FreeSpaceList
+//! @{
+
+//! @brief      Free space list which grows by chunks without moving elements.
+//! @tparam     nty_ Node index type.
+//! @tparam     chunk_log__ Log2 of number of nodes per chunk.
+template <typename dty_, typename nty_ = size_t, size_t chunk_log__ = 6>
+class segmented_fslist
+{
+public:
+    using value_type      = dty_;
+    using size_type       = nty_;
+    using difference_type = ptrdiff_t;
+    using pointer         = value_type*;
+    using reference       = value_type&;
+    using const_pointer   = value_type const*;
+    using const_reference = value_type const&;
+    enum : size_t
+    {
+        CHUNK_SIZE = (size_t)1 << chunk_log__,
+        CHUNK_MASK = CHUNK_SIZE - 1,
+
+        //! Last index is reserved for NODE_NONE.
+        MAX_CHUNKS = ( (size_t)(size_type)-1 ) >> chunk_log__
+    };
+    enum
+    {
+        NODE_NONE = (size_type)-1
+    };
+
+    template <bool const_>
+    class iterator_base;
+    using iterator       = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+private:
+    struct node
+    {
+        size_type nxt_;
+        size_type prv_;
+        bool      valid_;
+    };
+
+    struct chunk
+    {
+        node nodes[CHUNK_SIZE];
+        typename std::aligned_storage<sizeof( dty_ ), alignof( dty_ )>::type
+          values[CHUNK_SIZE];
+    };
+
+public:
+    template <bool const_>
+    class iterator_base
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type        = dty_;
+        using difference_type   = ptrdiff_t;
+        using pointer           = typename std::
+          conditional<const_, dty_ const*, dty_*>::type;
+        using reference = typename std::
+          conditional<const_, dty_ const&, dty_&>::type;
+
+        iterator_base() noexcept : container_( nullptr ), cur_( NODE_NONE ) { }
+
+        //! Non-const iterator converts to const one.
+        operator iterator_base<true>() const noexcept
+        {
+            return iterator_base<true>( container_, cur_ );
+        }
+
+        iterator_base& operator++() noexcept
+        {
+            uassert( container_ && cur_ != NODE_NONE );
+            cur_ = container_->node_at( cur_ ).nxt_;
+            return *this;
+        }
+        iterator_base operator++( int ) noexcept
+        {
+            auto r = *this;
+            ++*this;
+            return r;
+        }
+        iterator_base& operator--() noexcept
+        {
+            uassert( container_ && cur_ != container_->head_ );
+            cur_ = cur_ == NODE_NONE ? container_->tail_
+                                     : container_->node_at( cur_ ).prv_;
+            return *this;
+        }
+        iterator_base operator--( int ) noexcept
+        {
+            auto r = *this;
+            --*this;
+            return r;
+        }
+
+        reference operator*() const noexcept { return *operator->(); }
+        pointer   operator->() const noexcept
+        {
+            uassert( container_ && container_->valid_node( cur_ ) );
+            return const_cast<pointer>( container_->value_at( cur_ ) );
+        }
+
+        bool operator==( iterator_base const& r ) const noexcept
+        {
+            return container_ == r.container_ && cur_ == r.cur_;
+        }
+        bool operator!=( iterator_base const& r ) const noexcept
+        {
+            return !( *this == r );
+        }
+
+        size_type fs_idx__() const noexcept { return cur_; }
+
+    private:
+        iterator_base( segmented_fslist const* c, size_type cur ) noexcept
+            : container_( c )
+            , cur_( cur )
+        {
+        }
+
+        segmented_fslist const* container_;
+        size_type               cur_;
+
+        template <bool>
+        friend class iterator_base;
+        friend class segmented_fslist;
+    };
+
+public:
+    //! @brief      Construct empty list. Nothing is allocated until the first
+    //!             insertion or reserve().
+    explicit segmented_fslist( allocator_ref_t alloc = &g_mallocator ) noexcept
+        : alloc_( alloc )
+        , chunks_( nullptr )
+        , num_chunks_( 0 )
+        , dir_capacity_( 0 )
+        , size_( 0 )
+        , head_( NODE_NONE )
+        , tail_( NODE_NONE )
+        , idle_( NODE_NONE )
+    {
+    }
+
+    segmented_fslist( segmented_fslist const& ) = delete;
+    segmented_fslist& operator=( segmented_fslist const& ) = delete;
+
+    ~segmented_fslist() noexcept
+    {
+        clear();
+        for ( size_t i = 0; i < num_chunks_; ++i )
+            alloc_->release( alloc_->object, chunks_[i] );
+        if ( chunks_ )
+            alloc_->release( alloc_->object, chunks_ );
+    }
+
+    //! @brief      Get number of currently activated nodes
+    size_type size() const noexcept { return size_; }
+
+    //! @brief      Check if list is empty
+    bool empty() const noexcept { return size_ == 0; }
+
+    //! @brief      Get number of nodes allocated so far.
+    size_t capacity() const noexcept { return num_chunks_ * CHUNK_SIZE; }
+
+    //! @brief      Get maximum number of nodes that index type can address.
+    size_t max_size() const noexcept { return MAX_CHUNKS * CHUNK_SIZE; }
+
+    //! @brief      Allocate chunks until given number of nodes fit.
+    //! @returns    false if allocation failed.
+    bool reserve( size_t n ) noexcept
+    {
+        while ( capacity() < n )
+            if ( !grow() )
+                return false;
+        return true;
+    }
+
+    template <typename... arg_>
+    iterator emplace( const_iterator pos, arg_&&... args ) noexcept
+    {
+        auto n = alloc_node();
+        if ( n == NODE_NONE )
+            return end();
+
+        new ( value_at( n ) ) value_type( std::forward<arg_>( args )... );
+        link_before( n, pos.cur_ );
+        return iterator( this, n );
+    }
+
+    template <typename... arg_>
+    reference emplace_back( arg_&&... args ) noexcept
+    {
+        auto it = emplace( cend(), std::forward<arg_>( args )... );
+        uassert( it != end() );
+        return *it;
+    }
+
+    template <typename... arg_>
+    reference emplace_front( arg_&&... args ) noexcept
+    {
+        auto it = emplace( cbegin(), std::forward<arg_>( args )... );
+        uassert( it != end() );
+        return *it;
+    }
+
+    void push_back( const_reference arg ) noexcept { emplace_back( arg ); }
+
+    void push_front( const_reference arg ) noexcept { emplace_front( arg ); }
+
+    void pop_back() noexcept { release( tail_ ); }
+
+    void pop_front() noexcept { release( head_ ); }
+
+    //! @returns    Iterator to the element next to erased one.
+    iterator erase( const_iterator pos ) noexcept
+    {
+        auto nxt = node_at( pos.cur_ ).nxt_;
+        release( pos.cur_ );
+        return iterator( this, nxt );
+    }
+
+    //! @brief      Erase elements in range [first, last).
+    iterator erase( const_iterator first, const_iterator last ) noexcept
+    {
+        while ( first != last )
+            first = erase( first );
+        return iterator( this, last.cur_ );
+    }
+
+    //! @brief      Erase every element. Allocated chunks are kept for reuse.
+    void clear() noexcept { erase( cbegin(), cend() ); }
+
+    const_iterator cbegin() const noexcept
+    {
+        return const_iterator( this, head_ );
+    }
+    const_iterator cend() const noexcept
+    {
+        return const_iterator( this, NODE_NONE );
+    }
+    const_iterator begin() const noexcept { return cbegin(); }
+    const_iterator end() const noexcept { return cend(); }
+    iterator       begin() noexcept { return iterator( this, head_ ); }
+    iterator       end() noexcept { return iterator( this, NODE_NONE ); }
+
+    reference front() noexcept { return *begin(); }
+    reference back() noexcept { return *iterator( this, tail_ ); }
+    const_reference front() const noexcept { return *begin(); }
+    const_reference back() const noexcept
+    {
+        return *const_iterator( this, tail_ );
+    }
+
+    //! @brief      Access element by stable node index.
+    //! @returns    nullptr if the index isn't occupied.
+    pointer at__( size_type fs_idx ) noexcept
+    {
+        return valid_node( fs_idx ) ? value_at( fs_idx ) : nullptr;
+    }
+    const_pointer at__( size_type fs_idx ) const noexcept
+    {
+        return valid_node( fs_idx ) ? value_at( fs_idx ) : nullptr;
+    }
+
+private:
+    node& node_at( size_type i ) const noexcept
+    {
+        return chunks_[i >> chunk_log__]->nodes[i & CHUNK_MASK];
+    }
+
+    pointer value_at( size_type i ) const noexcept
+    {
+        return reinterpret_cast<pointer>(
+          &chunks_[i >> chunk_log__]->values[i & CHUNK_MASK] );
+    }
+
+    bool valid_node( size_type i ) const noexcept
+    {
+        return i != NODE_NONE && ( i >> chunk_log__ ) < num_chunks_
+               && node_at( i ).valid_;
+    }
+
+    //! @brief      Append one chunk and put its nodes to the idle list.
+    bool grow() noexcept
+    {
+        if ( num_chunks_ == MAX_CHUNKS )
+            return false;
+
+        // Directory holds pointers only, thus copying it is cheap.
+        if ( num_chunks_ == dir_capacity_ ) {
+            size_t cap = dir_capacity_ ? dir_capacity_ * 2 : 4;
+            cap        = cap < MAX_CHUNKS ? cap : MAX_CHUNKS;
+            auto dir   = static_cast<chunk**>(
+              alloc_->allocate( alloc_->object, cap * sizeof( chunk* ) ) );
+            if ( dir == nullptr )
+                return false;
+
+            if ( chunks_ ) {
+                memcpy( dir, chunks_, num_chunks_ * sizeof( chunk* ) );
+                alloc_->release( alloc_->object, chunks_ );
+            }
+            chunks_       = dir;
+            dir_capacity_ = cap;
+        }
+
+        auto c = static_cast<chunk*>(
+          alloc_->allocate( alloc_->object, sizeof( chunk ) ) );
+        if ( c == nullptr )
+            return false;
+
+        // Lower indices are handed out first.
+        size_t base            = num_chunks_ << chunk_log__;
+        chunks_[num_chunks_++] = c;
+        for ( size_t k = CHUNK_SIZE; k--; ) {
+            c->nodes[k].valid_ = false;
+            c->nodes[k].prv_   = NODE_NONE;
+            c->nodes[k].nxt_   = idle_;
+            idle_              = static_cast<size_type>( base + k );
+        }
+        return true;
+    }
+
+    size_type alloc_node() noexcept
+    {
+        if ( idle_ == NODE_NONE && !grow() )
+            return NODE_NONE;
+
+        auto  i  = idle_;
+        node& n  = node_at( i );
+        idle_    = n.nxt_;
+        n.valid_ = true;
+        ++size_;
+        return i;
+    }
+
+    //! @brief      Link node before given node. NODE_NONE appends.
+    void link_before( size_type i, size_type at ) noexcept
+    {
+        node&     n   = node_at( i );
+        size_type prv = at != NODE_NONE ? node_at( at ).prv_ : tail_;
+
+        n.prv_ = prv;
+        n.nxt_ = at;
+
+        if ( prv != NODE_NONE )
+            node_at( prv ).nxt_ = i;
+        else
+            head_ = i;
+
+        if ( at != NODE_NONE )
+            node_at( at ).prv_ = i;
+        else
+            tail_ = i;
+    }
+
+    void release( size_type i ) noexcept
+    {
+        uassert( valid_node( i ) );
+        node& n = node_at( i );
+
+        value_at( i )->~value_type();
+
+        if ( n.prv_ != NODE_NONE )
+            node_at( n.prv_ ).nxt_ = n.nxt_;
+        else
+            head_ = n.nxt_;
+
+        if ( n.nxt_ != NODE_NONE )
+            node_at( n.nxt_ ).prv_ = n.prv_;
+        else
+            tail_ = n.prv_;
+
+        n.valid_ = false;
+        n.nxt_   = idle_;
+        idle_    = i;
+        --size_;
+    }
+
+private:
+    allocator_ref_t alloc_;
+    chunk**         chunks_;
+    size_t          num_chunks_;
+    size_t          dir_capacity_;
+    size_type       size_;
+    size_type       head_;
+    size_type       tail_;
+    size_type       idle_;
+};
+
+//! @}
+//! @}
+} // namespace upp
@@ -6,13 +6,53 @@ namespace upp {
 //! @weakgroup  uEmbedded_Cpp_FreeSpaceList
 //! @{
 
+using impl::fslist_layout_forward;
+using impl::fslist_layout_forward_interleaved;
+using impl::fslist_layout_interleaved;
+using impl::fslist_layout_split;
+
+namespace impl {
+//! \brief      Static buffers for each layout.
+template <
+  typename value_ty__,
+  typename size_ty__,
+  size_t cap__,
+  typename layout__>
+struct static_fslist_storage
+{
+    value_ty__                                      vbuf[cap__];
+    fslist_node<size_ty__, layout__::bidirectional> nbuf[cap__];
+};
+
+template <typename value_ty__, typename size_ty__, size_t cap__, bool bidir__>
+struct static_fslist_storage<
+  value_ty__,
+  size_ty__,
+  cap__,
+  fslist_layout<true, bidir__>>
+{
+    using layout = fslist_layout<true, bidir__>;
+    fslist_slot<value_ty__, size_ty__, layout> sbuf[cap__];
+};
+} // namespace impl
+
 //! \brief       A simple wrapper class that allocates static memory for nodes
 //!             and data buffers.
-template <typename value_ty__, typename size_ty__, size_t cap__>
-class static_fslist : public impl::fslist_base<value_ty__, size_ty__>
+//! \tparam      layout__
+//!              One of fslist_layout_split(default), fslist_layout_interleaved,
+//!             fslist_layout_forward and fslist_layout_forward_interleaved.
+template <
+  typename value_ty__,
+  typename size_ty__,
+  size_t cap__,
+  typename layout__ = fslist_layout_split>
+class static_fslist
+    : private impl::
+        static_fslist_storage<value_ty__, size_ty__, cap__, layout__>
+    , public impl::fslist_base<value_ty__, size_ty__, layout__>
 {
 public:
-    using super           = impl::fslist_base<value_ty__, size_ty__>;
+    using super           = impl::fslist_base<value_ty__, size_ty__, layout__>;
     using value_type      = value_ty__;
     using size_type       = size_ty__;
     using difference_type = ptrdiff_t;
@@ -24,11 +64,21 @@ public:
     using const_iterator  = typename super::const_iterator;
 
 public:
-    static_fslist() : super( cap__, &vbuf[0], &nbuf[0] ) { }
+    static_fslist()
+        : static_fslist(
+          std::integral_constant<bool, layout__::interleaved>() )
+    {
+    }
 
 private:
-    value_ty__                   vbuf[cap__];
-    impl::fslist_node<size_ty__> nbuf[cap__];
+    using storage
+      = impl::static_fslist_storage<value_ty__, size_ty__, cap__, layout__>;
+
+    static_fslist( std::false_type )
+        : super( cap__, &storage::vbuf[0], &storage::nbuf[0] )
+    {
+    }
+    static_fslist( std::true_type ) : super( cap__, &storage::sbuf[0] ) { }
 };
 
 //! @}
@@ -0,0 +1,236 @@
+#include "buffered_transceiver.h"
+#include <string.h>
+#include "uassert.h"
+
+typedef buffered_transceiver_t desc_t;
+
+transceiver_result_t buffered_transceiver_flush( buffered_transceiver_t* s )
+{
+    char*                ptr;
+    size_t               len;
+    transceiver_result_t r;
+
+    if ( s->tx.buff == NULL )
+        return 0;
+
+    // At most two iterations; one for each side of the wrap point.
+    while ( ( ptr = ring_buffer_linear_read( &s->tx, &len ), len ) ) {
+        r = td_write( s->lower, ptr, len );
+        if ( r < 0 )
+            return r;
+
+        ring_buffer_consume( &s->tx, (size_t)r );
+        if ( (size_t)r < len )
+            break;
+    }
+
+    return ( transceiver_result_t )( ring_buffer_size( &s->tx ) );
+}
+
+void buffered_transceiver_tick( buffered_transceiver_t* s, size_t curTime )
+{
+    if ( s->flushInterval == 0 || curTime - s->lastFlush < s->flushInterval )
+        return;
+
+    s->lastFlush = curTime;
+    if ( s->tx.buff && ring_buffer_size( &s->tx ) )
+        buffered_transceiver_flush( s );
+}
+
+static transceiver_result_t
+read_impl( void* obj, char* rdbuf, size_t rdcnt )
+{
+    desc_t*              s = (desc_t*)obj;
+    char*                ptr;
+    size_t               len, avail;
+    transceiver_result_t r;
+
+    if ( s->rx.buff == NULL )
+        return td_read( s->lower, rdbuf, rdcnt );
+
+    avail = ring_buffer_size( &s->rx );
+
+    // Large reads bypass the buffer to prevent redundant copy.
+    if ( avail == 0 && rdcnt >= s->rx.cap - 1 )
+        return td_read( s->lower, rdbuf, rdcnt );
+
+    // Read ahead as much as possible.
+    while ( avail < rdcnt ) {
+        ptr = ring_buffer_linear_write( &s->rx, &len );
+        if ( len == 0 )
+            break;
+
+        r = td_read( s->lower, ptr, len );
+        if ( r <= 0 ) {
+            if ( avail == 0 )
+                return r;
+            break;
+        }
+
+        ring_buffer_commit( &s->rx, (size_t)r );
+        avail += (size_t)r;
+        if ( (size_t)r < len )
+            break;
+    }
+
+    return ( transceiver_result_t )( ring_buffer_read( &s->rx, rdbuf, rdcnt ) );
+}
+
+static transceiver_result_t
+write_impl( void* obj, char const* wrbuf, size_t wrcnt )
+{
+    desc_t*              s = (desc_t*)obj;
+    size_t               space;
+    transceiver_result_t r;
+
+    if ( s->tx.buff == NULL )
+        return td_write( s->lower, (char*)wrbuf, wrcnt );
+
+    space = ring_buffer_space( &s->tx );
+    if ( space < wrcnt ) {
+        r = buffered_transceiver_flush( s );
+        if ( r < 0 )
+            return r;
+
+        // Large writes bypass the buffer once pending bytes are gone.
+        if ( r == 0 && wrcnt >= s->tx.cap - 1 )
+            return td_write( s->lower, (char*)wrbuf, wrcnt );
+
+        space = ring_buffer_space( &s->tx );
+        if ( space < wrcnt )
+            wrcnt = space;
+    }
+
+    ring_buffer_write( &s->tx, wrbuf, wrcnt );
+
+    if ( ring_buffer_size( &s->tx ) >= s->flushThreshold ) {
+        r = buffered_transceiver_flush( s );
+        if ( r < 0 && wrcnt == 0 )
+            return r;
+    }
+
+    return ( transceiver_result_t )( wrcnt );
+}
+
+static transceiver_result_t ioctl_impl( void* obj, intptr_t cmd )
+{
+    desc_t*              s = (desc_t*)obj;
+    transceiver_result_t r;
+
+    if ( cmd == TRANSCEIVER_IOCTL_FLUSH ) {
+        r = buffered_transceiver_flush( s );
+        if ( r < 0 )
+            return r;
+
+        // Propagate to stacked transceivers
+        td_ioctl( s->lower, cmd );
+        return r;
+    }
+
+    return td_ioctl( s->lower, cmd );
+}
+
+static transceiver_result_t close_impl( void* obj )
+{
+    desc_t* s = (desc_t*)obj;
+
+    buffered_transceiver_flush( s );
+    return td_close( s->lower );
+}
+
+static transceiver_result_t readv_impl(
+    void*                      obj,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    desc_t* s = (desc_t*)obj;
+
+    if ( s->rx.buff == NULL )
+        return td_readv( s->lower, iov, iovcnt );
+    return td_readv_generic( (transceiver_handle_t)s, iov, iovcnt );
+}
+
+static transceiver_result_t writev_impl(
+    void*                      obj,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    desc_t* s = (desc_t*)obj;
+
+    // Each vector is gathered into TX buffer, thus no scratch buffer needed.
+    if ( s->tx.buff == NULL )
+        return td_writev( s->lower, iov, iovcnt );
+    return td_writev_generic( (transceiver_handle_t)s, iov, iovcnt );
+}
+
+static transceiver_result_t loan_impl( void* obj, char** buf )
+{
+    desc_t*              s = (desc_t*)obj;
+    char*                ptr;
+    size_t               len;
+    transceiver_result_t r;
+
+    if ( s->rx.buff == NULL )
+        return td_loan( s->lower, buf );
+
+    if ( ring_buffer_size( &s->rx ) == 0 ) {
+        ptr = ring_buffer_linear_write( &s->rx, &len );
+        r   = td_read( s->lower, ptr, len );
+        if ( r <= 0 )
+            return r;
+        ring_buffer_commit( &s->rx, (size_t)r );
+    }
+
+    *buf = ring_buffer_linear_read( &s->rx, &len );
+    return ( transceiver_result_t )( len );
+}
+
+static transceiver_result_t release_impl( void* obj, size_t consumed )
+{
+    desc_t* s = (desc_t*)obj;
+
+    if ( s->rx.buff == NULL )
+        return td_release( s->lower, consumed );
+
+    uassert( consumed <= ring_buffer_size( &s->rx ) );
+    ring_buffer_consume( &s->rx, consumed );
+    return TRANSCEIVER_OK;
+}
+
+static transceiver_vtable_t const g_vtable = { read_impl,
+                                               write_impl,
+                                               ioctl_impl,
+                                               close_impl,
+                                               readv_impl,
+                                               writev_impl,
+                                               loan_impl,
+                                               release_impl };
+
+transceiver_handle_t buffered_transceiver_init(
+    buffered_transceiver_t* s,
+    transceiver_handle_t    lower,
+    void*                   txbuf,
+    size_t                  txSize,
+    void*                   rxbuf,
+    size_t                  rxSize,
+    size_t                  flushThreshold )
+{
+    uassert( s && lower );
+    uassert( txbuf == NULL || txSize > 1 );
+    uassert( rxbuf == NULL || rxSize > 1 );
+
+    memset( s, 0, sizeof( *s ) );
+    s->vt_   = &g_vtable;
+    s->lower = lower;
+
+    if ( txbuf )
+        ring_buffer_init( &s->tx, txbuf, txSize );
+    if ( rxbuf )
+        ring_buffer_init( &s->rx, rxbuf, rxSize );
+
+    if ( flushThreshold == 0 || flushThreshold > txSize - 1 )
+        flushThreshold = txSize / 2;
+    s->flushThreshold = flushThreshold;
+
+    return (transceiver_handle_t)s;
+}
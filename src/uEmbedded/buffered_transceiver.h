@@ -0,0 +1,94 @@
+/*! \brief Buffered transceiver decorator.
+    \file buffered_transceiver.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-02
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Wraps any transceiver handle with ring buffer backed write coalescing
+   and read-ahead. Small writes are gathered in TX buffer and pushed to the
+   underlying transceiver when the buffer reaches its flush threshold, when
+   TRANSCEIVER_IOCTL_FLUSH is delivered, or when the flush interval elapses on
+   buffered_transceiver_tick(). Reads are served from RX buffer, which is
+   refilled with as much data as the underlying transceiver provides.
+        Since the decorator exposes the same transceiver_vtable, it can wrap
+   another decorator. Vectored writes are gathered into TX buffer directly, and
+   RX buffer can be loaned through td_loan().
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ring_buffer.h"
+#include "transceiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Buffered_Transceiver
+//! @{
+
+//! \brief      Buffered transceiver descriptor.
+struct buffered_transceiver
+{
+    //! \brief      Must be placed at first. See transceiver_handle_t.
+    transceiver_vtable_t const* vt_;
+
+    //! \brief      Wrapped transceiver.
+    transceiver_handle_t lower;
+
+    ring_buffer_t tx;
+    ring_buffer_t rx;
+
+    //! \brief      Pending TX bytes which trigger flush.
+    size_t flushThreshold;
+
+    //! \brief      Maximum time pending TX bytes can stay. 0 to disable. Set
+    //!             this directly after initialization.
+    size_t flushInterval;
+
+    //! \brief      Time of last flush, given by buffered_transceiver_tick().
+    size_t lastFlush;
+};
+
+typedef struct buffered_transceiver buffered_transceiver_t;
+
+/*! \brief      Initialize decorator.
+    \param      txbuf
+                 TX coalescing buffer. Pass NULL to disable TX buffering.
+    \param      rxbuf
+                 RX read-ahead buffer. Pass NULL to disable RX buffering.
+    \param      flushThreshold
+                 Pending byte count which triggers flush. 0 selects half of TX
+                buffer size.
+    \returns    Handle to the decorator, which can be passed to td_*()
+   functions. */
+transceiver_handle_t buffered_transceiver_init(
+    buffered_transceiver_t* s,
+    transceiver_handle_t    lower,
+    void*                   txbuf,
+    size_t                  txSize,
+    void*                   rxbuf,
+    size_t                  rxSize,
+    size_t                  flushThreshold );
+
+/*! \brief      Push pending TX bytes to the underlying transceiver.
+    \returns    Number of bytes still pending, or negative error code of
+   underlying transceiver. */
+transceiver_result_t buffered_transceiver_flush( buffered_transceiver_t* s );
+
+/*! \brief      Flush pending bytes if flushInterval has elapsed since last
+   flush. Call this periodically, e.g. from timer_logic callback. */
+void buffered_transceiver_tick( buffered_transceiver_t* s, size_t curTime );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
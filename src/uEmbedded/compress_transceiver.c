@@ -0,0 +1,309 @@
+#include "compress_transceiver.h"
+#include <string.h>
+#include "uassert.h"
+
+typedef compress_transceiver_t desc_t;
+
+static inline size_t now_of( desc_t* s )
+{
+    return s->clock ? s->clock( s->clockObj ) : 0;
+}
+
+//! Compress gathered block into frame. Falls back to raw if it doesn't shrink.
+static void seal_block( desc_t* s )
+{
+    size_t   len, t0 = now_of( s );
+    uint16_t hdr;
+
+    len = lz_compress(
+        s->txBlock,
+        s->txBlockLen,
+        s->txFrame + COMPRESS_HEADER_SIZE,
+        s->txBlockLen - 1,
+        s->workmem );
+
+    if ( len == 0 ) {
+        memcpy( s->txFrame + COMPRESS_HEADER_SIZE, s->txBlock, s->txBlockLen );
+        len = s->txBlockLen;
+        hdr = (uint16_t)( len | COMPRESS_RAW_FLAG );
+    }
+    else
+        hdr = (uint16_t)len;
+
+    s->txFrame[0]     = (char)hdr;
+    s->txFrame[1]     = (char)( hdr >> 8 );
+    s->txFrameLen     = COMPRESS_HEADER_SIZE + len;
+    s->txFrameOff     = 0;
+    s->stats.txRaw   += s->txBlockLen;
+    s->stats.txWire  += s->txFrameLen;
+    s->stats.txTicks += now_of( s ) - t0;
+    s->txBlockLen     = 0;
+}
+
+//! Send pending frame. Returns bytes left in frame, or error.
+static transceiver_result_t drain_frame( desc_t* s )
+{
+    transceiver_result_t r;
+
+    while ( s->txFrameOff < s->txFrameLen ) {
+        r = td_write(
+            s->lower,
+            s->txFrame + s->txFrameOff,
+            s->txFrameLen - s->txFrameOff );
+        if ( r < 0 )
+            return r;
+        if ( r == 0 )
+            break;
+        s->txFrameOff += (size_t)r;
+    }
+
+    return ( transceiver_result_t )( s->txFrameLen - s->txFrameOff );
+}
+
+transceiver_result_t compress_transceiver_flush( compress_transceiver_t* s )
+{
+    transceiver_result_t r;
+
+    r = drain_frame( s );
+    if ( r != 0 )
+        return r < 0 ? r : r + (transceiver_result_t)s->txBlockLen;
+
+    if ( s->txBlockLen ) {
+        seal_block( s );
+        r = drain_frame( s );
+    }
+
+    return r;
+}
+
+static transceiver_result_t
+write_impl( void* obj, char const* wrbuf, size_t wrcnt )
+{
+    desc_t*              s = (desc_t*)obj;
+    size_t               n;
+    transceiver_result_t r;
+
+    r = drain_frame( s );
+    if ( r < 0 )
+        return r;
+
+    n = s->blockSize - s->txBlockLen;
+    n = n < wrcnt ? n : wrcnt;
+    memcpy( s->txBlock + s->txBlockLen, wrbuf, n );
+    s->txBlockLen += n;
+
+    // Full block is sealed as soon as the previous frame is gone.
+    if ( s->txBlockLen == s->blockSize && r == 0 ) {
+        seal_block( s );
+        r = drain_frame( s );
+        if ( r < 0 && n == 0 )
+            return r;
+    }
+
+    return (transceiver_result_t)n;
+}
+
+//! Receive next frame and decode it. Returns 1 if a block is ready.
+static transceiver_result_t fill_block( desc_t* s )
+{
+    transceiver_result_t r;
+    size_t               need, len, t0;
+    uint16_t             hdr = 0;
+
+    for ( ;; ) {
+        need = COMPRESS_HEADER_SIZE;
+        if ( s->rxFrameLen >= COMPRESS_HEADER_SIZE ) {
+            hdr = (uint16_t)( (uint8_t)s->rxFrame[0]
+                              | (uint8_t)s->rxFrame[1] << 8 );
+            len = hdr & ~COMPRESS_RAW_FLAG;
+            if ( len == 0 || len > s->blockSize )
+                return TRANSCEIVER_INVALID_DATA;
+
+            need += len;
+            if ( s->rxFrameLen == need )
+                break;
+        }
+
+        r = td_read(
+            s->lower, s->rxFrame + s->rxFrameLen, need - s->rxFrameLen );
+        if ( r <= 0 )
+            return r;
+        s->rxFrameLen += (size_t)r;
+    }
+
+    s->stats.rxWire += s->rxFrameLen;
+    len             = s->rxFrameLen - COMPRESS_HEADER_SIZE;
+    s->rxFrameLen   = 0;
+    s->rxDataOff    = 0;
+
+    // Raw block is read straight from the frame buffer.
+    if ( hdr & COMPRESS_RAW_FLAG ) {
+        s->rxData    = s->rxFrame + COMPRESS_HEADER_SIZE;
+        s->rxDataLen = len;
+    }
+    else {
+        t0  = now_of( s );
+        len = lz_decompress(
+            s->rxFrame + COMPRESS_HEADER_SIZE, len, s->rxBlock, s->blockSize );
+        if ( len == LZ_ERROR )
+            return TRANSCEIVER_INVALID_DATA;
+
+        s->stats.rxTicks += now_of( s ) - t0;
+        s->rxData         = s->rxBlock;
+        s->rxDataLen      = len;
+    }
+
+    s->stats.rxRaw += s->rxDataLen;
+    return 1;
+}
+
+static transceiver_result_t
+read_impl( void* obj, char* rdbuf, size_t rdcnt )
+{
+    desc_t*              s     = (desc_t*)obj;
+    size_t               total = 0, n;
+    transceiver_result_t r;
+
+    while ( total < rdcnt ) {
+        if ( s->rxDataOff == s->rxDataLen ) {
+            r = fill_block( s );
+            if ( r <= 0 ) {
+                if ( total )
+                    break;
+                return r;
+            }
+        }
+
+        n = s->rxDataLen - s->rxDataOff;
+        n = n < rdcnt - total ? n : rdcnt - total;
+        memcpy( rdbuf + total, s->rxData + s->rxDataOff, n );
+        s->rxDataOff += n;
+        total += n;
+    }
+
+    return (transceiver_result_t)total;
+}
+
+static transceiver_result_t loan_impl( void* obj, char** buf )
+{
+    desc_t*              s = (desc_t*)obj;
+    transceiver_result_t r;
+
+    if ( s->rxDataOff == s->rxDataLen && ( r = fill_block( s ) ) <= 0 )
+        return r;
+
+    *buf = (char*)s->rxData + s->rxDataOff;
+    return ( transceiver_result_t )( s->rxDataLen - s->rxDataOff );
+}
+
+static transceiver_result_t release_impl( void* obj, size_t consumed )
+{
+    desc_t* s = (desc_t*)obj;
+
+    uassert( consumed <= s->rxDataLen - s->rxDataOff );
+    s->rxDataOff += consumed;
+    return TRANSCEIVER_OK;
+}
+
+//! Ratio in permille. 0 if nothing has been transferred yet.
+static transceiver_result_t ratio( size_t wire, size_t raw )
+{
+    return raw ? ( transceiver_result_t )( (uint64_t)wire * 1000 / raw ) : 0;
+}
+
+static transceiver_result_t throughput( desc_t* s, size_t raw, size_t ticks )
+{
+    if ( s->clock == NULL )
+        return TRANSCEIVER_NOT_SUPPORTED;
+    if ( ticks == 0 )
+        return 0;
+    return ( transceiver_result_t )(
+        (uint64_t)raw * s->ticksPerSecond / ticks / 1024 );
+}
+
+static transceiver_result_t ioctl_impl( void* obj, intptr_t cmd )
+{
+    desc_t*              s = (desc_t*)obj;
+    transceiver_result_t r;
+
+    switch ( cmd ) {
+    case TRANSCEIVER_IOCTL_FLUSH:
+        r = compress_transceiver_flush( s );
+        if ( r < 0 )
+            return r;
+
+        // Propagate to stacked transceivers
+        td_ioctl( s->lower, cmd );
+        return r;
+
+    case COMPRESS_IOCTL_TX_RATIO:
+        return ratio( s->stats.txWire, s->stats.txRaw );
+    case COMPRESS_IOCTL_RX_RATIO:
+        return ratio( s->stats.rxWire, s->stats.rxRaw );
+    case COMPRESS_IOCTL_TX_THROUGHPUT:
+        return throughput( s, s->stats.txRaw, s->stats.txTicks );
+    case COMPRESS_IOCTL_RX_THROUGHPUT:
+        return throughput( s, s->stats.rxRaw, s->stats.rxTicks );
+    case COMPRESS_IOCTL_RESET_STATS:
+        memset( &s->stats, 0, sizeof( s->stats ) );
+        return TRANSCEIVER_OK;
+    }
+
+    return td_ioctl( s->lower, cmd );
+}
+
+static transceiver_result_t close_impl( void* obj )
+{
+    desc_t* s = (desc_t*)obj;
+
+    compress_transceiver_flush( s );
+    return td_close( s->lower );
+}
+
+static transceiver_vtable_t const g_vtable = { read_impl,
+                                               write_impl,
+                                               ioctl_impl,
+                                               close_impl,
+                                               NULL,
+                                               NULL,
+                                               loan_impl,
+                                               release_impl };
+
+transceiver_handle_t compress_transceiver_init(
+    compress_transceiver_t* s,
+    transceiver_handle_t    lower,
+    void*                   mem,
+    size_t                  memSize,
+    size_t                  blockSize )
+{
+    char* p = (char*)mem;
+
+    uassert( s && lower && mem );
+    uassert( blockSize > 1 && blockSize <= COMPRESS_MAX_BLOCK );
+    uassert( memSize >= COMPRESS_TRANSCEIVER_MEMORY( blockSize ) );
+    (void)memSize;
+
+    memset( s, 0, sizeof( *s ) );
+    s->vt_       = &g_vtable;
+    s->lower     = lower;
+    s->blockSize = blockSize;
+
+    s->workmem = p, p += LZ_WORKMEM_SIZE;
+    s->txBlock = p, p += blockSize;
+    s->txFrame = p, p += COMPRESS_HEADER_SIZE + blockSize;
+    s->rxFrame = p, p += COMPRESS_HEADER_SIZE + blockSize;
+    s->rxBlock = p;
+
+    return (transceiver_handle_t)s;
+}
+
+void compress_transceiver_set_clock(
+    compress_transceiver_t* s,
+    compress_clock_cb_t     clock,
+    void*                   obj,
+    size_t                  ticksPerSecond )
+{
+    s->clock          = clock;
+    s->clockObj       = obj;
+    s->ticksPerSecond = ticksPerSecond;
+}
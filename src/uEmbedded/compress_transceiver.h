@@ -0,0 +1,149 @@
+/*! \brief Transceiver decorator which compresses the stream.
+    \file compress_transceiver.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Written data is gathered into blocks, and each block is compressed by
+   lz_compress() before it goes to the lower transceiver. Blocks which don't
+   shrink are sent as-is. On the wire, each block is preceded by 16-bit little
+   endian header of [raw flag | payload length].
+        A block is sealed when it's full, or on TRANSCEIVER_IOCTL_FLUSH. Small
+   interactive writes should be followed by flush.
+        Every buffer is carved from single caller-provided working memory, sized
+   by COMPRESS_TRANSCEIVER_MEMORY(). Nothing is allocated.
+        Compression ratio and throughput are returned by the ioctl commands
+   below. Throughput requires a clock, given by
+   compress_transceiver_set_clock().
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "lz_block.h"
+#include "transceiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Compress_Transceiver
+//! @{
+
+//! \brief      ioctl commands. Results are returned as the return value.
+enum
+{
+    //! \brief      Compressed size per 1000 bytes of sent data.
+    COMPRESS_IOCTL_TX_RATIO = TRANSCEIVER_IOCTL_IMPLEMENTATION_DOMAIN + 0x10,
+
+    //! \brief      Compressed size per 1000 bytes of received data.
+    COMPRESS_IOCTL_RX_RATIO,
+
+    //! \brief      Compression speed, in KiB of input per second.
+    COMPRESS_IOCTL_TX_THROUGHPUT,
+
+    //! \brief      Decompression speed, in KiB of output per second.
+    COMPRESS_IOCTL_RX_THROUGHPUT,
+
+    //! \brief      Reset statistics.
+    COMPRESS_IOCTL_RESET_STATS
+};
+
+enum
+{
+    COMPRESS_HEADER_SIZE = 2,
+    COMPRESS_RAW_FLAG    = 0x8000,
+
+    //! \brief      Maximum block size, as payload length is 15 bit.
+    COMPRESS_MAX_BLOCK = 0x7fff
+};
+
+//! \brief      Size of working memory for given block size.
+#define COMPRESS_TRANSCEIVER_MEMORY( blockSize )                               \
+    ( LZ_WORKMEM_SIZE + 4 * ( blockSize ) + 2 * COMPRESS_HEADER_SIZE )
+
+//! \brief      Returns current time.
+typedef size_t ( *compress_clock_cb_t )( void* /*obj*/ );
+
+//! \brief      Traffic statistics.
+struct compress_stats
+{
+    size_t txRaw;
+    size_t txWire;
+    size_t txTicks;
+    size_t rxRaw;
+    size_t rxWire;
+    size_t rxTicks;
+};
+
+//! \brief      Compressing decorator descriptor.
+struct compress_transceiver
+{
+    //! \brief      Must be placed at first. See transceiver_handle_t.
+    transceiver_vtable_t const* vt_;
+
+    transceiver_handle_t lower;
+    void*                workmem;
+    size_t               blockSize;
+
+    // Block being gathered, and the sealed frame being sent.
+    char*  txBlock;
+    size_t txBlockLen;
+    char*  txFrame;
+    size_t txFrameLen;
+    size_t txFrameOff;
+
+    // Frame being received, and its decoded block being read.
+    char*       rxFrame;
+    size_t      rxFrameLen;
+    char*       rxBlock;
+    char const* rxData;
+    size_t      rxDataLen;
+    size_t      rxDataOff;
+
+    compress_clock_cb_t clock;
+    void*               clockObj;
+    size_t              ticksPerSecond;
+
+    struct compress_stats stats;
+};
+
+typedef struct compress_transceiver compress_transceiver_t;
+
+/*! \brief      Initialize decorator.
+    \param      mem
+                 Working memory of COMPRESS_TRANSCEIVER_MEMORY( blockSize )
+                bytes.
+    \param      blockSize
+                 Size of uncompressed block. Up to COMPRESS_MAX_BLOCK. Larger
+                blocks compress better, at the cost of latency.
+    \returns    Transceiver handle. */
+transceiver_handle_t compress_transceiver_init(
+    compress_transceiver_t* s,
+    transceiver_handle_t    lower,
+    void*                   mem,
+    size_t                  memSize,
+    size_t                  blockSize );
+
+/*! \brief      Set clock to measure throughput. */
+void compress_transceiver_set_clock(
+    compress_transceiver_t* s,
+    compress_clock_cb_t     clock,
+    void*                   obj,
+    size_t                  ticksPerSecond );
+
+/*! \brief      Seal pending block and send out as much as possible.
+    \returns    Number of bytes not yet sent, or negative error code. */
+transceiver_result_t compress_transceiver_flush( compress_transceiver_t* s );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,67 +3,144 @@
 #include <string.h>
 #include "uassert.h"
 
-typedef struct node
+typedef struct binding
 {
-    struct node*        next;
     refhandle_t         objref;
     delegate_event_cb_t cb;
-} node_t;
+
+    //! Target of delegate_post(). NULL for the target given on post.
+    struct delegate_target const* target;
+} binding_t;
+
+//! Parameter of posted event; followed by bindings, then event args.
+struct post_header
+{
+    size_t numBinding;
+    size_t argSize;
+};
 
 struct delegate
 {
-    node_t* head;
-    size_t  cnt;
-    bool    bMulticast;
-    bool    bEraseLock;
+    //! Packed array of bindings. Removed ones have NULL callback until
+    //! compacted.
+    binding_t* arr;
+    size_t     size;
+    size_t     cap;
+    size_t     numPending;
+
+    //! NULL if bindings live in caller buffer, which never grows.
+    allocator_ref_t alloc;
+
+    bool   bMulticast;
+    size_t callDepth;
 };
 
-void delegate_assign(
+enum
+{
+    //! Bindings allocated along with the delegate itself.
+    NUM_INITIAL_BINDING = 4
+};
+
+static inline binding_t* initial_array( delegate_t* s )
+{
+    return (binding_t*)( s + 1 );
+}
+
+//! Drop removed bindings, keeping order of the rest.
+static void compact( delegate_t* s )
+{
+    size_t i, d = 0;
+
+    for ( i = 0; i < s->size; ++i )
+        if ( s->arr[i].cb )
+            s->arr[d++] = s->arr[i];
+
+    s->size       = d;
+    s->numPending = 0;
+}
+
+static bool grow( delegate_t* s )
+{
+    binding_t* arr;
+    size_t     cap = s->cap * 2;
+
+    if ( s->alloc == NULL )
+        return false;
+
+    arr = s->alloc->allocate( s->alloc->object, cap * sizeof( binding_t ) );
+    if ( arr == NULL )
+        return false;
+
+    memcpy( arr, s->arr, s->size * sizeof( binding_t ) );
+    if ( s->arr != initial_array( s ) )
+        s->alloc->release( s->alloc->object, s->arr );
+
+    s->arr = arr;
+    s->cap = cap;
+    return true;
+}
+
+static inline bool same_ref( refhandle_t const* a, refhandle_t const* b )
+{
+    return a->s == b->s && a->node == b->node && a->id == b->id;
+}
+
+//! Mark binding removed. Compacted at once unless a call is in progress.
+static inline void remove_at( delegate_t* s, size_t i )
+{
+    s->arr[i].cb = NULL;
+    ++s->numPending;
+}
+
+bool delegate_assign(
     delegate_t*         s,
     refhandle_t const*  objref,
     delegate_event_cb_t callback )
 {
+    return delegate_assign_queue( s, objref, callback, NULL );
+}
+
+bool delegate_assign_queue(
+    delegate_t*                   s,
+    refhandle_t const*            objref,
+    delegate_event_cb_t           callback,
+    struct delegate_target const* target )
+{
+    binding_t* b;
     uassert( s && callback && objref );
 
-    if ( s->bMulticast ) {
-        node_t* newNode;
-        newNode       = malloc( sizeof( node_t ) );
-        newNode->next = s->head;
-        s->head       = newNode;
-        ++s->cnt;
-    }
-    else if ( s->head == NULL ) {
-        s->head = malloc( sizeof( node_t ) );
-        s->cnt  = 1;
+    // Single cast delegate replaces its binding.
+    if ( !s->bMulticast && s->size ) {
+        s->numPending = 0;
+        s->size       = 0;
     }
 
-    s->head->objref = *objref;
-    s->head->cb     = callback;
+    if ( s->size == s->cap && !grow( s ) )
+        return false;
+
+    b         = s->arr + s->size++;
+    b->objref = *objref;
+    b->cb     = callback;
+    b->target = target;
+    return true;
 }
 
 void delegate_clear( delegate_t* s )
 {
+    size_t i;
     uassert( s );
-    node_t* head = s->head;
-    node_t* next;
-    int     bEraseLock = s->bEraseLock;
-
-    for ( ; head; head = next ) {
-        next = head->next;
-        if ( bEraseLock )
-            head->cb = NULL;
-        else
-            free( head );
-    }
-    s->cnt = 0;
 
-    if ( bEraseLock == false )
-        s->head = NULL;
+    for ( i = 0; i < s->size; ++i )
+        if ( s->arr[i].cb )
+            remove_at( s, i );
+
+    if ( s->callDepth == 0 )
+        compact( s );
 }
 
 size_t delegate_size( delegate_t* s )
 {
-    return s->cnt;
+    return s->size - s->numPending;
 }
 
 size_t delegate_delete(
@@ -72,93 +149,197 @@ size_t delegate_delete(
     delegate_event_cb_t callback )
 {
     uassert( s && objref );
-    node_t* head = s->head;
-    node_t* prev = NULL;
-    node_t* next;
-    int     bMulticast = s->bMulticast;
-    int     bEraseLock = s->bEraseLock;
-    size_t  numDelete  = 0;
-
-    for ( ; head; head = next ) {
-        next = head->next;
-        if ( head->cb == callback
-             && memcmp( &head->objref, objref, sizeof( *objref ) ) == 0 ) {
-            if ( prev )
-                prev->next = next;
-            else // if prev is null, means erasing node is the first node ...
-                s->head = next;
-
-            if ( bEraseLock )
-                head->cb = NULL;
-            else
-                free( head );
+    size_t i, numDelete = 0;
 
+    for ( i = 0; i < s->size; ++i ) {
+        if ( s->arr[i].cb == callback
+             && same_ref( &s->arr[i].objref, objref ) ) {
+            remove_at( s, i );
             ++numDelete;
-            s->cnt -= bMulticast;
-        }
-        else {
-            // If any node deleted, previous node stay as previous ...
-            prev = head;
         }
     }
 
+    if ( numDelete && s->callDepth == 0 )
+        compact( s );
     return numDelete;
 }
 
 void delegate_call( delegate_t* s, void* event_args )
 {
     uassert( s );
-    // To keep iteration solid ...
-    s->bEraseLock          = true;
-    node_t*  pending_erase = NULL;
-    node_t** ppnext        = &s->head;
-
-    // Callback each element iterating all nodes
-    // Remove any node with its callback is NULL, or its object reference is
-    // expired.
-    for ( ; *ppnext; ) {
-        node_t* head = *ppnext;
-
-        // When this node is pending erase ...
-        if ( head->cb == NULL || ref_is_valid( &head->objref ) == false ) {
-            // Append to pending erase list
-            head->next    = pending_erase;
-            pending_erase = head;
-            *ppnext       = head->next;
-            s->cnt--;
+    size_t      i, n = s->size;
+    binding_t*  b;
+    refhandle_t ref;
+
+    // Bindings assigned by callbacks are called from next time. The array
+    // may move meanwhile, thus it is indexed on each step, and callbacks get
+    // a copy of the handle.
+    ++s->callDepth;
+    for ( i = 0; i < n; ++i ) {
+        b = s->arr + i;
+        if ( b->cb == NULL )
             continue;
-        }
 
-        // When not erased ...
-        // Execute callback.
-        head->cb( &head->objref, event_args );
+        // Remove any binding of which object reference is expired.
+        if ( ref_is_valid( &b->objref ) == false ) {
+            remove_at( s, i );
+            continue;
+        }
 
-        ppnext = &head->next;
+        ref = b->objref;
+        b->cb( &ref, event_args );
     }
 
-    // Erase all pending erased nodes
-    node_t* next;
-    while ( pending_erase ) {
-        next = pending_erase->next;
-        free( pending_erase );
-        pending_erase = next;
+    if ( --s->callDepth == 0 && s->numPending )
+        compact( s );
+}
+
+//! Target which binding receives posted events. NULL if removed.
+static inline struct delegate_target const*
+target_of( binding_t const* b, struct delegate_target const* target )
+{
+    return b->cb == NULL ? NULL : b->target ? b->target : target;
+}
+
+static void dispatch_posted( void* param )
+{
+    struct post_header* h    = (struct post_header*)param;
+    binding_t*          b    = (binding_t*)( h + 1 );
+    void*               args = b + h->numBinding;
+    size_t              i;
+
+    // Subscribers expired since post are skipped.
+    for ( i = 0; i < h->numBinding; ++i, ++b )
+        if ( ref_is_valid( &b->objref ) )
+            b->cb( &b->objref, args );
+}
+
+size_t delegate_post(
+    delegate_t*                   s,
+    struct delegate_target const* target,
+    void const*                   args,
+    size_t                        size )
+{
+    struct post_header*           h;
+    struct delegate_target const* t;
+    binding_t*                    dst;
+    size_t                        i, j, num, numEvent = 0;
+
+    uassert( s && target && target->queue );
+
+    // Expired subscribers are pruned here, as delegate_call() does.
+    for ( i = 0; i < s->size; ++i )
+        if ( s->arr[i].cb && ref_is_valid( &s->arr[i].objref ) == false )
+            remove_at( s, i );
+
+    if ( s->callDepth == 0 && s->numPending )
+        compact( s );
+
+    // One event per distinct target, in order of first subscriber.
+    for ( i = 0; i < s->size; ++i ) {
+        if ( ( t = target_of( s->arr + i, target ) ) == NULL )
+            continue;
+
+        for ( j = 0; j < i; ++j )
+            if ( target_of( s->arr + j, target ) == t )
+                break;
+        if ( j < i )
+            continue;
+
+        for ( num = 0, j = i; j < s->size; ++j )
+            num += target_of( s->arr + j, target ) == t;
+
+        // Filled under the lock, thus never processed half written.
+        if ( t->lock )
+            t->lock( t->lockobj );
+
+        h = AllocEvent(
+            t->queue,
+            dispatch_posted,
+            sizeof( *h ) + num * sizeof( binding_t ) + size );
+
+        if ( h ) {
+            h->numBinding = num;
+            h->argSize    = size;
+
+            dst = (binding_t*)( h + 1 );
+            for ( j = i; j < s->size; ++j )
+                if ( target_of( s->arr + j, target ) == t )
+                    *dst++ = s->arr[j];
+
+            if ( args && size )
+                memcpy( dst, args, size );
+        }
+
+        if ( t->unlock )
+            t->unlock( t->lockobj );
+
+        if ( h == NULL )
+            break;
+        ++numEvent;
     }
-    s->bEraseLock = false;
+
+    return numEvent;
 }
 
 void delegate_destroy( delegate_t* s )
 {
-    uassert( s );
-    delegate_clear( s );
-    free( s );
+    uassert( s && s->callDepth == 0 );
+
+    // Caller buffer is up to the caller.
+    if ( s->alloc == NULL )
+        return;
+
+    if ( s->arr != initial_array( s ) )
+        s->alloc->release( s->alloc->object, s->arr );
+    s->alloc->release( s->alloc->object, s );
 }
 
 delegate_t* delegate_create( bool bMulticast )
 {
-    delegate_t* ret = malloc( sizeof( delegate_t ) );
-    ret->cnt        = 0;
-    ret->head       = NULL;
-    ret->bEraseLock = false;
-    ret->bMulticast = bMulticast;
-    return ret;
+    struct delegate_desc desc;
+
+    memset( &desc, 0, sizeof( desc ) );
+    desc.bMulticast = bMulticast;
+    return delegate_create_ex( &desc );
+}
+
+size_t delegate_buffer_size( size_t numBinding )
+{
+    return sizeof( delegate_t ) + numBinding * sizeof( binding_t );
+}
+
+delegate_t* delegate_create_ex( struct delegate_desc const* desc )
+{
+    delegate_t* s;
+    size_t      cap;
+
+    if ( desc->buff ) {
+        uassert( (uintptr_t)desc->buff % sizeof( void* ) == 0 );
+        if ( desc->buffSize < delegate_buffer_size( 1 ) )
+            return NULL;
+
+        s        = (delegate_t*)desc->buff;
+        s->alloc = NULL;
+        cap = ( desc->buffSize - sizeof( delegate_t ) ) / sizeof( binding_t );
+    }
+    else {
+        allocator_ref_t alloc = desc->alloc ? desc->alloc : &g_mallocator;
+
+        s = alloc->allocate(
+            alloc->object, delegate_buffer_size( NUM_INITIAL_BINDING ) );
+        if ( s == NULL )
+            return NULL;
+
+        cap      = NUM_INITIAL_BINDING;
+        s->alloc = alloc;
+    }
+
+    s->arr        = initial_array( s );
+    s->cap        = cap;
+    s->size       = 0;
+    s->numPending = 0;
+    s->callDepth  = 0;
+    s->bMulticast = desc->bMulticast;
+    return s;
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include "allocator.h"
+#include "event-procedure.h"
 #include "managed_reference_pool.h"
 
 #ifdef __cplusplus
@@ -10,20 +12,85 @@ typedef struct delegate delegate_t;
 typedef void (
     *delegate_event_cb_t )( refhandle_t const* obj, void* event_args );
 
-void delegate_assign(
+//! \brief      Delegate creation descriptor. Zero-initialize, then fill the
+//!             fields needed.
+struct delegate_desc
+{
+    bool bMulticast;
+
+    //! \brief      Allocator of the delegate and its bindings. NULL for
+    //!             g_mallocator.
+    allocator_ref_t alloc;
+
+    //! \brief      Caller buffer to place the delegate and its bindings in,
+    //!             instead of an allocator. Capacity never grows. See
+    //!             delegate_buffer_size().
+    void*  buff;
+    size_t buffSize;
+};
+
+//! \brief      Where delegate_post() queues events.
+struct delegate_target
+{
+    struct EventQueue* queue;
+
+    //! \brief      Serializes pushes into the queue with its processing, as
+    //!             given to ProcessEvent() of the queue. NULL if the queue is
+    //!             processed by the posting thread only.
+    void ( *lock )( void* );
+    void ( *unlock )( void* );
+    void* lockobj;
+};
+
+//! \brief      Bindings are stored packed in one array, so calling iterates
+//!             them without pointer chasing. Returns false if the array is
+//!             full and can't grow.
+bool delegate_assign(
     delegate_t*         s,
     refhandle_t const*  objref,
     delegate_event_cb_t callback );
+
+//! \brief      Assign with target of delegate_post(), so the callback runs
+//!             where the queue is processed, e.g. on its own worker. NULL for
+//!             the target given on each post. Target must outlive the binding.
+bool delegate_assign_queue(
+    delegate_t*                   s,
+    refhandle_t const*            objref,
+    delegate_event_cb_t           callback,
+    struct delegate_target const* target );
 void   delegate_clear( delegate_t* s );
 size_t delegate_size( delegate_t* s );
 size_t delegate_delete(
     delegate_t*         s,
     refhandle_t const*  objref,
     delegate_event_cb_t callback );
+
+//! \brief      Call every binding. Bindings of expired references are
+//!             removed. Removal during a call is deferred until it returns.
 void        delegate_call( delegate_t* s, void* event_args );
+
+/*! \brief      Call every binding later, at ProcessEvent() of its queue.
+    \details    Event args are copied once into each distinct target, along
+   with the subscribers of that target at the time of posting; thus the
+   delegate may change, or be destroyed, before events are processed.
+   Subscribers expired meanwhile are skipped. Each push is done under the lock
+   of its target.
+    \param      target
+                 Target of bindings assigned without one.
+    \returns    Number of events queued. Stops at the first full queue. */
+size_t delegate_post(
+    delegate_t*                   s,
+    struct delegate_target const* target,
+    void const*                   args,
+    size_t                        size );
+
 void        delegate_destroy( delegate_t* s );
 delegate_t* delegate_create( bool bMulticast );
 
+//! \brief      Bytes of caller buffer which holds numBinding bindings.
+size_t      delegate_buffer_size( size_t numBinding );
+delegate_t* delegate_create_ex( struct delegate_desc const* desc );
+
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
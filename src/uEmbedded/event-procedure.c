@@ -11,7 +11,7 @@ struct queueArg
 };
 #pragma pack( pop )
 
-inline size_t bundleSize( size_t paramSize )
+static inline size_t bundleSize( size_t paramSize )
 {
     return sizeof( struct queueArg ) + paramSize;
 }
@@ -36,16 +36,27 @@ void QueueEvent(
     EventCallbackType  callback,
     void const*        callbackParam,
     size_t             paramSize )
+{
+    void* data = AllocEvent( queue, callback, paramSize );
+
+    // Copy parameter data to buffer.
+    if ( data && callbackParam && paramSize )
+        memcpy( data, callbackParam, paramSize );
+}
+
+void* AllocEvent(
+    struct EventQueue* queue,
+    EventCallbackType  callback,
+    size_t             paramSize )
 {
     struct queueArg* arg = (struct queueArg*)queue_allocator_push(
         &queue->queue,
         bundleSize( paramSize ) );
-    arg->func  = callback;
-    void* data = (void*)( arg + 1 );
+    if ( arg == NULL )
+        return NULL;
 
-    // Copy parameter data to buffer.
-    if ( callbackParam && paramSize )
-        memcpy( data, callbackParam, paramSize );
+    arg->func = callback;
+    return (void*)( arg + 1 );
 }
 
 void ProcessEvent(
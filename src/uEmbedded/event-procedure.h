@@ -49,13 +49,25 @@ void FlushEvents( struct EventQueue* queue );
     \param callback Callback to execute.
     \param callbackParam Parameter that will be delivered as callback's
    parameter. This value will be copied into queue.
-    \param paramSize Size of the parameter. */
+    \param paramSize Size of the parameter.
+    \note Event is dropped if the queue is full. */
 void QueueEvent(
     struct EventQueue* queue,
     EventCallbackType  callback,
     void const*        callbackParam,
     size_t             paramSize );
 
+/*! \brief Queue new event, and get its parameter buffer to fill in place.
+    \details Unlike QueueEvent(), parameter needn't be built elsewhere first.
+   Fill the buffer before the event is processed.
+    \param paramSize Size of the parameter buffer.
+    \returns Parameter buffer, which the callback will receive. NULL if the
+   queue is full, or too small for the parameter at all. */
+void* AllocEvent(
+    struct EventQueue* queue,
+    EventCallbackType  callback,
+    size_t             paramSize );
+
 /*! \brief Process event.
     \details
         This function should be called periodically to process queued events
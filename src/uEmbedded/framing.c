@@ -0,0 +1,396 @@
+#include "framing.h"
+#include <string.h>
+#include "uassert.h"
+
+enum
+{
+    SLIP_END     = 0xC0,
+    SLIP_ESC     = 0xDB,
+    SLIP_ESC_END = 0xDC,
+    SLIP_ESC_ESC = 0xDD,
+
+    COBS_BLOCK = 0xFF
+};
+
+void framing_decoder_init(
+    framing_decoder_t* d,
+    enum framing_type  type,
+    void*              carry,
+    size_t             carryCap )
+{
+    uassert( d );
+    uassert( carry || carryCap == 0 );
+
+    memset( d, 0, sizeof( *d ) );
+    d->type     = type;
+    d->carry    = (char*)carry;
+    d->carryCap = carryCap;
+}
+
+static void carry_append( framing_decoder_t* d, char const* p, size_t len )
+{
+    if ( d->bOverflow || d->carryCap - d->carryLen < len ) {
+        d->bOverflow = true;
+        return;
+    }
+    memcpy( d->carry + d->carryLen, p, len );
+    d->carryLen += len;
+}
+
+//! Delivers carried frame, then resets frame state. Returns number of frames.
+static size_t carry_flush(
+    framing_decoder_t* d,
+    framing_frame_cb_t cb,
+    void*              obj,
+    bool               bValid )
+{
+    size_t n = 0;
+
+    if ( d->bOverflow || !bValid )
+        ++d->numErrors;
+    else {
+        cb( obj, d->carry, d->carryLen );
+        n = 1;
+    }
+
+    d->carryLen  = 0;
+    d->bPartial  = false;
+    d->bOverflow = false;
+    return n;
+}
+
+static size_t decode_length_prefix(
+    framing_decoder_t* d,
+    char*              data,
+    size_t             len,
+    framing_frame_cb_t cb,
+    void*              obj )
+{
+    char*  end = data + len;
+    size_t n   = 0, need, take;
+
+    while ( data < end ) {
+        if ( d->count < 2 ) {
+            d->length |= (uint16_t)( (uint8_t)*data++ << ( d->count * 8 ) );
+            ++d->count;
+            continue;
+        }
+
+        need = d->length - d->carryLen;
+
+        // Whole payload is in this chunk; deliver it without copy.
+        if ( !d->bPartial && (size_t)( end - data ) >= need ) {
+            cb( obj, data, need );
+            ++n;
+            data += need;
+        }
+        else {
+            take = (size_t)( end - data );
+            take = take < need ? take : need;
+            carry_append( d, data, take );
+
+            // Overflowed frame keeps counting received bytes to stay in sync.
+            if ( d->bOverflow )
+                d->carryLen += take;
+
+            data += take;
+            d->bPartial = true;
+            if ( take < need )
+                break;
+
+            n += carry_flush( d, cb, obj, true );
+        }
+
+        d->count  = 0;
+        d->length = 0;
+    }
+
+    // Header of next frame can be split, as well as payload of zero length.
+    if ( d->count == 2 && d->length == 0 ) {
+        cb( obj, data, 0 );
+        ++n;
+        d->count = 0;
+    }
+
+    return n;
+}
+
+/*! \brief      Decodes byte stuffed frames in place.
+    \details    Decoded output never exceeds input of the same frame, so
+   output cursor w trails read cursor r. Frames which started in previous
+   chunk are gathered to carry buffer instead. */
+static size_t decode_stuffed(
+    framing_decoder_t* d,
+    char*              data,
+    size_t             len,
+    framing_frame_cb_t cb,
+    void*              obj )
+{
+    bool const bSlip = d->type == FRAMING_SLIP;
+    uint8_t    delim = bSlip ? SLIP_END : 0;
+    char*      r     = data;
+    char*      end   = data + len;
+    char*      begin = data;
+    char*      w     = data;
+    size_t     n     = 0;
+    bool       bValid, bStarted;
+    uint8_t    c;
+
+    for ( ; r < end; ++r ) {
+        c = (uint8_t)*r;
+
+        if ( c == delim ) {
+            bValid = bSlip ? !d->bFlag : d->count == 0;
+
+            // Empty SLIP frames are ignored. COBS frame has started once its
+            // first code byte is received.
+            if ( d->bPartial )
+                n += carry_flush( d, cb, obj, bValid );
+            else if ( w != begin || d->bFlag || d->count ) {
+                if ( bValid && !d->bOverflow ) {
+                    cb( obj, begin, (size_t)( w - begin ) );
+                    ++n;
+                }
+                else
+                    ++d->numErrors;
+            }
+
+            d->bOverflow = false;
+            d->bFlag     = false;
+            d->count     = 0;
+            begin = w = r + 1;
+            continue;
+        }
+
+        if ( bSlip ) {
+            if ( d->bFlag ) {
+                d->bFlag = false;
+                if ( c == SLIP_ESC_END )
+                    c = SLIP_END;
+                else if ( c == SLIP_ESC_ESC )
+                    c = SLIP_ESC;
+                else
+                    d->bOverflow = true; // Drop the malformed frame
+            }
+            else if ( c == SLIP_ESC ) {
+                d->bFlag = true;
+                continue;
+            }
+        }
+        else {
+            if ( d->count == 0 ) {
+                // Code byte. The zero between blocks is emitted only when
+                // another block follows.
+                bool bZero = d->bFlag;
+                d->bFlag   = c != COBS_BLOCK;
+                d->count   = (uint8_t)( c - 1 );
+
+                if ( !bZero )
+                    continue;
+                c = 0;
+            }
+            else
+                --d->count;
+        }
+
+        if ( d->bPartial )
+            carry_append( d, (char*)&c, 1 );
+        else
+            *w++ = (char)c;
+    }
+
+    // Move partial frame of this chunk into carry buffer.
+    bStarted = w != begin || d->bFlag || d->count;
+    if ( !d->bPartial && bStarted ) {
+        d->bPartial = true;
+        carry_append( d, begin, (size_t)( w - begin ) );
+    }
+
+    return n;
+}
+
+size_t framing_decode(
+    framing_decoder_t* d,
+    char*              data,
+    size_t             len,
+    framing_frame_cb_t cb,
+    void*              obj )
+{
+    uassert( d && cb );
+    uassert( data || len == 0 );
+
+    if ( d->type == FRAMING_LENGTH_PREFIX )
+        return decode_length_prefix( d, data, len, cb, obj );
+    return decode_stuffed( d, data, len, cb, obj );
+}
+
+size_t framing_decode_ring(
+    framing_decoder_t* d,
+    ring_buffer_t*     rb,
+    framing_frame_cb_t cb,
+    void*              obj )
+{
+    char*  ptr;
+    size_t len, n = 0;
+
+    // At most two iterations; one for each side of the wrap point.
+    while ( ( ptr = ring_buffer_linear_read( rb, &len ), len ) ) {
+        n += framing_decode( d, ptr, len, cb, obj );
+        ring_buffer_consume( rb, len );
+    }
+
+    return n;
+}
+
+transceiver_result_t framing_decode_loan(
+    framing_decoder_t*   d,
+    transceiver_handle_t h,
+    framing_frame_cb_t   cb,
+    void*                obj )
+{
+    char*                ptr;
+    transceiver_result_t r;
+    size_t               n;
+
+    r = td_loan( h, &ptr );
+    if ( r <= 0 )
+        return r;
+
+    n = framing_decode( d, ptr, (size_t)r, cb, obj );
+    td_release( h, (size_t)r );
+    return (transceiver_result_t)n;
+}
+
+size_t framing_encoded_size_max( enum framing_type type, size_t len )
+{
+    switch ( type ) {
+    case FRAMING_LENGTH_PREFIX: return 2 + len;
+    case FRAMING_SLIP: return 2 + len * 2;
+    case FRAMING_COBS: return 2 + len + len / ( COBS_BLOCK - 1 );
+    }
+    return 0;
+}
+
+//! Output which may be split into two regions, e.g. around ring buffer wrap.
+struct encode_out
+{
+    char*  p[2];
+    size_t cap[2];
+    size_t pos;
+};
+
+static inline char* out_at( struct encode_out* o, size_t i )
+{
+    return i < o->cap[0] ? o->p[0] + i : o->p[1] + ( i - o->cap[0] );
+}
+
+static inline void out_put( struct encode_out* o, uint8_t c )
+{
+    *out_at( o, o->pos++ ) = (char)c;
+}
+
+static void out_copy( struct encode_out* o, uint8_t const* p, size_t len )
+{
+    size_t head;
+
+    if ( o->pos < o->cap[0] ) {
+        head = o->cap[0] - o->pos;
+        head = head < len ? head : len;
+        memcpy( o->p[0] + o->pos, p, head );
+        o->pos += head, p += head, len -= head;
+    }
+    if ( len ) {
+        memcpy( o->p[1] + ( o->pos - o->cap[0] ), p, len );
+        o->pos += len;
+    }
+}
+
+static size_t encode_impl(
+    enum framing_type  type,
+    struct encode_out* o,
+    uint8_t const*     p,
+    size_t             len )
+{
+    uint8_t const* end = p + len;
+    size_t         code;
+
+    // Exact size is unknown for stuffed framing; require the worst case.
+    if ( framing_encoded_size_max( type, len ) > o->cap[0] + o->cap[1] )
+        return 0;
+
+    switch ( type ) {
+    case FRAMING_LENGTH_PREFIX:
+        uassert( len <= 0xffff );
+        out_put( o, (uint8_t)len );
+        out_put( o, (uint8_t)( len >> 8 ) );
+        out_copy( o, p, len );
+        break;
+
+    case FRAMING_SLIP:
+        // Leading END flushes any line noise accumulated at the receiver.
+        out_put( o, SLIP_END );
+        for ( ; p < end; ++p ) {
+            if ( *p == SLIP_END )
+                out_put( o, SLIP_ESC ), out_put( o, SLIP_ESC_END );
+            else if ( *p == SLIP_ESC )
+                out_put( o, SLIP_ESC ), out_put( o, SLIP_ESC_ESC );
+            else
+                out_put( o, *p );
+        }
+        out_put( o, SLIP_END );
+        break;
+
+    case FRAMING_COBS:
+        code = o->pos++;
+        for ( ; p < end; ++p ) {
+            if ( *p ) {
+                out_put( o, *p );
+                if ( o->pos - code != COBS_BLOCK )
+                    continue;
+
+                // Full block without zero. Next block starts without one.
+                if ( p + 1 == end )
+                    break;
+            }
+            *out_at( o, code ) = (char)( o->pos - code );
+            code               = o->pos++;
+        }
+        *out_at( o, code ) = (char)( o->pos - code );
+        out_put( o, 0 );
+        break;
+    }
+
+    return o->pos;
+}
+
+size_t framing_encode(
+    enum framing_type type,
+    char*             dst,
+    size_t            cap,
+    void const*       payload,
+    size_t            len )
+{
+    struct encode_out o = { { dst, NULL }, { cap, 0 }, 0 };
+
+    uassert( dst || cap == 0 );
+    return encode_impl( type, &o, (uint8_t const*)payload, len );
+}
+
+size_t framing_encode_ring(
+    enum framing_type type,
+    ring_buffer_t*    rb,
+    void const*       payload,
+    size_t            len )
+{
+    struct encode_out o;
+    size_t            n;
+
+    o.p[0]   = ring_buffer_linear_write( rb, &o.cap[0] );
+    o.p[1]   = rb->buff;
+    o.cap[1] = ring_buffer_space( rb ) - o.cap[0];
+    o.pos    = 0;
+
+    n = encode_impl( type, &o, (uint8_t const*)payload, len );
+    ring_buffer_commit( rb, n );
+    return n;
+}
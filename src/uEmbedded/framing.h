@@ -0,0 +1,151 @@
+/*! \brief Packet framing over byte streams.
+    \file framing.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Incremental frame decoder and encoder for length-prefixed, SLIP and
+   COBS framing.
+        Decoder works in place. Frames which are entirely contained in given
+   chunk are decoded inside the chunk itself, and delivered as (ptr, len) view
+   without any copy. Only a frame which spans across chunks is gathered into
+   the carry buffer of the decoder, so partial frames survive across reads.
+   Chunks can be taken from ring buffer, or from a loaned transceiver buffer.
+        Encoder writes a frame straight into given buffer, or into free space of
+   a ring buffer, e.g. TX buffer of buffered_transceiver.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ring_buffer.h"
+#include "transceiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Framing
+//! @{
+
+//! \brief      Framing methods.
+enum framing_type
+{
+    //! \brief      16-bit little endian length followed by payload.
+    FRAMING_LENGTH_PREFIX,
+
+    //! \brief      RFC 1055 SLIP. Frames are delimited by 0xC0.
+    FRAMING_SLIP,
+
+    //! \brief      Consistent overhead byte stuffing. Frames are delimited by
+    //!             zero.
+    FRAMING_COBS
+};
+
+//! \brief      Delivers a decoded frame.
+//! \details    The frame is valid only during the callback. It can be modified
+//!             in place.
+typedef void ( *framing_frame_cb_t )(
+    void* /*obj*/,
+    char* /*frame*/,
+    size_t /*len*/ );
+
+//! \brief      Incremental decoder state.
+struct framing_decoder
+{
+    enum framing_type type;
+
+    //! \brief      Buffer for frames spanning across chunks. Its capacity
+    //!             limits the maximum frame size which can be decoded across
+    //!             chunks.
+    char*  carry;
+    size_t carryCap;
+    size_t carryLen;
+
+    //! \brief      Set when current frame has started in previous chunk.
+    bool bPartial;
+
+    //! \brief      Set when current frame doesn't fit in carry buffer. Frame
+    //!             will be dropped.
+    bool bOverflow;
+
+    //! \brief      SLIP escape, or COBS pending zero.
+    bool bFlag;
+
+    //! \brief      Length prefix header bytes received, or COBS remaining bytes
+    //!             in block.
+    uint8_t count;
+
+    //! \brief      Payload length of current length-prefixed frame.
+    uint16_t length;
+
+    //! \brief      Number of malformed or dropped frames.
+    size_t numErrors;
+};
+
+typedef struct framing_decoder framing_decoder_t;
+
+/*! \brief      Initialize decoder. */
+void framing_decoder_init(
+    framing_decoder_t* d,
+    enum framing_type  type,
+    void*              carry,
+    size_t             carryCap );
+
+/*! \brief      Decode chunk in place.
+    \details    Every byte of given chunk is consumed. Chunk memory is modified.
+    \returns    Number of frames delivered. */
+size_t framing_decode(
+    framing_decoder_t* d,
+    char*              data,
+    size_t             len,
+    framing_frame_cb_t cb,
+    void*              obj );
+
+/*! \brief      Decode every byte in ring buffer, and consume them. */
+size_t framing_decode_ring(
+    framing_decoder_t* d,
+    ring_buffer_t*     rb,
+    framing_frame_cb_t cb,
+    void*              obj );
+
+/*! \brief      Decode loaned receive buffer of transceiver, then release it.
+    \returns    Number of frames delivered, or result of td_loan() if there
+   was no data or it failed. */
+transceiver_result_t framing_decode_loan(
+    framing_decoder_t*   d,
+    transceiver_handle_t h,
+    framing_frame_cb_t   cb,
+    void*                obj );
+
+/*! \brief      Get maximum encoded size of a payload. */
+size_t framing_encoded_size_max( enum framing_type type, size_t len );
+
+/*! \brief      Encode frame into given buffer.
+    \returns    Number of bytes written. 0 if buffer is not large enough. */
+size_t framing_encode(
+    enum framing_type type,
+    char*             dst,
+    size_t            cap,
+    void const*       payload,
+    size_t            len );
+
+/*! \brief      Encode frame straight into free space of ring buffer.
+    \returns    Number of bytes pushed. 0 if there's not enough space. */
+size_t framing_encode_ring(
+    enum framing_type type,
+    ring_buffer_t*    rb,
+    void const*       payload,
+    size_t            len );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,25 +1,87 @@
 #include "fslist.h"
+#include <string.h>
 #include "uassert.h"
+#include "uatomic.h"
 
 typedef struct fslist_node node_t;
 
+static inline void bitmap_set( struct fslist* s, fslist_idx_t idx )
+{
+    if ( s->bitmap )
+        s->bitmap[idx / 64] |= (uint64_t)1 << ( idx % 64 );
+}
+
+static inline void bitmap_clear( struct fslist* s, fslist_idx_t idx )
+{
+    if ( s->bitmap )
+        s->bitmap[idx / 64] &= ~( (uint64_t)1 << ( idx % 64 ) );
+}
+
+//! Tagged free chain top. Low half is index, high half is ABA counter.
+static inline uint64_t tag_of( uint64_t top, fslist_idx_t idx )
+{
+    return ( ( top >> 32 ) + 1 ) << 32 | idx;
+}
+
+static inline fslist_idx_t idx_of_tag( uint64_t top )
+{
+    return ( fslist_idx_t )( top & 0xffffffffu );
+}
+
+//! List whose free chain serves s. Shared lists use the owner's one.
+static inline struct fslist* free_chain_of( struct fslist* s )
+{
+    return s->owner ? s->owner : s;
+}
+
 size_t
 fslist_init( struct fslist* s, void* buff, size_t buffSize, size_t elemSize )
+{
+    return fslist_init_ex( s, buff, buffSize, elemSize, 0 );
+}
+
+size_t fslist_init_ex(
+    struct fslist* s,
+    void*          buff,
+    size_t         buffSize,
+    size_t         elemSize,
+    uint32_t       flags )
 {
     size_t chunkSize = elemSize + sizeof( struct fslist_node );
     size_t it;
     size_t cap;
+    size_t pad = 0, bitmapSize = 0;
 
     s->buff     = (char*)buff;
     s->elemSize = elemSize;
-    cap         = buffSize / chunkSize;
+    s->bitmap   = NULL;
+    s->flags    = flags;
+    s->owner    = NULL;
+
+    if ( flags & FSLIST_FLAG_BITMAP ) {
+        pad = ( sizeof( uint64_t ) - (uintptr_t)buff % sizeof( uint64_t ) )
+              % sizeof( uint64_t );
+
+        // Each node costs 1/8 byte more; adjust for the last partial word.
+        cap = ( buffSize - pad ) * 8 / ( chunkSize * 8 + 1 );
+        while ( cap
+                && pad + ( cap + 63 ) / 64 * 8 + cap * chunkSize > buffSize )
+            --cap;
+
+        bitmapSize = ( cap + 63 ) / 64 * sizeof( uint64_t );
+        s->bitmap  = (uint64_t*)( s->buff + pad );
+        memset( s->bitmap, 0, bitmapSize );
+    }
+    else
+        cap = buffSize / chunkSize;
+
     if ( cap > FSLIST_NUM_MAX_NODE ) {
         uassert( false );
         return 0;
     }
     s->capacity = ( fslist_idx_t )( cap );
-    s->get      = (struct fslist_node*)s->buff;
-    s->data     = s->buff + s->capacity * sizeof( struct fslist_node );
+    s->get      = (struct fslist_node*)( s->buff + pad + bitmapSize );
+    s->data     = (char*)( s->get + s->capacity );
 
     s->head = s->tail = FSLIST_NODEIDX_NONE;
     s->inactive       = 0;
@@ -34,24 +96,73 @@ fslist_init( struct fslist* s, void* buff, size_t buffSize, size_t elemSize )
     }
     s->get[s->capacity - 1].next = FSLIST_NODEIDX_NONE;
 
+    // Free chain is handed over to the tagged top.
+    s->freeTop = tag_of( 0, s->inactive );
+    if ( flags & FSLIST_FLAG_CONCURRENT )
+        s->inactive = FSLIST_NODEIDX_NONE;
+
     return s->capacity;
 }
 
-struct fslist_node* fslist_insert( struct fslist* s, struct fslist_node* n )
+//! Push chain [first, last] linked by next to the concurrent free chain.
+static void push_free_concurrent(
+    struct fslist* s,
+    fslist_idx_t   first,
+    fslist_idx_t   last )
 {
-    node_t*      newNode;
-    fslist_idx_t nidx, newNodeIdx;
+    uint64_t volatile* top = (uint64_t volatile*)&s->freeTop;
+    uint64_t           old = uatomic_load64( top );
 
-    uassert( s->inactive != FSLIST_NODEIDX_NONE );
-    uassert( n == NULL || fslist_node_in_range( s, n ) );
-    uassert( n == NULL || n->isValid );
+    do {
+        s->get[last].next = idx_of_tag( old );
+    } while ( !uatomic_cas64( top, &old, tag_of( old, first ) ) );
+}
+
+struct fslist_node* fslist_alloc_concurrent( struct fslist* s )
+{
+    uint64_t volatile* top;
+    uint64_t           old;
+    fslist_idx_t       idx, next;
+
+    uassert( s->flags & FSLIST_FLAG_CONCURRENT );
+    s   = free_chain_of( s );
+    top = (uint64_t volatile*)&s->freeTop;
+    old = uatomic_load64( top );
+
+    do {
+        idx = idx_of_tag( old );
+        if ( idx == FSLIST_NODEIDX_NONE )
+            return NULL;
 
-    // Allocate new node and insert before given node
-    newNode    = s->get + s->inactive;
-    newNodeIdx = s->inactive;
+        // May read a stale link if the node is popped meanwhile; the counter
+        // makes the CAS fail in that case.
+        next = ( (fslist_idx_t volatile*)&s->get[idx].next )[0];
+    } while ( !uatomic_cas64( top, &old, tag_of( old, next ) ) );
 
-    // Replace inactive node head.
-    s->inactive = newNode->next;
+    s->get[idx].next = s->get[idx].prev = FSLIST_NODEIDX_NONE;
+    return s->get + idx;
+}
+
+void fslist_release_concurrent( struct fslist* s, struct fslist_node* n )
+{
+    fslist_idx_t idx = fslist_idx( s, n );
+
+    uassert( s->flags & FSLIST_FLAG_CONCURRENT );
+    uassert( idx != FSLIST_NODEIDX_NONE && !n->isValid );
+
+    push_free_concurrent( free_chain_of( s ), idx, idx );
+}
+
+void fslist_link(
+    struct fslist*      s,
+    struct fslist_node* n,
+    struct fslist_node* newNode )
+{
+    fslist_idx_t nidx, newNodeIdx = fslist_idx( s, newNode );
+
+    uassert( newNodeIdx != FSLIST_NODEIDX_NONE && !newNode->isValid );
+    uassert( n == NULL || fslist_node_in_range( s, n ) );
+    uassert( n == NULL || n->isValid );
 
     nidx          = fslist_idx( s, n );
     newNode->next = nidx;
@@ -81,11 +192,32 @@ struct fslist_node* fslist_insert( struct fslist* s, struct fslist_node* n )
     }
 
     newNode->isValid = true;
+    bitmap_set( s, newNodeIdx );
     ++s->size;
+}
+
+struct fslist_node* fslist_insert( struct fslist* s, struct fslist_node* n )
+{
+    node_t*        newNode;
+    struct fslist* f = free_chain_of( s );
+
+    if ( s->flags & FSLIST_FLAG_CONCURRENT ) {
+        newNode = fslist_alloc_concurrent( s );
+        uassert( newNode );
+    }
+    else {
+        uassert( f->inactive != FSLIST_NODEIDX_NONE );
+
+        // Allocate new node and replace inactive node head.
+        newNode     = f->get + f->inactive;
+        f->inactive = newNode->next;
+    }
+
+    fslist_link( s, n, newNode );
     return newNode;
 }
 
-void fslist_erase( struct fslist* s, struct fslist_node* n )
+void fslist_unlink( struct fslist* s, struct fslist_node* n )
 {
     fslist_idx_t nidx = fslist_idx( s, n );
 
@@ -93,7 +225,6 @@ void fslist_erase( struct fslist* s, struct fslist_node* n )
     uassert( s->size );
     uassert( n->isValid );
 
-    // Unlink from active list
     if ( n->next != FSLIST_NODEIDX_NONE )
         s->get[n->next].prev = n->prev;
     else
@@ -104,12 +235,351 @@ void fslist_erase( struct fslist* s, struct fslist_node* n )
     else
         s->head = n->next;
 
+    n->next = n->prev = FSLIST_NODEIDX_NONE;
+    n->isValid        = false;
+    bitmap_clear( s, nidx );
+    --s->size;
+}
+
+void fslist_erase( struct fslist* s, struct fslist_node* n )
+{
+    fslist_idx_t nidx = fslist_idx( s, n );
+
+    fslist_unlink( s, n );
+    s = free_chain_of( s );
+
+    if ( s->flags & FSLIST_FLAG_CONCURRENT ) {
+        push_free_concurrent( s, nidx, nidx );
+        return;
+    }
+
     // Link into available
     if ( s->inactive != FSLIST_NODEIDX_NONE )
         s->get[s->inactive].prev = nidx;
     n->next     = s->inactive;
     s->inactive = nidx;
+}
 
-    n->isValid = false;
-    --s->size;
-}
\ No newline at end of file
+size_t fslist_count_range( struct fslist const* s, size_t first, size_t last )
+{
+    size_t   cnt = 0, i;
+    uint64_t w;
+
+    uassert( s->bitmap && s->owner == NULL );
+    uassert( first <= last && last <= s->capacity );
+
+    for ( i = first / 64; i * 64 < last; ++i ) {
+        w = s->bitmap[i];
+        if ( i == first / 64 )
+            w &= ~(uint64_t)0 << ( first % 64 );
+        if ( ( i + 1 ) * 64 > last )
+            w &= ~( ~(uint64_t)0 << ( last % 64 ) );
+        cnt += uemb_popcount64( w );
+    }
+
+    return cnt;
+}
+
+void fslist_init_shared( struct fslist* s, struct fslist* storage )
+{
+    *s      = *storage;
+    s->head = s->tail = FSLIST_NODEIDX_NONE;
+    s->inactive       = FSLIST_NODEIDX_NONE;
+    s->size           = 0;
+    s->freeTop        = tag_of( 0, FSLIST_NODEIDX_NONE );
+    s->owner          = free_chain_of( storage );
+}
+
+//! Detach chain [first, last] from active list. Both ends are inclusive.
+static void
+unlink_chain( struct fslist* s, fslist_idx_t first, fslist_idx_t last )
+{
+    node_t* f = s->get + first;
+    node_t* l = s->get + last;
+
+    if ( f->prev != FSLIST_NODEIDX_NONE )
+        s->get[f->prev].next = l->next;
+    else
+        s->head = l->next;
+
+    if ( l->next != FSLIST_NODEIDX_NONE )
+        s->get[l->next].prev = f->prev;
+    else
+        s->tail = f->prev;
+}
+
+//! Attach chain [first, last] before node at. FSLIST_NODEIDX_NONE appends.
+static void link_chain(
+    struct fslist* s,
+    fslist_idx_t   first,
+    fslist_idx_t   last,
+    fslist_idx_t   at )
+{
+    fslist_idx_t prev = at != FSLIST_NODEIDX_NONE ? s->get[at].prev : s->tail;
+
+    s->get[first].prev = prev;
+    s->get[last].next  = at;
+
+    if ( prev != FSLIST_NODEIDX_NONE )
+        s->get[prev].next = first;
+    else
+        s->head = first;
+
+    if ( at != FSLIST_NODEIDX_NONE )
+        s->get[at].prev = last;
+    else
+        s->tail = last;
+}
+
+//! Invalidate chain [first, last], and push it in front of inactive chain of
+//! the storage owner.
+static size_t release_chain(
+    struct fslist* s,
+    fslist_idx_t   first,
+    fslist_idx_t   last )
+{
+    fslist_idx_t i;
+    size_t       cnt = 0;
+
+    for ( i = first;; i = s->get[i].next ) {
+        s->get[i].isValid = false;
+        bitmap_clear( s, i );
+        ++cnt;
+        if ( i == last )
+            break;
+    }
+
+    s->size            = ( fslist_idx_t )( s->size - cnt );
+    s->get[first].prev = FSLIST_NODEIDX_NONE;
+    s                  = free_chain_of( s );
+
+    if ( s->flags & FSLIST_FLAG_CONCURRENT ) {
+        push_free_concurrent( s, first, last );
+        return cnt;
+    }
+
+    s->get[last].next = s->inactive;
+    if ( s->inactive != FSLIST_NODEIDX_NONE )
+        s->get[s->inactive].prev = last;
+    s->inactive = first;
+    return cnt;
+}
+
+size_t fslist_erase_range(
+    struct fslist*      s,
+    struct fslist_node* first,
+    struct fslist_node* last )
+{
+    fslist_idx_t f = fslist_idx( s, first ), l;
+
+    if ( first == last || f == FSLIST_NODEIDX_NONE )
+        return 0;
+
+    uassert( first->isValid );
+    uassert( last == NULL || last->isValid );
+
+    l = last ? last->prev : s->tail;
+    unlink_chain( s, f, l );
+    return release_chain( s, f, l );
+}
+
+void fslist_clear( struct fslist* s )
+{
+    if ( s->size == 0 )
+        return;
+
+    release_chain( s, s->head, s->tail );
+    s->head = s->tail = FSLIST_NODEIDX_NONE;
+}
+
+size_t fslist_splice(
+    struct fslist*      dst,
+    struct fslist_node* pos,
+    struct fslist*      src,
+    struct fslist_node* first,
+    struct fslist_node* last )
+{
+    fslist_idx_t f, l, i, at;
+    size_t       cnt = 0;
+
+    uassert( dst->get == src->get );
+    if ( first == last || first == NULL )
+        return 0;
+
+    f  = fslist_idx( src, first );
+    l  = last ? last->prev : src->tail;
+    at = fslist_idx( dst, pos );
+    uassert( f != FSLIST_NODEIDX_NONE && first->isValid );
+    uassert( pos == NULL || pos->isValid );
+
+    // Size of the range is needed unless nodes stay in the same list.
+    if ( dst != src ) {
+        for ( i = f;; i = src->get[i].next ) {
+            uassert( i != at );
+            ++cnt;
+            if ( i == l )
+                break;
+        }
+    }
+
+    unlink_chain( src, f, l );
+    link_chain( dst, f, l, at );
+
+    src->size = ( fslist_idx_t )( src->size - cnt );
+    dst->size = ( fslist_idx_t )( dst->size + cnt );
+    return cnt;
+}
+
+//! Merge two sorted chains linked by next. Takes from a on ties.
+static fslist_idx_t merge_chain(
+    struct fslist*   s,
+    fslist_idx_t     a,
+    fslist_idx_t     b,
+    fslist_compare_t cmp )
+{
+    fslist_idx_t  head = FSLIST_NODEIDX_NONE;
+    fslist_idx_t* link = &head;
+
+    while ( a != FSLIST_NODEIDX_NONE && b != FSLIST_NODEIDX_NONE ) {
+        if ( cmp( s->data + (size_t)b * s->elemSize,
+                  s->data + (size_t)a * s->elemSize )
+             < 0 ) {
+            *link = b;
+            b     = s->get[b].next;
+        }
+        else {
+            *link = a;
+            a     = s->get[a].next;
+        }
+        link = &s->get[*link].next;
+    }
+
+    *link = a != FSLIST_NODEIDX_NONE ? a : b;
+    return head;
+}
+
+void fslist_sort( struct fslist* s, fslist_compare_t cmp )
+{
+    // bins[i] holds a sorted run of 2^i nodes, earlier ones in higher bins.
+    fslist_idx_t bins[sizeof( fslist_idx_t ) * 8 + 1];
+    fslist_idx_t i, n, carry, prev;
+    size_t       k;
+
+    uassert( cmp );
+    if ( s->size < 2 )
+        return;
+
+    for ( k = 0; k < sizeof( bins ) / sizeof( *bins ); ++k )
+        bins[k] = FSLIST_NODEIDX_NONE;
+
+    // Bottom-up merge sort over next links.
+    for ( n = s->head; n != FSLIST_NODEIDX_NONE; ) {
+        carry              = n;
+        n                  = s->get[n].next;
+        s->get[carry].next = FSLIST_NODEIDX_NONE;
+
+        for ( k = 0; bins[k] != FSLIST_NODEIDX_NONE; ++k ) {
+            carry   = merge_chain( s, bins[k], carry, cmp );
+            bins[k] = FSLIST_NODEIDX_NONE;
+        }
+        bins[k] = carry;
+    }
+
+    carry = FSLIST_NODEIDX_NONE;
+    for ( k = 0; k < sizeof( bins ) / sizeof( *bins ); ++k )
+        if ( bins[k] != FSLIST_NODEIDX_NONE )
+            carry = merge_chain( s, bins[k], carry, cmp );
+
+    // Restore back links
+    s->head = carry;
+    for ( prev = FSLIST_NODEIDX_NONE, i = carry; i != FSLIST_NODEIDX_NONE;
+          prev = i, i = s->get[i].next )
+        s->get[i].prev = prev;
+    s->tail = prev;
+}
+
+static void swap_data( struct fslist* s, size_t a, size_t b )
+{
+    char   tmp[64];
+    char*  pa = s->data + a * s->elemSize;
+    char*  pb = s->data + b * s->elemSize;
+    size_t left, n;
+
+    for ( left = s->elemSize; left; left -= n, pa += n, pb += n ) {
+        n = left < sizeof tmp ? left : sizeof tmp;
+        memcpy( tmp, pa, n );
+        memcpy( pa, pb, n );
+        memcpy( pb, tmp, n );
+    }
+}
+
+size_t fslist_compact(
+    struct fslist*   s,
+    fslist_compare_t cmp,
+    fslist_idx_t*    remap )
+{
+    fslist_idx_t i, j, k, t;
+
+    if ( cmp )
+        fslist_sort( s, cmp );
+
+    // Destination of each node is kept in prev field, which is rebuilt later.
+    for ( k = 0, i = s->head; i != FSLIST_NODEIDX_NONE; i = s->get[i].next )
+        s->get[i].prev = k++;
+    i = s->flags & FSLIST_FLAG_CONCURRENT ? idx_of_tag( s->freeTop )
+                                          : s->inactive;
+    for ( ; i != FSLIST_NODEIDX_NONE; i = s->get[i].next )
+        s->get[i].prev = k++;
+    uassert( k == s->capacity );
+
+    if ( remap ) {
+        for ( i = 0; i < s->capacity; ++i )
+            remap[i] = s->get[i].isValid ? s->get[i].prev : FSLIST_NODEIDX_NONE;
+    }
+
+    // Follow each permutation cycle
+    for ( i = 0; i < s->capacity; ++i ) {
+        while ( ( j = s->get[i].prev ) != i ) {
+            swap_data( s, i, j );
+            t              = s->get[j].prev;
+            s->get[j].prev = j;
+            s->get[i].prev = t;
+        }
+    }
+
+    // Relink in memory order
+    for ( i = 0; i < s->capacity; ++i ) {
+        s->get[i].isValid = i < s->size;
+        s->get[i].prev    = ( fslist_idx_t )( i - 1 );
+        s->get[i].next    = ( fslist_idx_t )( i + 1 );
+    }
+
+    if ( s->size ) {
+        s->head              = 0;
+        s->tail              = ( fslist_idx_t )( s->size - 1 );
+        s->get[s->tail].next = FSLIST_NODEIDX_NONE;
+    }
+    else
+        s->head = s->tail = FSLIST_NODEIDX_NONE;
+
+    if ( s->size < s->capacity ) {
+        s->inactive                  = s->size;
+        s->get[s->size].prev         = FSLIST_NODEIDX_NONE;
+        s->get[s->capacity - 1].next = FSLIST_NODEIDX_NONE;
+    }
+    else
+        s->inactive = FSLIST_NODEIDX_NONE;
+
+    if ( s->flags & FSLIST_FLAG_CONCURRENT ) {
+        s->freeTop  = tag_of( s->freeTop, s->inactive );
+        s->inactive = FSLIST_NODEIDX_NONE;
+    }
+
+    if ( s->bitmap ) {
+        memset( s->bitmap, 0, ( s->capacity + 63 ) / 64 * sizeof( uint64_t ) );
+        for ( i = 0; i < s->size; ++i )
+            bitmap_set( s, i );
+    }
+
+    return s->size;
+}
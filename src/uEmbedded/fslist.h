@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "assert.h"
+#include "macro.h"
+#include "uassert.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,6 +24,11 @@ extern "C" {
 #    define FSLIST_INDEX_TYPE uint16_t
 #endif
 
+//! \brief      Number of hops FSLIST_FOREACH() prefetches ahead.
+#ifndef FSLIST_PREFETCH_DISTANCE
+#    define FSLIST_PREFETCH_DISTANCE 4
+#endif
+
 //! \brief       16bit unsigned integer wil be used to indicate list node index.
 //!             Therefore only 65535 nodes can be allocated for single list.
 typedef FSLIST_INDEX_TYPE fslist_idx_t;
@@ -68,6 +75,33 @@ struct fslist
     //! \brief      Easy accessor for referencing element data. This member is
     //! for internal use !
     char* data;
+
+    //! \brief      Optional validity bitmap. Bit i is set while node i is
+    //! active. NULL if the list was initialized without FSLIST_FLAG_BITMAP.
+    uint64_t* bitmap;
+
+    //! \brief      Tagged top of free chain in concurrent mode, as
+    //! [ABA counter:32 | index:32]. inactive stays empty in this mode.
+    uint64_t freeTop;
+
+    //! \brief      FSLIST_FLAG_* values given on initialization.
+    uint32_t flags;
+
+    //! \brief      List which owns the free chain of shared storage. NULL for
+    //! the owner itself. See fslist_init_shared().
+    struct fslist* owner;
+};
+
+//! \brief      Options for fslist_init_ex()
+enum
+{
+    //! \brief      Keep validity bitmap next to nodes, which lets scanning
+    //!             skip 64 inactive nodes at once.
+    FSLIST_FLAG_BITMAP = 0x01,
+
+    //! \brief      Keep free chain as a lock-free stack. See
+    //!             fslist_alloc_concurrent().
+    FSLIST_FLAG_CONCURRENT = 0x02
 };
 
 //! \brief      List node struct.
@@ -95,6 +129,19 @@ enum
 size_t
 fslist_init( struct fslist* s, void* buff, size_t buffSize, size_t elemSize );
 
+/*! \brief      Initiate node struct with options.
+    \details    With FSLIST_FLAG_BITMAP, the bitmap is placed at the front of
+   the buffer, thus slightly less nodes are available from the same buffer.
+    \param      flags
+                 Combination of FSLIST_FLAG_* values.
+    \returns    Number of actual available nodes. */
+size_t fslist_init_ex(
+    struct fslist* s,
+    void*          buff,
+    size_t         buffSize,
+    size_t         elemSize,
+    uint32_t       flags );
+
 /*! brief       Checks if given node is the node of given list s */
 static inline bool
 fslist_node_in_range( struct fslist const* s, struct fslist_node const* n )
@@ -102,6 +149,15 @@ fslist_node_in_range( struct fslist const* s, struct fslist_node const* n )
     return n < s->get + s->capacity && s->get <= n;
 }
 
+/*! \brief      Initiate a list which shares node storage with another list.
+    \details    Both lists use the same nodes and data, but keep their own
+   active chains. The new list starts empty; nodes come in by fslist_splice()
+   or insertion. Free nodes stay in the chain of the storage owner, thus nodes
+   erased from any sharing list return to the owner's capacity. Used to move
+   batches of nodes between lists, e.g. expired timers into a pending list,
+   without copy. */
+void fslist_init_shared( struct fslist* s, struct fslist* storage );
+
 /*! \brief      Get index of list node */
 static inline fslist_idx_t
 fslist_idx( struct fslist const* s, struct fslist_node const* n )
@@ -142,19 +198,105 @@ static inline void* fslist_data( struct fslist* s, struct fslist_node const* n )
                : NULL;
 }
 
+/*! \brief      Get data of active node by index.
+    \details    Unlike fslist_data(), validity is checked by uassert only,
+   thus the check disappears in release builds. */
+static inline void* fslist_at( struct fslist* s, fslist_idx_t idx )
+{
+    uassert( idx < s->capacity && s->get[idx].isValid );
+    return s->data + (size_t)idx * s->elemSize;
+}
+
+//! \brief      Step to next index, and prefetch node and data of it. For
+//!             FSLIST_FOREACH() internal use.
+static inline fslist_idx_t
+fslist_prefetch_next_( struct fslist const* s, fslist_idx_t idx )
+{
+    if ( idx == FSLIST_NODEIDX_NONE )
+        return idx;
+
+    idx = s->get[idx].next;
+    if ( idx != FSLIST_NODEIDX_NONE ) {
+        UEMB_PREFETCH( s->get + idx );
+        UEMB_PREFETCH( s->data + (size_t)idx * s->elemSize );
+    }
+    return idx;
+}
+
+//! \brief      Start prefetching from head. For FSLIST_FOREACH() internal
+//!             use.
+//! \returns    Index FSLIST_PREFETCH_DISTANCE hops ahead of head.
+static inline fslist_idx_t fslist_prefetch_begin_( struct fslist const* s )
+{
+    fslist_idx_t idx = s->head;
+    int          i;
+
+    for ( i = 0; i < FSLIST_PREFETCH_DISTANCE; ++i )
+        idx = fslist_prefetch_next_( s, idx );
+    return idx;
+}
+
+/*! \brief      Iterate active node indices in list order.
+    \details    Loop body is inlined, unlike fslist_forEach(). Nodes and data
+   are prefetched FSLIST_PREFETCH_DISTANCE hops ahead. Use fslist_at() or
+   FSLIST_AT() to access the data. The current node must not be erased in the
+   body. s is evaluated multiple times.
+    \code
+        FSLIST_FOREACH( &list, i ) { sum += *FSLIST_AT( &list, int, i ); }
+    \endcode */
+#define FSLIST_FOREACH( s, idx )                                               \
+    for ( fslist_idx_t idx          = ( s )->head,                             \
+                       idx##_ahead_ = fslist_prefetch_begin_( s );             \
+          idx != FSLIST_NODEIDX_NONE;                                          \
+          idx          = ( s )->get[idx].next,                                 \
+          idx##_ahead_ = fslist_prefetch_next_( s, idx##_ahead_ ) )
+
+//! \brief      Typed data access of active node.
+#define FSLIST_AT( s, type, idx ) ( (type*)fslist_at( s, idx ) )
+
 /*! \brief      Apply same process to all active nodes iteratively. */
 static inline void
 fslist_forEach( struct fslist* s, void ( *callback )( void* ) )
 {
-    struct fslist_node* n;
+    FSLIST_FOREACH( s, i )
+    {
+        callback( fslist_at( s, i ) );
+    }
+}
 
-    if ( s->size == 0 )
+/*! \brief      Apply same process to all active nodes in memory order.
+    \details    Visits nodes in order of storage instead of list order, which
+   avoids pointer chasing. With validity bitmap, inactive nodes are skipped 64
+   at a time. Nodes must not be inserted or erased during iteration.
+        Validity belongs to the storage, so active nodes of every list sharing
+   it by fslist_init_shared() are visited. Thus s must be the storage owner. */
+static inline void
+fslist_forEach_unordered( struct fslist* s, void ( *callback )( void* ) )
+{
+    size_t   i, nwords;
+    uint64_t w;
+
+    uassert( s->owner == NULL );
+
+    if ( s->bitmap == NULL ) {
+        for ( i = 0; i < s->capacity; ++i )
+            if ( s->get[i].isValid )
+                callback( s->data + i * s->elemSize );
         return;
+    }
 
-    for ( n = s->get + s->head; n; n = fslist_next( s, n ) )
-        callback( fslist_data( s, n ) );
+    nwords = ( s->capacity + 63 ) / 64;
+    for ( i = 0; i < nwords; ++i ) {
+        for ( w = s->bitmap[i]; w; w &= w - 1 )
+            callback( s->data + ( i * 64 + uemb_ctz64( w ) ) * s->elemSize );
+    }
 }
 
+/*! \brief      Count active nodes in index range [first, last). Requires
+   validity bitmap. Like fslist_forEach_unordered(), counts nodes of every
+   sharing list, and s must be the storage owner. */
+size_t fslist_count_range( struct fslist const* s, size_t first, size_t last );
+
 /*! \brief      Insert new node previous given node. Pass nullptr to push back.
  */
 struct fslist_node* fslist_insert( struct fslist* s, struct fslist_node* n );
@@ -162,6 +304,96 @@ struct fslist_node* fslist_insert( struct fslist* s, struct fslist_node* n );
 /*! \brief      Remove given node from list. */
 void fslist_erase( struct fslist* s, struct fslist_node* n );
 
+/*! \brief      Remove nodes in range [first, last) of list order.
+    \param      last
+                 End of range, exclusive. NULL to erase until the tail.
+    \details    The range is unlinked and moved to inactive chain at once.
+   Each erased node is still visited once to invalidate it.
+    \returns    Number of erased nodes. */
+size_t fslist_erase_range(
+    struct fslist*      s,
+    struct fslist_node* first,
+    struct fslist_node* last );
+
+/*! \brief      Remove all nodes.
+    \details    Whole active chain is moved to inactive chain in O(1) relinks.
+   Validity flags of active nodes are cleared by a single pass. */
+void fslist_clear( struct fslist* s );
+
+/*! \brief      Move nodes in range [first, last) of src before pos of dst.
+    \details    dst and src must be the same list, or lists which share
+   storage. See fslist_init_shared(). Node indices and data don't move, thus
+   handles to moved nodes stay valid.
+    \param      pos
+                 Node of dst to insert before. NULL to append at the back.
+                Must not be inside the range.
+    \param      last
+                 End of range, exclusive. NULL to move until the tail of src.
+    \returns    Number of nodes moved from src to dst. Moving within the same
+   list takes O(1), and returns 0. */
+size_t fslist_splice(
+    struct fslist*      dst,
+    struct fslist_node* pos,
+    struct fslist*      src,
+    struct fslist_node* first,
+    struct fslist_node* last );
+
+/*! \brief      Take a free node. Safe to call from any thread.
+    \details    Requires FSLIST_FLAG_CONCURRENT. The node is not linked to the
+   active list; fill its data, then hand it to the owner thread which calls
+   fslist_link(). The free chain is a stack whose top carries an ABA counter,
+   thus concurrent pops and pushes don't need a lock.
+    \returns    Detached node, or NULL if no node is available. */
+struct fslist_node* fslist_alloc_concurrent( struct fslist* s );
+
+/*! \brief      Return a detached node to the free chain. Safe to call from
+   any thread.
+    \details    Node must be allocated by fslist_alloc_concurrent() and not
+   linked, or unlinked by fslist_unlink() beforehand. */
+void fslist_release_concurrent( struct fslist* s, struct fslist_node* n );
+
+/*! \brief      Link detached node into active list before pos. NULL appends.
+    \details    Active list is not thread safe; only the owner thread may
+   call this, fslist_unlink() and other functions which touch active nodes. */
+void fslist_link(
+    struct fslist*      s,
+    struct fslist_node* pos,
+    struct fslist_node* n );
+
+/*! \brief      Unlink node from active list without freeing it.
+    \details    Node can be relinked, or released by
+   fslist_release_concurrent() from another thread. */
+void fslist_unlink( struct fslist* s, struct fslist_node* n );
+
+/*! \brief      Compares two elements. Returns negative, zero or positive
+   like qsort(). */
+typedef int ( *fslist_compare_t )( void const*, void const* );
+
+/*! \brief      Sort active nodes by relinking. Stable.
+    \details    Only links are changed; node indices and data don't move. */
+void fslist_sort( struct fslist* s, fslist_compare_t cmp );
+
+/*! \brief      Move data so that list order matches memory order.
+    \details    After compaction, active nodes occupy indices [0, size) in
+   list order, thus iteration walks memory sequentially. Data is permuted in
+   place by swapping, which requires elements to be trivially relocatable.
+   Existing node pointers and indices become invalid; use remap to fix up
+   external handles. In concurrent mode, no node may be detached and no other
+   thread may access the list meanwhile. Lists sharing the storage must be
+   empty, as their nodes would be moved.
+    \param      cmp
+                 If given, nodes are sorted before compaction. NULL to keep
+                current order.
+    \param      remap
+                 Optional array of capacity entries. remap[old index] receives
+                new index of each active node, FSLIST_NODEIDX_NONE for inactive
+                ones.
+    \returns    Number of active nodes. */
+size_t fslist_compact(
+    struct fslist*   s,
+    fslist_compare_t cmp,
+    fslist_idx_t*    remap );
+
 //! @}
 //! @}
 
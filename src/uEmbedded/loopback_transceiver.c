@@ -0,0 +1,234 @@
+#include "loopback_transceiver.h"
+#include <string.h>
+#include "uassert.h"
+
+typedef struct loopback_endpoint endpoint_t;
+
+//! Header of a segment on the wire. Followed by payload.
+struct segment
+{
+    size_t arrival;
+    size_t len;
+};
+
+static inline size_t min_size( size_t a, size_t b ) { return a < b ? a : b; }
+
+static uint32_t next_random( loopback_link_t* s )
+{
+    // xorshift32
+    uint32_t x = s->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return s->rng = x;
+}
+
+static inline endpoint_t* peer_of( endpoint_t* ep )
+{
+    loopback_link_t* s = ep->link;
+    return s->ep[1].wire.buff ? s->ep + ( ep == s->ep ) : s->ep;
+}
+
+static void refill( endpoint_t* ep, size_t now )
+{
+    struct loopback_config const* cfg = &ep->link->cfg;
+    size_t                        elapsed, acc, fill;
+
+    elapsed        = now - ep->lastRefill;
+    ep->lastRefill = now;
+
+    // Long idle time fills the bucket anyway. Avoids overflow.
+    fill = cfg->burst * cfg->ticksPerSecond / cfg->bytesPerSecond;
+    if ( elapsed > fill ) {
+        ep->tokens    = cfg->burst;
+        ep->tokenFrac = 0;
+        return;
+    }
+
+    acc           = elapsed * cfg->bytesPerSecond + ep->tokenFrac;
+    ep->tokens   += acc / cfg->ticksPerSecond;
+    ep->tokenFrac = acc % cfg->ticksPerSecond;
+    if ( ep->tokens >= cfg->burst ) {
+        ep->tokens    = cfg->burst;
+        ep->tokenFrac = 0;
+    }
+}
+
+static transceiver_result_t
+write_impl( void* obj, char const* wrbuf, size_t wrcnt )
+{
+    endpoint_t*                   ep   = (endpoint_t*)obj;
+    endpoint_t*                   peer = peer_of( ep );
+    loopback_link_t*              s    = ep->link;
+    struct loopback_config const* cfg  = &s->cfg;
+    struct segment                seg;
+    size_t                        now, done = 0, len, space;
+
+    if ( ep->bClosed || peer->bClosed )
+        return TRANSCEIVER_CLOSED;
+
+    now = loopback_now( s );
+    if ( cfg->bytesPerSecond ) {
+        refill( ep, now );
+        wrcnt = min_size( wrcnt, ep->tokens );
+    }
+
+    while ( done < wrcnt ) {
+        len   = cfg->maxSegment ? cfg->maxSegment : wrcnt;
+        len   = min_size( len, wrcnt - done );
+        space = ring_buffer_space( &peer->wire );
+
+        // Dropped segments occupy the line as well; they just never arrive.
+        if ( cfg->dropPpm && next_random( s ) % 1000000 < cfg->dropPpm ) {
+            ++ep->stats.numDropped;
+            done += len;
+            continue;
+        }
+
+        if ( space <= sizeof seg )
+            break;
+        len = min_size( len, space - sizeof seg );
+
+        seg.arrival = now + cfg->latency;
+        if ( cfg->jitter )
+            seg.arrival += next_random( s ) % ( cfg->jitter + 1 );
+
+        // Jitter never reorders segments.
+        if ( seg.arrival < peer->lastArrival )
+            seg.arrival = peer->lastArrival;
+        peer->lastArrival = seg.arrival;
+
+        seg.len = len;
+        ring_buffer_write( &peer->wire, &seg, sizeof seg );
+        ring_buffer_write( &peer->wire, wrbuf + done, len );
+        ++ep->stats.numSegments;
+        done += len;
+    }
+
+    if ( cfg->bytesPerSecond )
+        ep->tokens -= done;
+    ep->stats.bytesWritten += done;
+    return (transceiver_result_t)done;
+}
+
+static transceiver_result_t
+read_impl( void* obj, char* rdbuf, size_t rdcnt )
+{
+    endpoint_t*    ep    = (endpoint_t*)obj;
+    size_t         now   = loopback_now( ep->link );
+    size_t         total = 0, n;
+    struct segment seg;
+
+    if ( ep->bClosed )
+        return TRANSCEIVER_CLOSED;
+
+    while ( total < rdcnt ) {
+        if ( ep->rxRemain == 0 ) {
+            if ( ring_buffer_size( &ep->wire ) == 0 )
+                break;
+
+            ring_buffer_peek( &ep->wire, &seg, sizeof seg );
+            if ( seg.arrival > now )
+                break;
+
+            ring_buffer_consume( &ep->wire, sizeof seg );
+            ep->rxRemain = seg.len;
+        }
+
+        n = min_size( ep->rxRemain, rdcnt - total );
+        ring_buffer_read( &ep->wire, rdbuf + total, n );
+        ep->rxRemain -= n;
+        total += n;
+    }
+
+    if ( total == 0 && peer_of( ep )->bClosed
+         && ring_buffer_size( &ep->wire ) == 0 )
+        return TRANSCEIVER_CLOSED;
+
+    ep->stats.bytesRead += total;
+    return (transceiver_result_t)total;
+}
+
+static transceiver_result_t ioctl_impl( void* obj, intptr_t cmd )
+{
+    (void)obj;
+    return cmd == TRANSCEIVER_IOCTL_FLUSH ? TRANSCEIVER_OK
+                                          : TRANSCEIVER_NOT_SUPPORTED;
+}
+
+static transceiver_result_t close_impl( void* obj )
+{
+    ( (endpoint_t*)obj )->bClosed = true;
+    return TRANSCEIVER_OK;
+}
+
+static transceiver_vtable_t const g_vtable = { read_impl,
+                                               write_impl,
+                                               ioctl_impl,
+                                               close_impl,
+                                               NULL,
+                                               NULL,
+                                               NULL,
+                                               NULL };
+
+void loopback_init(
+    loopback_link_t*              s,
+    struct loopback_config const* cfg,
+    void*                         wire0,
+    size_t                        wire0Size,
+    void*                         wire1,
+    size_t                        wire1Size )
+{
+    int i;
+
+    uassert( s && wire0 && wire0Size > sizeof( struct segment ) + 1 );
+    uassert( wire1 == NULL || wire1Size > sizeof( struct segment ) + 1 );
+
+    memset( s, 0, sizeof( *s ) );
+    if ( cfg )
+        s->cfg = *cfg;
+
+    if ( s->cfg.ticksPerSecond == 0 )
+        s->cfg.ticksPerSecond = 1000;
+    if ( s->cfg.burst == 0 )
+        s->cfg.burst = s->cfg.bytesPerSecond / 100 + 1;
+    s->rng = s->cfg.seed ? s->cfg.seed : 0x2545F491;
+
+    ring_buffer_init( &s->ep[0].wire, wire0, wire0Size );
+    if ( wire1 )
+        ring_buffer_init( &s->ep[1].wire, wire1, wire1Size );
+
+    for ( i = 0; i < 2; ++i ) {
+        s->ep[i].vt_    = &g_vtable;
+        s->ep[i].link   = s;
+        s->ep[i].tokens = s->cfg.burst;
+    }
+}
+
+void loopback_set_clock(
+    loopback_link_t*    s,
+    loopback_clock_cb_t clock,
+    void*               obj )
+{
+    int i;
+
+    s->clock    = clock;
+    s->clockObj = obj;
+
+    for ( i = 0; i < 2; ++i )
+        s->ep[i].lastRefill = loopback_now( s );
+}
+
+size_t loopback_next_arrival( loopback_link_t* s, int index )
+{
+    endpoint_t*    ep = s->ep + ( index & 1 );
+    struct segment seg;
+
+    if ( ep->rxRemain )
+        return 0;
+    if ( ep->wire.buff == NULL || ring_buffer_size( &ep->wire ) == 0 )
+        return (size_t)-1;
+
+    ring_buffer_peek( &ep->wire, &seg, sizeof seg );
+    return seg.arrival;
+}
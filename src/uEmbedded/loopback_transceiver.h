@@ -0,0 +1,166 @@
+/*! \brief Simulated link with configurable latency and bandwidth.
+    \file loopback_transceiver.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        In-process link between two transceiver endpoints, which behaves like a
+   slow serial line or a lossy network. Data written on one endpoint is read
+   from the other, after configured latency.
+        Writes are limited by token bucket of given bandwidth and by the space
+   on the wire, thus they are partially accepted like a real non-blocking
+   device. Written data is split into segments, each of which can be dropped
+   or delayed by random jitter. Segments are never reordered.
+        Time is driven by a clock callback, or by loopback_advance() when
+   there's no callback. Unit of time is arbitrary, and is converted by
+   ticksPerSecond.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ring_buffer.h"
+#include "transceiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Loopback_Transceiver
+//! @{
+
+//! \brief      Link characteristics. Zero-initialized config is an ideal link.
+struct loopback_config
+{
+    //! \brief      Bandwidth of each direction. 0 for unlimited.
+    size_t bytesPerSecond;
+
+    //! \brief      Bytes can be written at once. Defaults to 10ms of bandwidth.
+    size_t burst;
+
+    //! \brief      Time units per second. Defaults to 1000.
+    size_t ticksPerSecond;
+
+    //! \brief      Base delay of every segment.
+    size_t latency;
+
+    //! \brief      Maximum random delay added to latency.
+    size_t jitter;
+
+    //! \brief      Probability to drop each segment, in parts per million.
+    uint32_t dropPpm;
+
+    //! \brief      Writes are split into segments of this size. 0 to keep.
+    size_t maxSegment;
+
+    //! \brief      Random seed. Same seed reproduces same drops and jitter.
+    uint32_t seed;
+};
+
+//! \brief      Returns current time.
+typedef size_t ( *loopback_clock_cb_t )( void* /*obj*/ );
+
+//! \brief      Traffic counters of an endpoint.
+struct loopback_stats
+{
+    size_t bytesWritten;
+    size_t bytesRead;
+    size_t numSegments;
+    size_t numDropped;
+};
+
+struct loopback_link;
+
+//! \brief      One side of the link.
+struct loopback_endpoint
+{
+    //! \brief      Must be placed at first. See transceiver_handle_t.
+    transceiver_vtable_t const* vt_;
+
+    struct loopback_link* link;
+
+    //! \brief      Segments in flight toward this endpoint.
+    ring_buffer_t wire;
+    size_t        rxRemain;
+    size_t        lastArrival;
+
+    // Token bucket of outgoing direction
+    size_t tokens;
+    size_t tokenFrac;
+    size_t lastRefill;
+
+    bool bClosed;
+
+    struct loopback_stats stats;
+};
+
+//! \brief      Link descriptor.
+struct loopback_link
+{
+    struct loopback_config   cfg;
+    loopback_clock_cb_t      clock;
+    void*                    clockObj;
+    size_t                   now;
+    uint32_t                 rng;
+    struct loopback_endpoint ep[2];
+};
+
+typedef struct loopback_link loopback_link_t;
+
+/*! \brief      Initialize link.
+    \param      cfg
+                 Link characteristics. NULL for ideal link.
+    \param      wire0
+                 Buffer which holds segments in flight toward endpoint 0,
+                including per-segment header.
+    \param      wire1
+                 Same for endpoint 1. If NULL, endpoint 0 is looped back to
+                itself, and endpoint 1 can't be used. */
+void loopback_init(
+    loopback_link_t*              s,
+    struct loopback_config const* cfg,
+    void*                         wire0,
+    size_t                        wire0Size,
+    void*                         wire1,
+    size_t                        wire1Size );
+
+/*! \brief      Get transceiver handle of endpoint 0 or 1. */
+static inline transceiver_handle_t
+loopback_endpoint( loopback_link_t* s, int index )
+{
+    return (transceiver_handle_t)( s->ep + ( index & 1 ) );
+}
+
+/*! \brief      Use real clock instead of virtual one. */
+void loopback_set_clock(
+    loopback_link_t*    s,
+    loopback_clock_cb_t clock,
+    void*               obj );
+
+/*! \brief      Advance virtual clock. */
+static inline void loopback_advance( loopback_link_t* s, size_t dt )
+{
+    s->now += dt;
+}
+
+/*! \brief      Get current time of the link. */
+static inline size_t loopback_now( loopback_link_t const* s )
+{
+    return s->clock ? s->clock( s->clockObj ) : s->now;
+}
+
+/*! \brief      Get arrival time of next segment toward given endpoint.
+    \returns    -1 if nothing is in flight. */
+size_t loopback_next_arrival( loopback_link_t* s, int index );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,194 @@
+#include "lz_block.h"
+#include <string.h>
+#include "uassert.h"
+
+enum
+{
+    MIN_MATCH  = 4,
+    MAX_NIBBLE = 15
+};
+
+static inline uint32_t read32( uint8_t const* p )
+{
+    uint32_t v;
+    memcpy( &v, p, sizeof v );
+    return v;
+}
+
+static inline uint32_t hash32( uint32_t v )
+{
+    return ( v * 2654435761u ) >> ( 32 - LZ_HASH_LOG );
+}
+
+//! Writes extended length. Returns NULL if it doesn't fit.
+static uint8_t* put_length( uint8_t* op, uint8_t* oend, size_t len )
+{
+    for ( ; len >= 255; len -= 255 ) {
+        if ( op == oend )
+            return NULL;
+        *op++ = 255;
+    }
+    if ( op == oend )
+        return NULL;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+//! Emits one sequence. Match length 0 marks the last, literal-only sequence.
+static uint8_t* put_sequence(
+    uint8_t*       op,
+    uint8_t*       oend,
+    uint8_t const* lit,
+    size_t         litLen,
+    size_t         offset,
+    size_t         matchLen )
+{
+    size_t ml = matchLen ? matchLen - MIN_MATCH : 0;
+
+    if ( op == oend )
+        return NULL;
+    *op++ = (uint8_t)( ( litLen < MAX_NIBBLE ? litLen : MAX_NIBBLE ) << 4
+                       | ( ml < MAX_NIBBLE ? ml : MAX_NIBBLE ) );
+
+    if ( litLen >= MAX_NIBBLE
+         && !( op = put_length( op, oend, litLen - MAX_NIBBLE ) ) )
+        return NULL;
+
+    if ( (size_t)( oend - op ) < litLen )
+        return NULL;
+    memcpy( op, lit, litLen );
+    op += litLen;
+
+    if ( matchLen == 0 )
+        return op;
+
+    if ( oend - op < 2 )
+        return NULL;
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)( offset >> 8 );
+
+    if ( ml >= MAX_NIBBLE )
+        op = put_length( op, oend, ml - MAX_NIBBLE );
+    return op;
+}
+
+size_t lz_compress(
+    void const* src,
+    size_t      srcLen,
+    void*       dst,
+    size_t      dstCap,
+    void*       workmem )
+{
+    uint8_t const* base   = (uint8_t const*)src;
+    uint8_t const* ip     = base;
+    uint8_t const* anchor = base;
+    uint8_t const* iend   = base + srcLen;
+    uint8_t const* ref;
+    uint8_t*       op    = (uint8_t*)dst;
+    uint8_t*       oend  = op + dstCap;
+    uint16_t*      table = (uint16_t*)workmem;
+    uint32_t       h;
+    size_t         len;
+
+    uassert( srcLen <= LZ_MAX_BLOCK );
+    uassert( workmem );
+
+    // Stale entries are harmless, as every candidate is verified.
+    memset( table, 0, LZ_WORKMEM_SIZE );
+
+    while ( iend - ip >= MIN_MATCH ) {
+        h        = hash32( read32( ip ) );
+        ref      = base + table[h];
+        table[h] = (uint16_t)( ip - base );
+
+        if ( ref >= ip || read32( ref ) != read32( ip ) ) {
+            ++ip;
+            continue;
+        }
+
+        len = MIN_MATCH;
+        while ( ip + len < iend && ref[len] == ip[len] )
+            ++len;
+
+        op = put_sequence(
+            op,
+            oend,
+            anchor,
+            (size_t)( ip - anchor ),
+            (size_t)( ip - ref ),
+            len );
+        if ( op == NULL )
+            return 0;
+
+        ip += len;
+        anchor = ip;
+    }
+
+    op = put_sequence( op, oend, anchor, (size_t)( iend - anchor ), 0, 0 );
+    return op ? (size_t)( op - (uint8_t*)dst ) : 0;
+}
+
+//! Reads extended length. Returns NULL on truncated input.
+static uint8_t const*
+get_length( uint8_t const* ip, uint8_t const* iend, size_t* len )
+{
+    uint8_t b;
+
+    do {
+        if ( ip == iend )
+            return NULL;
+        b = *ip++;
+        *len += b;
+    } while ( b == 255 );
+
+    return ip;
+}
+
+size_t
+lz_decompress( void const* src, size_t srcLen, void* dst, size_t dstCap )
+{
+    uint8_t const* ip   = (uint8_t const*)src;
+    uint8_t const* iend = ip + srcLen;
+    uint8_t*       op   = (uint8_t*)dst;
+    uint8_t*       oend = op + dstCap;
+    uint8_t const* ref;
+    size_t         len, offset;
+    uint8_t        token;
+
+    while ( ip < iend ) {
+        token = *ip++;
+
+        len = token >> 4;
+        if ( len == MAX_NIBBLE && !( ip = get_length( ip, iend, &len ) ) )
+            return LZ_ERROR;
+        if ( (size_t)( iend - ip ) < len || (size_t)( oend - op ) < len )
+            return LZ_ERROR;
+        memcpy( op, ip, len );
+        ip += len;
+        op += len;
+
+        // Last sequence has no match part.
+        if ( ip == iend )
+            break;
+
+        if ( iend - ip < 2 )
+            return LZ_ERROR;
+        offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+
+        len = token & MAX_NIBBLE;
+        if ( len == MAX_NIBBLE && !( ip = get_length( ip, iend, &len ) ) )
+            return LZ_ERROR;
+        len += MIN_MATCH;
+
+        if ( offset == 0 || offset > (size_t)( op - (uint8_t*)dst )
+             || (size_t)( oend - op ) < len )
+            return LZ_ERROR;
+
+        // Overlapping copy repeats the pattern, thus copied byte by byte.
+        for ( ref = op - offset; len; --len )
+            *op++ = *ref++;
+    }
+
+    return (size_t)( op - (uint8_t*)dst );
+}
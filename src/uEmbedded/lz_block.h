@@ -0,0 +1,68 @@
+/*! \brief LZ77 block compressor in LZ4 sequence format.
+    \file lz_block.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Greedy single-pass compressor with a hash table of recent positions.
+   Each sequence is encoded as a token of (literal length | match length)
+   nibbles, followed by extended literal length, literals, 16-bit little endian
+   match offset and extended match length. Minimum match is 4 bytes. The last
+   sequence of a block carries literals only.
+        Neither function allocates memory. Compressor requires caller-provided
+   hash table of LZ_WORKMEM_SIZE bytes.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_LZ_Block
+//! @{
+
+enum
+{
+    LZ_HASH_LOG     = 12,
+    LZ_WORKMEM_SIZE = sizeof( uint16_t ) << LZ_HASH_LOG,
+
+    //! \brief      Maximum size of single block. Positions are kept in 16 bit.
+    LZ_MAX_BLOCK = 0xffff
+};
+
+//! \brief      Returned by lz_decompress() on malformed input.
+#define LZ_ERROR ( (size_t)-1 )
+
+//! \brief      Worst case compressed size of given input length.
+#define LZ_COMPRESS_BOUND( len ) ( ( len ) + ( len ) / 255 + 16 )
+
+/*! \brief      Compress a block.
+    \param      workmem
+                 LZ_WORKMEM_SIZE bytes of scratch memory.
+    \returns    Compressed size. 0 if it doesn't fit in dstCap. */
+size_t lz_compress(
+    void const* src,
+    size_t      srcLen,
+    void*       dst,
+    size_t      dstCap,
+    void*       workmem );
+
+/*! \brief      Decompress a block.
+    \returns    Decompressed size. LZ_ERROR if input is malformed or output
+   doesn't fit in dstCap. */
+size_t
+lz_decompress( void const* src, size_t srcLen, void* dst, size_t dstCap );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -1 +1,54 @@
-#pragma once
\ No newline at end of file
+#pragma once
+#include <stdint.h>
+
+#if defined( _MSC_VER )
+#    include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! \brief      Index of the lowest set bit. Undefined for 0.
+static inline unsigned uemb_ctz64( uint64_t v )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return (unsigned)__builtin_ctzll( v );
+#elif defined( _MSC_VER ) && defined( _WIN64 )
+    unsigned long r;
+    _BitScanForward64( &r, v );
+    return (unsigned)r;
+#else
+    unsigned r = 0;
+    while ( ( v & 1 ) == 0 )
+        v >>= 1, ++r;
+    return r;
+#endif
+}
+
+//! \brief      Number of set bits.
+static inline unsigned uemb_popcount64( uint64_t v )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return (unsigned)__builtin_popcountll( v );
+#else
+    v = v - ( ( v >> 1 ) & 0x5555555555555555ull );
+    v = ( v & 0x3333333333333333ull ) + ( ( v >> 2 ) & 0x3333333333333333ull );
+    v = ( v + ( v >> 4 ) ) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)( ( v * 0x0101010101010101ull ) >> 56 );
+#endif
+}
+
+//! \brief      Hint to fetch given address into cache for reading. No-op
+//!             where unsupported.
+#if defined( __GNUC__ ) || defined( __clang__ )
+#    define UEMB_PREFETCH( p ) __builtin_prefetch( ( p ), 0, 3 )
+#elif defined( _MSC_VER ) && ( defined( _M_X64 ) || defined( _M_IX86 ) )
+#    define UEMB_PREFETCH( p ) _mm_prefetch( (char const*)( p ), _MM_HINT_T0 )
+#else
+#    define UEMB_PREFETCH( p ) ( (void)( p ) )
+#endif
+
+#ifdef __cplusplus
+}
+#endif
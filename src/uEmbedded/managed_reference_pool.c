@@ -1,80 +1,412 @@
 #include "managed_reference_pool.h"
 #include <stdio.h>
+#include <string.h>
+#include "slab_allocator.h"
 #include "uassert.h"
+#include "uatomic.h"
 
+/*! \details   State packs [generation:32 | pending free:1 | lock count:31] into
+   a word, thus a lock, an unlock or a free is a single CAS in concurrent mode.
+   Freed node's generation is OBJECTID_NULL. */
 typedef struct refnode
 {
     void*    ref;
-    uint32_t id;
-    int16_t  lockcnt;
-    bool     pending_free;
+    uint64_t state;
+
+    //! Requested size, to relocate the object on compaction.
+    size_t size;
 } refnode_t;
 
+#define STATE_PENDING ( (uint64_t)1 << 31 )
+#define STATE_LOCKCNT ( STATE_PENDING - 1 )
+#define STATE_GEN( st ) ( (uint32_t)( ( st ) >> 32 ) )
+#define STATE_MAKE( gen ) ( (uint64_t)( gen ) << 32 )
+
 struct managed_reference_pool
 {
     /*data*/
     struct managed_reference_pool* ref_to_myself;
-    uint32_t                       idgen;
-    struct fslist                  refs;
+    uint64_t                       idgen;
+    uint64_t                       numLive;
+    bool                           bConcurrent;
+
+    /*! Node storage. Chunk k holds nodes [k * chunkCap, (k + 1) * chunkCap),
+        and never moves while allocated, thus handles stay valid on growth. */
+    struct fslist* chunks[REFPOOL_MAX_CHUNKS];
+    size_t         chunkCap;
+    size_t         numChunkMax;
+    bool           bShrink;
+
+    //! Bit k is set while grown chunk k is allocated and empty.
+    uint32_t emptyChunks;
+
+    //! Statistics.
+    size_t   capacity;
+    uint64_t peak;
+    size_t   numGrow;
+    size_t   numShrink;
+
+    //! Called on objects before their memory is released.
+    refpool_finalize_t finalize;
+
+    //! Allocator of the pool itself, and of object memory.
+    allocator_ref_t  alloc;
+    allocator_ref_t  objAlloc;
+    slab_allocator_t slab;
+    bool             bSlab;
+
+    //! Slot in the registry plus one, or 0 if not registered.
+    uint8_t slot;
 };
 
+//! Pools which compact handles can refer to.
+static managed_reference_pool_t* g_registry[REFPOOL_REGISTRY_SIZE];
+
+//! Next generation of each slot. Kept over destruction, thus handles of a
+//! destroyed pool never match ones of the next pool in the same slot.
+static uint64_t g_registryGen[REFPOOL_REGISTRY_SIZE];
+
+static inline void* obj_alloc( managed_reference_pool_t* s, size_t size )
+{
+    return s->objAlloc->allocate( s->objAlloc->object, size );
+}
+
+static inline void obj_free( managed_reference_pool_t* s, void* p )
+{
+    s->objAlloc->release( s->objAlloc->object, p );
+}
+
+static inline uint64_t load_state( managed_reference_pool_t* s, refnode_t* n )
+{
+    return s->bConcurrent ? uatomic_load64( &n->state ) : n->state;
+}
+
+static inline void
+store_state( managed_reference_pool_t* s, refnode_t* n, uint64_t v )
+{
+    if ( s->bConcurrent )
+        uatomic_store64( &n->state, v );
+    else
+        n->state = v;
+}
+
+//! Plain compare and assign unless concurrent, so both modes share a path.
+static inline bool cas_state(
+    managed_reference_pool_t* s,
+    refnode_t*                n,
+    uint64_t*                 expected,
+    uint64_t                  desired )
+{
+    if ( s->bConcurrent )
+        return uatomic_cas64( &n->state, expected, desired );
+
+    if ( n->state != *expected ) {
+        *expected = n->state;
+        return false;
+    }
+    n->state = desired;
+    return true;
+}
+
+static inline uint64_t
+add_count( managed_reference_pool_t* s, uint64_t* p, int d )
+{
+    return s->bConcurrent ? uatomic_add64( p, (uint64_t)(int64_t)d )
+                          : ( *p += (uint64_t)(int64_t)d );
+}
+
+static inline uint64_t load_count( managed_reference_pool_t* s, uint64_t* p )
+{
+    return s->bConcurrent ? uatomic_load64( p ) : *p;
+}
+
+static void raise_peak( managed_reference_pool_t* s, uint64_t live )
+{
+    uint64_t peak = load_count( s, &s->peak );
+
+    if ( !s->bConcurrent ) {
+        s->peak = live > peak ? live : peak;
+        return;
+    }
+
+    while ( live > peak && !uatomic_cas64( &s->peak, &peak, live ) ) { }
+}
+
+//! Resolve node by index. NULL if out of range.
+static inline refnode_t* node_of( managed_reference_pool_t* s, size_t idx )
+{
+    struct fslist* l;
+    size_t         k;
+
+    if ( s == NULL )
+        return NULL;
+
+    k = idx / s->chunkCap;
+    if ( k >= s->numChunkMax || ( l = s->chunks[k] ) == NULL )
+        return NULL;
+
+    return (refnode_t*)l->data + idx % s->chunkCap;
+}
+
+//! Allocate chunk k. Every node starts freed, as concurrent iteration scans
+//! all of them.
+static struct fslist* new_chunk( managed_reference_pool_t* s, size_t k )
+{
+    size_t         buffSz, i;
+    struct fslist* l;
+
+    buffSz = s->chunkCap * ( FSLIST_NODE_SIZE + sizeof( refnode_t ) );
+    l      = s->alloc->allocate( s->alloc->object, sizeof( *l ) + buffSz );
+    if ( l == NULL )
+        return NULL;
+
+    fslist_init_ex(
+        l,
+        l + 1,
+        buffSz,
+        sizeof( refnode_t ),
+        s->bConcurrent ? FSLIST_FLAG_CONCURRENT : 0 );
+    uassert( l->capacity == s->chunkCap );
+
+    for ( i = 0; i < s->chunkCap; ++i )
+        ( (refnode_t*)l->data )[i].state = STATE_MAKE( OBJECTID_NULL );
+
+    s->chunks[k] = l;
+    s->capacity += s->chunkCap;
+    return l;
+}
+
+static void delete_chunk( managed_reference_pool_t* s, size_t k )
+{
+    s->alloc->release( s->alloc->object, s->chunks[k] );
+    s->chunks[k] = NULL;
+    s->capacity -= s->chunkCap;
+    s->emptyChunks &= ~( (uint32_t)1 << k );
+}
+
 managed_reference_pool_t* refpool_create( size_t numMaxRef )
 {
-    managed_reference_pool_t* s = malloc( sizeof( managed_reference_pool_t ) );
+    struct refpool_desc desc;
+
+    memset( &desc, 0, sizeof( desc ) );
+    desc.numMaxRef = numMaxRef;
+    return refpool_create_ex( &desc );
+}
+
+managed_reference_pool_t* refpool_create_ex( struct refpool_desc const* desc )
+{
+    allocator_ref_t alloc = desc->alloc ? desc->alloc : &g_mallocator;
+    size_t          i;
+
+    managed_reference_pool_t* s
+        = alloc->allocate( alloc->object, sizeof( managed_reference_pool_t ) );
     if ( s == NULL )
         return NULL;
 
-    size_t buffSz = numMaxRef * ( FSLIST_NODE_SIZE + sizeof( refnode_t ) );
+    memset( s, 0, sizeof( *s ) );
+    s->alloc       = alloc;
+    s->objAlloc    = alloc;
+    s->bSlab       = desc->flags & REFPOOL_FLAG_SLAB;
+    s->bConcurrent = desc->flags & REFPOOL_FLAG_CONCURRENT;
+    s->bShrink     = desc->flags & REFPOOL_FLAG_SHRINK;
+    s->finalize    = desc->finalize;
+    s->chunkCap    = desc->numMaxRef;
+    s->numChunkMax = desc->numMaxChunk ? desc->numMaxChunk : 1;
+
+    // Slab allocator isn't thread safe, and chunks are added by owner only.
+    uassert( !( s->bSlab && s->bConcurrent ) );
+    uassert( !( s->bConcurrent && s->numChunkMax > 1 ) );
+    uassert( s->chunkCap && s->numChunkMax <= REFPOOL_MAX_CHUNKS );
+
+    if ( new_chunk( s, 0 ) == NULL ) {
+        alloc->release( alloc->object, s );
+        return NULL;
+    }
 
-    s->idgen = 0;
-    fslist_init( &s->refs, malloc( buffSz ), buffSz, sizeof( refnode_t ) );
+    if ( s->bSlab ) {
+        slab_allocator_init(
+            &s->slab,
+            alloc,
+            desc->sizeClasses,
+            desc->numSizeClasses,
+            desc->slabSize );
+        s->objAlloc = slab_allocator_ref( &s->slab );
+    }
 
-    uassert( s->refs.capacity == numMaxRef );
     s->ref_to_myself = s;
+
+    // Compact handles are unavailable if the registry is full, or node
+    // indices may not fit in REFID_INDEX_BITS.
+    s->slot = 0;
+    if ( s->chunkCap > ( (size_t)1 << REFID_INDEX_BITS ) / s->numChunkMax )
+        return s;
+
+    for ( i = 0; i < REFPOOL_REGISTRY_SIZE; ++i ) {
+        if ( g_registry[i] == NULL ) {
+            g_registry[i] = s;
+            s->slot       = (uint8_t)( i + 1 );
+            s->idgen      = g_registryGen[i];
+            break;
+        }
+    }
+
     return s;
 }
 
-refhandle_t refpool_malloc( managed_reference_pool_t* s, size_t memsize )
+//! Return node to the free chain. Object memory is released already.
+static void release_node( managed_reference_pool_t* s, size_t idx )
 {
-    uassert( s && s->refs.size < s->refs.capacity );
+    size_t              k = idx / s->chunkCap;
+    struct fslist*      l = s->chunks[k];
+    struct fslist_node* n = l->get + idx % s->chunkCap;
 
-    struct fslist_node* n    = fslist_insert( &s->refs, NULL );
-    refnode_t*          data = fslist_data( &s->refs, n );
-    uassert( n && data );
+    store_state( s, fslist_data( l, n ), STATE_MAKE( OBJECTID_NULL ) );
+    add_count( s, &s->numLive, -1 );
 
-    data->id           = s->idgen++;
-    data->pending_free = false;
-    data->ref          = malloc( memsize );
-    data->lockcnt      = 0;
+    // Concurrent pool never links nodes, as the active list isn't thread safe.
+    if ( s->bConcurrent ) {
+        fslist_release_concurrent( l, n );
+        return;
+    }
 
-    refhandle_t ret;
-    ret.id   = data->id;
-    ret.node = n;
+    fslist_erase( l, n );
+    if ( k && l->size == 0 )
+        s->emptyChunks |= (uint32_t)1 << k;
+
+    // Keeps half a chunk of room after shrink, so usage around a chunk
+    // boundary doesn't allocate and release a chunk repeatedly. Chunks which
+    // drained earlier are released as soon as later frees make room.
+    while ( s->bShrink && s->emptyChunks
+            && s->capacity - s->chunkCap - s->numLive >= s->chunkCap / 2 ) {
+        delete_chunk( s, uemb_ctz64( s->emptyChunks ) );
+        ++s->numShrink;
+    }
+}
+
+//! Take a node from the lowest chunk with room, growing if none has.
+static struct fslist_node*
+take_node( managed_reference_pool_t* s, size_t* idx )
+{
+    struct fslist*      l;
+    struct fslist_node* n;
+    size_t              k, empty = REFPOOL_MAX_CHUNKS;
+
+    if ( s->bConcurrent ) {
+        n    = fslist_alloc_concurrent( s->chunks[0] );
+        *idx = n ? fslist_idx( s->chunks[0], n ) : 0;
+        return n;
+    }
+
+    // Lower chunks are filled first, so higher ones can drain and shrink.
+    for ( k = 0; k < s->numChunkMax; ++k ) {
+        l = s->chunks[k];
+        if ( l && l->size < l->capacity )
+            break;
+        if ( l == NULL && empty == REFPOOL_MAX_CHUNKS )
+            empty = k;
+    }
+
+    if ( k == s->numChunkMax ) {
+        if ( empty == REFPOOL_MAX_CHUNKS || !new_chunk( s, empty ) )
+            return NULL;
+        ++s->numGrow;
+        k = empty;
+    }
+
+    l    = s->chunks[k];
+    n    = fslist_insert( l, NULL );
+    *idx = k * s->chunkCap + fslist_idx( l, n );
+    s->emptyChunks &= ~( (uint32_t)1 << k );
+    return n;
+}
+
+refhandle_t refpool_malloc( managed_reference_pool_t* s, size_t memsize )
+{
+    struct fslist_node* n;
+    refnode_t*          data;
+    refhandle_t         ret;
+    uint32_t            gen;
+    size_t              idx;
+
+    uassert( s );
     ret.s    = &s->ref_to_myself;
+    ret.id   = OBJECTID_NULL;
+    ret.node = NULL;
+
+    n = take_node( s, &idx );
+    if ( n == NULL )
+        return ret;
+
+    // Generation never becomes OBJECTID_NULL, which marks a freed node.
+    do
+        gen = (uint32_t)add_count( s, &s->idgen, 1 );
+    while ( gen == OBJECTID_NULL );
+
+    raise_peak( s, add_count( s, &s->numLive, 1 ) );
+    data       = node_of( s, idx );
+    data->ref  = obj_alloc( s, memsize );
+    data->size = memsize;
+
+    if ( data->ref == NULL ) {
+        release_node( s, idx );
+        return ret;
+    }
+
+    // Publishes ref; lockers observe it after reading the generation.
+    store_state( s, data, STATE_MAKE( gen ) );
+    ret.id   = gen;
+    ret.node = n;
     return ret;
 }
 
 size_t refpool_num_available( managed_reference_pool_t* s )
 {
-    return s->refs.capacity - s->refs.size;
+    return s->capacity - (size_t)load_count( s, &s->numLive );
+}
+
+void refpool_get_stats(
+    managed_reference_pool_t* s,
+    struct refpool_stats*     stats )
+{
+    stats->capacity  = s->capacity;
+    stats->numLive   = (size_t)load_count( s, &s->numLive );
+    stats->peak      = (size_t)load_count( s, &s->peak );
+    stats->numGrow   = s->numGrow;
+    stats->numShrink = s->numShrink;
 }
 
-static void release_all( void* nouse_, refhandle_t* h )
+static void release_all( void* pool, refhandle_t* h )
 {
-    free( ref_lock( h ) );
+    managed_reference_pool_t* s   = (managed_reference_pool_t*)pool;
+    void*                     obj = ref_lock( h );
+
+    if ( s->finalize )
+        s->finalize( obj );
+    obj_free( s, obj );
 }
 
 void refpool_destroy( managed_reference_pool_t* s )
 {
+    allocator_ref_t alloc = s->alloc;
+    size_t          k;
+
     // Release all memory
-    refpool_foreach( s, NULL, release_all );
+    refpool_foreach( s, s, release_all );
+    if ( s->bSlab )
+        slab_allocator_destroy( &s->slab );
 
     // Releaes ref to myself
     s->ref_to_myself = NULL;
+    if ( s->slot ) {
+        g_registry[s->slot - 1]    = NULL;
+        g_registryGen[s->slot - 1] = s->idgen;
+    }
 
     // Erase ref to myself
-    free( s->refs.buff );
-    free( s );
+    for ( k = 0; k < s->numChunkMax; ++k )
+        if ( s->chunks[k] )
+            delete_chunk( s, k );
+    alloc->release( alloc->object, s );
 }
 
 void refpool_foreach(
@@ -84,123 +416,446 @@ void refpool_foreach(
 {
     uassert( s && cb );
 
-    if ( s->refs.size == 0 )
-        return;
-
-    // First node ref
-    struct fslist_node* n = &s->refs.get[s->refs.head];
-    refnode_t*          objref;
+    struct fslist*      l;
+    struct fslist_node* n;
     refhandle_t         h;
+    size_t              i, k;
     h.s = &s->ref_to_myself;
 
-    while ( n ) {
-        objref = fslist_data( &s->refs, n );
+    // Nodes of concurrent pool aren't linked; scan every node instead.
+    if ( s->bConcurrent ) {
+        l = s->chunks[0];
+        for ( i = 0; i < l->capacity; ++i ) {
+            h.node = l->get + i;
+            h.id   = STATE_GEN( load_state( s, fslist_data( l, h.node ) ) );
+
+            if ( h.id != OBJECTID_NULL && ref_lock( &h ) ) {
+                cb( caller, &h );
+                ref_unlock( &h );
+            }
+        }
+        return;
+    }
+
+    for ( k = 0; k < s->numChunkMax; ++k ) {
+        // Chunk may be released by the last unlock of its last node, which
+        // leaves nothing to visit in it.
+        if ( ( l = s->chunks[k] ) == NULL || l->size == 0 )
+            continue;
+
+        // First node ref
+        n = &l->get[l->head];
+
+        while ( n ) {
+            // Make handle from node
+            h.node = n;
+            h.id   = STATE_GEN( load_state( s, fslist_data( l, n ) ) );
+
+            // Lock node to prevent iteration breakdown
+            if ( ref_lock( &h ) ) {
+                // Callback.
+                cb( caller, &h );
+
+                n = fslist_next( l, n );
+                ref_unlock( &h );
+            }
+            else {
+                n = fslist_next( l, n );
+            }
+        }
+    }
+}
+
+//! Generation is compared within each CAS, thus a node reused meanwhile is
+//! never touched through stale handle.
+static void* lock_node( managed_reference_pool_t* s, refnode_t* n, uint32_t id )
+{
+    uint64_t st;
+
+    if ( n == NULL )
+        return NULL;
+
+    st = load_state( s, n );
+    do {
+        if ( STATE_GEN( st ) != id || ( st & STATE_PENDING ) )
+            return NULL;
+        uassert( ( st & STATE_LOCKCNT ) != STATE_LOCKCNT );
+    } while ( !cas_state( s, n, &st, st + 1 ) );
 
-        // Make handle from node
-        h.node = n;
-        h.id   = objref->id;
+    uassert( n->ref );
+    return n->ref;
+}
 
-        // Lock node to prevent iteration breakdown
-        if ( ref_lock( &h ) ) {
-            // Callback.
-            cb( caller, &h );
+//! Whoever drops the last lock of pending node, or frees an unlocked node,
+//! reclaims it. Exactly one party observes that transition.
+static void
+reclaim_node( managed_reference_pool_t* s, size_t idx, bool bFinalize )
+{
+    refnode_t* n = node_of( s, idx );
+
+    uassert( n->ref );
+    if ( bFinalize && s->finalize )
+        s->finalize( n->ref );
+    obj_free( s, n->ref );
+    n->ref = NULL;
+    release_node( s, idx );
+}
 
-            n = fslist_next( &s->refs, n );
-            ref_unlock( &h );
+static void
+unlock_node( managed_reference_pool_t* s, size_t idx, uint32_t id )
+{
+    refnode_t* n = node_of( s, idx );
+    uint64_t   st;
+
+    if ( n == NULL )
+        return;
+
+    st = load_state( s, n );
+    do {
+        if ( STATE_GEN( st ) != id )
+            return;
+        uassert( st & STATE_LOCKCNT );
+    } while ( !cas_state( s, n, &st, st - 1 ) );
+
+    if ( ( st & STATE_PENDING ) && ( st & STATE_LOCKCNT ) == 1 )
+        reclaim_node( s, idx, true );
+}
+
+static bool free_node( managed_reference_pool_t* s, size_t idx, uint32_t id )
+{
+    refnode_t* n = node_of( s, idx );
+    uint64_t   st;
+
+    if ( n == NULL )
+        return false;
+
+    st = load_state( s, n );
+    do {
+        if ( STATE_GEN( st ) != id )
+            return false;
+        if ( st & STATE_PENDING )
+            return true;
+    } while ( !cas_state( s, n, &st, st | STATE_PENDING ) );
+
+    if ( ( st & STATE_LOCKCNT ) == 0 )
+        reclaim_node( s, idx, true );
+    return true;
+}
+
+static bool
+discard_node( managed_reference_pool_t* s, size_t idx, uint32_t id )
+{
+    refnode_t* n = node_of( s, idx );
+    uint64_t   st;
+
+    if ( n == NULL )
+        return false;
+
+    st = load_state( s, n );
+    do {
+        if ( STATE_GEN( st ) != id )
+            return false;
+        uassert( ( st & ( STATE_PENDING | STATE_LOCKCNT ) ) == 0 );
+    } while ( !cas_state( s, n, &st, st | STATE_PENDING ) );
+
+    reclaim_node( s, idx, false );
+    return true;
+}
+
+static bool
+is_valid_node( managed_reference_pool_t* s, size_t idx, uint32_t id )
+{
+    refnode_t* n = node_of( s, idx );
+    uint64_t   st;
+
+    if ( n == NULL )
+        return false;
+
+    st = load_state( s, n );
+    return STATE_GEN( st ) == id && !( st & STATE_PENDING );
+}
+
+size_t refpool_compact( managed_reference_pool_t* s )
+{
+    refnode_t* n;
+    uint64_t   st;
+    void*      dst;
+    size_t     i, numMoved = 0;
+
+    uassert( s && !s->bConcurrent );
+
+    // Reallocating one by one through a general allocator packs nothing.
+    if ( !s->bSlab )
+        return 0;
+
+    slab_compact_begin( &s->slab );
+
+    for ( i = 0; i < s->numChunkMax * s->chunkCap; ++i ) {
+        if ( ( n = node_of( s, i ) ) == NULL )
+            continue;
+
+        st = n->state;
+
+        // Locked objects are in use by pointer; pending ones are as well.
+        if ( STATE_GEN( st ) == OBJECTID_NULL
+             || ( st & ( STATE_PENDING | STATE_LOCKCNT ) ) )
+            continue;
+
+        dst = slab_compact_move( &s->slab, n->ref );
+        if ( dst == NULL )
+            continue;
+
+        memcpy( dst, n->ref, n->size );
+        obj_free( s, n->ref );
+        n->ref = dst;
+        ++numMoved;
+    }
+
+    slab_compact_end( &s->slab );
+    return numMoved;
+}
+
+//! Shared by partitions of refpool_foreach_parallel().
+struct parallel_ctx
+{
+    managed_reference_pool_t*           s;
+    struct refpool_parallel_desc const* desc;
+    size_t                              numSlot;
+
+    //! Set by partitions which left objects to reclaim.
+    bool bReclaim[REFPOOL_MAX_PARTITIONS];
+};
+
+static inline void
+partition_range( struct parallel_ctx* c, size_t i, size_t* b, size_t* e )
+{
+    size_t np = c->desc->numPartition;
+
+    *b = c->numSlot / np * i + ( i < c->numSlot % np ? i : c->numSlot % np );
+    *e = *b + c->numSlot / np + ( i < c->numSlot % np );
+}
+
+static void parallel_task( void* arg, size_t part )
+{
+    struct parallel_ctx*                c    = (struct parallel_ctx*)arg;
+    managed_reference_pool_t*           s    = c->s;
+    struct refpool_parallel_desc const* desc = c->desc;
+    void*                               partial;
+    refnode_t*                          n;
+    refhandle_t                         h;
+    uint64_t                            st;
+    size_t                              idx, end;
+
+    partial = desc->partials
+                  ? (char*)desc->partials + part * desc->partialSize
+                  : NULL;
+    h.s     = &s->ref_to_myself;
+
+    for ( partition_range( c, part, &idx, &end ); idx < end; ++idx ) {
+        // Skip unallocated chunk at once.
+        if ( ( n = node_of( s, idx ) ) == NULL ) {
+            idx = ( idx / s->chunkCap + 1 ) * s->chunkCap - 1;
+            continue;
         }
-        else {
-            n = fslist_next( &s->refs, n );
+
+        h.id = STATE_GEN( load_state( s, n ) );
+        if ( h.id == OBJECTID_NULL || lock_node( s, n, h.id ) == NULL )
+            continue;
+
+        h.node = s->chunks[idx / s->chunkCap]->get + idx % s->chunkCap;
+        desc->cb( desc->caller, partial, &h );
+
+        if ( s->bConcurrent ) {
+            unlock_node( s, idx, h.id );
+            continue;
         }
+
+        // Free chain isn't thread safe; the owner reclaims after join.
+        st = n->state;
+        n->state--;
+        if ( ( st & STATE_PENDING ) && ( st & STATE_LOCKCNT ) == 1 )
+            c->bReclaim[part] = true;
     }
 }
 
-void* ref_lock( refhandle_t* h )
+void refpool_foreach_parallel(
+    managed_reference_pool_t*           s,
+    struct refpool_parallel_desc const* desc )
 {
-    uassert( h->s && h->id != OBJECTID_NULL );
+    struct parallel_ctx c;
+    refnode_t*          n;
+    size_t              i, idx, end;
+
+    uassert( s && desc->executor && desc->cb );
+    uassert( desc->numPartition );
+    uassert( desc->numPartition <= REFPOOL_MAX_PARTITIONS );
+
+    memset( &c, 0, sizeof( c ) );
+    c.s       = s;
+    c.desc    = desc;
+    c.numSlot = s->numChunkMax * s->chunkCap;
+
+    desc->executor->run(
+        desc->executor->object, desc->numPartition, parallel_task, &c );
+
+    for ( i = 0; i < desc->numPartition; ++i ) {
+        if ( !c.bReclaim[i] )
+            continue;
+
+        for ( partition_range( &c, i, &idx, &end ); idx < end; ++idx ) {
+            n = node_of( s, idx );
+            if ( n && STATE_GEN( n->state ) != OBJECTID_NULL
+                 && ( n->state & ( STATE_PENDING | STATE_LOCKCNT ) )
+                        == STATE_PENDING )
+                reclaim_node( s, idx, true );
+        }
+    }
 
-    // Check if reference is alive.
-    managed_reference_pool_t* s = *h->s;
-    if ( s == NULL )
-        return NULL;
+    // Partials are folded in order on the calling thread.
+    for ( i = 0; desc->reduce && i < desc->numPartition; ++i ) {
+        desc->reduce(
+            desc->caller,
+            desc->partials ? (char*)desc->partials + i * desc->partialSize
+                           : NULL );
+    }
+}
 
-    refnode_t* data = fslist_data( &s->refs, h->node );
+//! Index of handle's node. Out of range if the node isn't of the pool.
+static inline size_t
+idx_of( managed_reference_pool_t* s, refhandle_t const* h )
+{
+    struct fslist* l;
+    size_t         k;
 
-    if ( data && data->id == h->id && data->pending_free == false ) {
-        uassert( data->ref );
-        ++data->lockcnt;
-        return data->ref;
-    }
-    else {
-        return NULL;
+    for ( k = 0; s && k < s->numChunkMax; ++k ) {
+        l = s->chunks[k];
+        if ( l && fslist_node_in_range( l, h->node ) )
+            return k * s->chunkCap + fslist_idx( l, h->node );
     }
+    return FSLIST_NODEIDX_NONE;
 }
 
-void ref_unlock( refhandle_t* h )
+void* ref_lock( refhandle_t* h )
 {
     uassert( h->s && h->id != OBJECTID_NULL );
 
     // Check if reference is alive.
     managed_reference_pool_t* s = *h->s;
-    if ( s == NULL )
-        return;
-
-    refnode_t* data = fslist_data( &s->refs, h->node );
+    return lock_node( s, node_of( s, idx_of( s, h ) ), h->id );
+}
 
-    if ( data && data->id == h->id ) {
-        uassert( data->lockcnt > 0 );
-        --data->lockcnt;
+void ref_unlock( refhandle_t* h )
+{
+    uassert( h->s && h->id != OBJECTID_NULL );
 
-        // Erase node
-        if ( data->pending_free && data->lockcnt == 0 ) {
-            uassert( data->ref );
-            free( data->ref );
-            data->id = OBJECTID_NULL;
-            fslist_erase( &s->refs, h->node );
-        }
-    }
+    managed_reference_pool_t* s = *h->s;
+    unlock_node( s, idx_of( s, h ), h->id );
 }
 
 bool ref_free( refhandle_t* h )
 {
     uassert( h->s && h->id != OBJECTID_NULL );
 
-    // Check if reference is alive.
     managed_reference_pool_t* s = *h->s;
-    if ( s == NULL )
-        return NULL;
-
-    refnode_t* data = fslist_data( &s->refs, h->node );
+    return free_node( s, idx_of( s, h ), h->id );
+}
 
-    if ( data && data->id == h->id ) {
-        if ( data->lockcnt ) {
-            data->pending_free = true;
-            return true;
-        }
+bool ref_discard( refhandle_t* h )
+{
+    uassert( h->s && h->id != OBJECTID_NULL );
 
-        // Erase node
-        free( data->ref );
-        data->id = OBJECTID_NULL;
-        fslist_erase( &s->refs, h->node );
-        return true;
-    }
-    else {
-        return false;
-    }
+    managed_reference_pool_t* s = *h->s;
+    return discard_node( s, idx_of( s, h ), h->id );
 }
 
 bool ref_is_valid( refhandle_t const* h )
 {
-    // Check if reference is alive.
     managed_reference_pool_t* s = *h->s;
-    if ( s == NULL )
-        return false;
+    return is_valid_node( s, idx_of( s, h ), h->id );
+}
 
-    refnode_t* data = fslist_data( &s->refs, h->node );
+//! Decode compact handle.
+static inline managed_reference_pool_t*
+decode_id( refid_t id, size_t* idx, uint32_t* gen )
+{
+    size_t slot = (size_t)( id >> REFID_INDEX_BITS ) & 0xff;
 
-    if ( data && data->id == h->id && data->pending_free == false ) {
-        return true;
-    }
-    else {
-        return false;
-    }
-}
\ No newline at end of file
+    *idx = (size_t)( id & ( ( (refid_t)1 << REFID_INDEX_BITS ) - 1 ) );
+    *gen = (uint32_t)( id >> 32 );
+    return slot ? g_registry[slot - 1] : NULL;
+}
+
+refid_t ref_to_id( refhandle_t const* h )
+{
+    managed_reference_pool_t* s = *h->s;
+    size_t                    idx;
+
+    if ( s == NULL || s->slot == 0 || h->id == OBJECTID_NULL )
+        return REFID_NULL;
+
+    idx = idx_of( s, h );
+    uassert( idx < ( (size_t)1 << REFID_INDEX_BITS ) );
+    return (refid_t)h->id << 32 | (refid_t)s->slot << REFID_INDEX_BITS | idx;
+}
+
+refhandle_t ref_from_id( refid_t id )
+{
+    refhandle_t               h;
+    size_t                    idx;
+    uint32_t                  gen;
+    managed_reference_pool_t* s = decode_id( id, &idx, &gen );
+
+    uassert( s );
+    h.s    = &s->ref_to_myself;
+    h.id   = gen;
+
+    // Node of released chunk makes an invalid handle.
+    h.node = node_of( s, idx ) ? s->chunks[idx / s->chunkCap]->get
+                                     + idx % s->chunkCap
+                               : NULL;
+    return h;
+}
+
+refid_t refpool_malloc_id( managed_reference_pool_t* s, size_t memsize )
+{
+    refhandle_t h;
+
+    // Unregistered pool would leak the object behind REFID_NULL.
+    if ( s->slot == 0 )
+        return REFID_NULL;
+
+    h = refpool_malloc( s, memsize );
+    return h.id != OBJECTID_NULL ? ref_to_id( &h ) : REFID_NULL;
+}
+
+void* refid_lock( refid_t id )
+{
+    size_t                    idx;
+    uint32_t                  gen;
+    managed_reference_pool_t* s = decode_id( id, &idx, &gen );
+    return lock_node( s, node_of( s, idx ), gen );
+}
+
+void refid_unlock( refid_t id )
+{
+    size_t                    idx;
+    uint32_t                  gen;
+    managed_reference_pool_t* s = decode_id( id, &idx, &gen );
+    unlock_node( s, idx, gen );
+}
+
+bool refid_free( refid_t id )
+{
+    size_t                    idx;
+    uint32_t                  gen;
+    managed_reference_pool_t* s = decode_id( id, &idx, &gen );
+    return free_node( s, idx, gen );
+}
+
+bool refid_is_valid( refid_t id )
+{
+    size_t                    idx;
+    uint32_t                  gen;
+    managed_reference_pool_t* s = decode_id( id, &idx, &gen );
+    return is_valid_node( s, idx, gen );
+}
@@ -11,6 +11,7 @@
 #pragma once
 #include <stdint.h>
 #include <stdlib.h>
+#include "allocator.h"
 #include "fslist.h"
 
 #ifdef __cplusplus
@@ -30,9 +31,108 @@ typedef struct refhandle
 
 typedef struct managed_reference_pool managed_reference_pool_t;
 
+//! \brief      Options for refpool_create_ex()
+enum
+{
+    //! \brief      Serve object memory from built-in size-class slab allocator
+    //!             on top of refpool_desc::alloc.
+    REFPOOL_FLAG_SLAB = 0x01,
+
+    //! \brief      Make allocation, lock, unlock and free safe to call from
+    //!             any thread. Locks are a single CAS on the node, and the
+    //!             object is reclaimed by whoever drops its last lock after
+    //!             free, thus no mutex is taken. Object allocator must be
+    //!             thread safe, and can't be combined with REFPOOL_FLAG_SLAB.
+    //!             Creation, destruction and iteration stay single threaded.
+    REFPOOL_FLAG_CONCURRENT = 0x02,
+
+    //! \brief      Release a grown chunk once its last reference is freed,
+    //!             as long as half a chunk of room remains.
+    REFPOOL_FLAG_SHRINK = 0x04,
+
+    //! \brief      Upper limit of refpool_desc::numMaxChunk.
+    REFPOOL_MAX_CHUNKS = 32
+};
+
+//! \brief      Finalizes an object, right before its memory is released.
+typedef void ( *refpool_finalize_t )( void* /*obj*/ );
+
+//! \brief      Pool creation descriptor. Zero-initialize, then fill the
+//!             fields needed.
+struct refpool_desc
+{
+    //! \brief      Number of references per chunk. Pool starts with one.
+    size_t numMaxRef;
+
+    //! \brief      Maximum number of chunks. When every chunk is full, a new
+    //!             one is allocated; existing ones never move, thus handles
+    //!             stay valid. 0 or 1 for fixed capacity. Must be 0 or 1 in
+    //!             concurrent mode.
+    size_t numMaxChunk;
+
+    //! \brief      Allocator for the pool and object memory. NULL for
+    //!             g_mallocator.
+    allocator_ref_t alloc;
+
+    //! \brief      Combination of REFPOOL_FLAG_* values.
+    uint32_t flags;
+
+    //! \brief      Called on each object when it is reclaimed after
+    //!             ref_free(), and on live objects by refpool_destroy().
+    //!             Optional.
+    refpool_finalize_t finalize;
+
+    //! \brief      Ascending slab size classes. NULL for slab defaults.
+    size_t const* sizeClasses;
+    size_t        numSizeClasses;
+
+    //! \brief      Bytes per slab. 0 for slab default.
+    size_t slabSize;
+};
+
+//! \brief      Create pool with malloc() backed object memory.
 managed_reference_pool_t* refpool_create( size_t numMaxRef );
+
+//! \brief      Create pool as described.
+//! \details    Takes a slot of the compact handle registry. Creation and
+//!             destruction of pools aren't thread safe; serialize them.
+managed_reference_pool_t* refpool_create_ex( struct refpool_desc const* desc );
+
+//! \brief      Allocate object memory and its reference.
+//! \returns    Handle. If memory allocation fails, or the pool is full and
+//!             can't grow, the handle is invalid.
 refhandle_t refpool_malloc( managed_reference_pool_t* s, size_t memsize );
-size_t      refpool_num_available( managed_reference_pool_t* s );
+
+//! \brief      Number of references available without growth.
+size_t refpool_num_available( managed_reference_pool_t* s );
+
+//! \brief      Pool usage statistics.
+struct refpool_stats
+{
+    //! \brief      Current number of references, of all allocated chunks.
+    size_t capacity;
+    size_t numLive;
+
+    //! \brief      Largest numLive ever.
+    size_t peak;
+
+    //! \brief      Number of chunks allocated and released after creation.
+    size_t numGrow;
+    size_t numShrink;
+};
+
+void refpool_get_stats(
+    managed_reference_pool_t* s,
+    struct refpool_stats*     stats );
+
+/*! \brief      Relocate unlocked objects, then release emptied memory.
+    \details    Handles stay valid, as objects are reached by ref_lock() only.
+   Locked or pending-free objects stay in place. Objects are packed into the
+   fullest slabs and emptied slabs are returned to the allocator. Requires
+   REFPOOL_FLAG_SLAB; other pools leave placement to their allocator, thus
+   nothing is done. Not available in concurrent mode.
+    \returns    Number of relocated objects. 0 without REFPOOL_FLAG_SLAB. */
+size_t refpool_compact( managed_reference_pool_t* s );
 
 //! \warning    This function invalidates all alive reference handles!
 void refpool_destroy( managed_reference_pool_t* s );
@@ -45,11 +145,112 @@ void refpool_foreach(
     void*                      caller,
     refpool_foreach_callback_t cb );
 
+enum
+{
+    //! \brief      Upper limit of refpool_parallel_desc::numPartition.
+    REFPOOL_MAX_PARTITIONS = 64
+};
+
+//! \brief      Runs task( arg, i ) for every i in [0, numTask), possibly in
+//!             parallel, and returns when all of them are done. Bind to a
+//!             worker pool of the platform.
+typedef struct refpool_executor
+{
+    void ( *run )(
+        void* /*object*/,
+        size_t /*numTask*/,
+        void ( * /*task*/ )( void* /*arg*/, size_t /*i*/ ),
+        void* /*arg*/ );
+    void* object;
+} refpool_executor_t;
+
+//! \brief      Visits an object. partial is the accumulator of the
+//!             partition, thus needs no synchronization.
+typedef void ( *refpool_parallel_callback_t )(
+    void* /*caller*/,
+    void* /*partial*/,
+    refhandle_t* /*iter_object*/ );
+
+//! \brief      Folds an accumulator of a partition.
+typedef void ( *refpool_reduce_t )( void* /*caller*/, void* /*partial*/ );
+
+//! \brief      Parallel iteration descriptor.
+struct refpool_parallel_desc
+{
+    refpool_executor_t const* executor;
+
+    //! \brief      Node range is split evenly into this many tasks.
+    size_t numPartition;
+
+    void*                       caller;
+    refpool_parallel_callback_t cb;
+
+    //! \brief      Array of numPartition accumulators of partialSize bytes
+    //!             each, initialized by caller. Optional.
+    void*  partials;
+    size_t partialSize;
+
+    //! \brief      Called on each accumulator in partition order on the
+    //!             calling thread, after every partition is done. Optional.
+    refpool_reduce_t reduce;
+};
+
+/*! \brief      Visit live objects in parallel.
+    \details    Partitions cover disjoint nodes, so callbacks never see the same
+   object at once. Each object is locked while visited. Unless the pool is
+   concurrent, the callback may free the visited object but no other, and
+   must not allocate; freed objects are reclaimed by the calling thread after
+   all partitions are done. */
+void refpool_foreach_parallel(
+    managed_reference_pool_t*           s,
+    struct refpool_parallel_desc const* desc );
+
 bool  ref_free( refhandle_t* h );
+
+//! \brief      Free unlocked object at once, without finalizer. For objects
+//!             which failed to initialize.
+bool  ref_discard( refhandle_t* h );
 void* ref_lock( refhandle_t* h );
 void  ref_unlock( refhandle_t* h );
 bool  ref_is_valid( refhandle_t const* h );
 
+/*! \brief      Compact 64-bit handle.
+    \details    Laid out as [generation:32 | pool slot:8 | node index:24]. The
+   pool is resolved from a registry of up to REFPOOL_REGISTRY_SIZE live pools,
+   and validated by comparing the generation with the node's id. A pool taking
+   over the slot of a destroyed one continues its generations, so stale handles
+   don't resolve to new objects. Zero is never a valid handle. */
+typedef uint64_t refid_t;
+
+enum
+{
+    REFID_NULL = 0,
+
+    //! \brief      Pools with more than 2^REFID_INDEX_BITS references, i.e.
+    //!             numMaxRef * numMaxChunk, are never registered and have no
+    //!             compact handles.
+    REFID_INDEX_BITS      = 24,
+    REFPOOL_REGISTRY_SIZE = 255
+};
+
+//! \brief      Convert to compact handle. REFID_NULL if the pool isn't
+//!             registered, because the registry was full or the pool is too
+//!             large.
+refid_t ref_to_id( refhandle_t const* h );
+
+//! \brief      Convert compact handle of a live pool back to full handle.
+refhandle_t ref_from_id( refid_t id );
+
+//! \brief      refpool_malloc() returning compact handle.
+refid_t refpool_malloc_id( managed_reference_pool_t* s, size_t memsize );
+
+//! \brief      Same as ref_*() counterparts, on compact handles. Handles of
+//!             destroyed pools are simply invalid.
+void* refid_lock( refid_t id );
+void  refid_unlock( refid_t id );
+bool  refid_free( refid_t id );
+bool  refid_is_valid( refid_t id );
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
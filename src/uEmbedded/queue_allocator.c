@@ -7,7 +7,7 @@ void queue_allocator_init(
     void*                   buff,
     size_t                  capacity )
 {
-    capacity = ( capacity + sizeof( size_t ) - 1 ) & ~( sizeof( size_t ) - 1 );
+    capacity = capacity & ~( sizeof( size_t ) - 1 );
     s->buff  = (char*)buff;
     s->head  = 0;
     s->tail  = 0;
@@ -22,15 +22,23 @@ void* queue_allocator_push( struct queue_allocator* s, size_t size )
         = sizeof( size_t )
           + ( ( size + ( sizeof( size_t ) - 1 ) ) & ~( sizeof( size_t ) - 1 ) );
 
-    if ( s->head + jmpSize + sizeof( size_t ) >= s->cap ) {
+    // Room for the wrap marker is always kept behind the last block.
+    if ( jmpSize + sizeof( size_t ) >= s->cap )
+        return NULL;
+
+    if ( s->cnt && s->head <= s->tail ) {
+        // Already wrapped; free space lies between head and tail.
+        if ( s->head + jmpSize >= s->tail )
+            return NULL;
+    }
+    else if ( s->head + jmpSize + sizeof( size_t ) >= s->cap ) {
+        if ( s->cnt && jmpSize >= s->tail )
+            return NULL;
+
         // Notifies the position to go back.
         *(size_t*)( s->buff + s->head ) = 0;
         s->head                         = 0;
     }
-    if ( s->cnt && s->head <= s->tail && s->head + jmpSize >= s->tail ) {
-        uassert( false );
-        return NULL;
-    }
 
     // The first sizeof(size_t) byte of allocated memory indicates next memory
     // block location.
@@ -26,7 +26,8 @@ void queue_allocator_init(
 /*! \brief Push new data into queue.
     \details
         First queue's head indexer will move firstly, then the data will be
-   returned. Internal data will be aligned by 4-byte order. */
+   returned. Internal data will be aligned by 4-byte order.
+    \returns NULL if the queue is full, or the size never fits. */
 void* queue_allocator_push( struct queue_allocator* s, size_t size );
 
 /*! \brief Pop data from queue. Not returns popped data. */
@@ -71,6 +71,46 @@ static inline size_t ring_buffer_read( ring_buffer_t* s, void* b, size_t len )
     return len;
 }
 
+/*! \brief      Get number of bytes that can be written without overwriting
+   unread data. One byte is always kept empty to distinguish full from empty. */
+static inline size_t ring_buffer_space( ring_buffer_t const* s )
+{
+    return s->cap - ring_buffer_size( s ) - 1;
+}
+
+/*! \brief      Get contiguous readable region starting from tail.
+    \details    Data can be used in place, then released by
+   ring_buffer_consume(). Wrapped data requires a second call after consuming.
+    \param      len Length of contiguous region will be returned. */
+static inline char* ring_buffer_linear_read( ring_buffer_t* s, size_t* len )
+{
+    *len = s->head >= s->tail ? s->head - s->tail : s->cap - s->tail;
+    return s->buff + s->tail;
+}
+
+/*! \brief      Get contiguous writable region starting from head.
+    \details    Fill the region in place, then call ring_buffer_commit().
+    \param      len Length of contiguous region will be returned. */
+static inline char* ring_buffer_linear_write( ring_buffer_t* s, size_t* len )
+{
+    if ( s->head >= s->tail )
+        *len = s->cap - s->head - ( s->tail == 0 );
+    else
+        *len = s->tail - s->head - 1;
+    return s->buff + s->head;
+}
+
+/*! \brief      Push data which was written in place through
+   ring_buffer_linear_write(). */
+static inline void ring_buffer_commit( ring_buffer_t* s, size_t len )
+{
+    s->head += len;
+
+    if ( s->head >= s->cap ) {
+        s->head = s->head - s->cap;
+    }
+}
+
 //! @}
 //! @}
 
@@ -0,0 +1,345 @@
+#include "slab_allocator.h"
+#include <string.h>
+#include "uassert.h"
+
+typedef slab_allocator_t desc_t;
+
+enum
+{
+    //! Header is padded to alignment so blocks stay aligned.
+    HEADER_SIZE = SLAB_ALIGN,
+
+    //! Class index of blocks from backing allocator.
+    CLASS_LARGE = 0xff
+};
+
+//! Front of the HEADER_SIZE bytes which precede every block.
+struct block_header
+{
+    uint8_t  cls;
+    uint8_t  bFree;
+    uint16_t reserved;
+
+    //! Distance from the slab which holds this block.
+    uint32_t slabOffset;
+};
+
+//! Front of every slab.
+struct slab_head
+{
+    void*    next;
+    uint32_t numLive;
+    uint32_t cls;
+};
+
+#define HEAD_SIZE                                                              \
+    ( ( sizeof( struct slab_head ) + SLAB_ALIGN - 1 )                          \
+      & ~(size_t)( SLAB_ALIGN - 1 ) )
+
+static size_t const g_defaultClasses[]
+    = { 16, 32, 64, 128, 256, 512, 1024 };
+
+static inline size_t align_up( size_t v )
+{
+    return ( v + SLAB_ALIGN - 1 ) & ~(size_t)( SLAB_ALIGN - 1 );
+}
+
+static inline struct block_header* header_of( void* p )
+{
+    return (struct block_header*)( (char*)p - HEADER_SIZE );
+}
+
+static inline struct slab_head* slab_of( void* p )
+{
+    return (struct slab_head*)( (char*)p - header_of( p )->slabOffset );
+}
+
+static inline size_t blocks_per_slab( desc_t* s, struct slab_class* c )
+{
+    return ( s->slabSize - HEAD_SIZE ) / c->blockSize;
+}
+
+//! k-th block of slab.
+static inline char*
+block_at( struct slab_head* slab, size_t blockSize, size_t k )
+{
+    return (char*)slab + HEAD_SIZE + k * blockSize + HEADER_SIZE;
+}
+
+static void* iface_allocate( void* obj, size_t size )
+{
+    return slab_alloc( (desc_t*)obj, size );
+}
+
+static void iface_release( void* obj, void* p )
+{
+    slab_free( (desc_t*)obj, p );
+}
+
+void slab_allocator_init(
+    slab_allocator_t* s,
+    allocator_ref_t   backing,
+    size_t const*     sizeClasses,
+    size_t            numClasses,
+    size_t            slabSize )
+{
+    size_t i, largest;
+
+    if ( sizeClasses == NULL ) {
+        sizeClasses = g_defaultClasses;
+        numClasses  = sizeof( g_defaultClasses ) / sizeof( *g_defaultClasses );
+    }
+    uassert( numClasses > 0 && numClasses <= SLAB_MAX_CLASSES );
+    uassert( sizeof( struct block_header ) <= HEADER_SIZE );
+
+    memset( s, 0, sizeof( *s ) );
+    s->backing        = backing ? backing : &g_mallocator;
+    s->numClasses     = numClasses;
+    s->iface.allocate = iface_allocate;
+    s->iface.release  = iface_release;
+    s->iface.object   = s;
+
+    for ( i = 0; i < numClasses; ++i ) {
+        uassert( i == 0 || sizeClasses[i] > sizeClasses[i - 1] );
+        s->classes[i].blockSize = HEADER_SIZE + align_up( sizeClasses[i] );
+    }
+
+    // Each slab starts with a link to the next slab.
+    largest     = s->classes[numClasses - 1].blockSize + HEAD_SIZE;
+    slabSize    = slabSize ? slabSize : SLAB_DEFAULT_SLAB_SIZE;
+    s->slabSize = slabSize > largest ? slabSize : largest;
+}
+
+void slab_allocator_destroy( slab_allocator_t* s )
+{
+    void*  next;
+    size_t i;
+
+    for ( ; s->slabs; s->slabs = next ) {
+        next = ( (struct slab_head*)s->slabs )->next;
+        s->backing->release( s->backing->object, s->slabs );
+    }
+
+    for ( i = 0; i < s->numClasses; ++i ) {
+        s->classes[i].freeList = NULL;
+        s->classes[i].numFree = s->classes[i].numTotal = 0;
+    }
+}
+
+//! Carve a new slab into blocks of given class.
+static bool refill( desc_t* s, struct slab_class* c )
+{
+    struct slab_head*    slab;
+    struct block_header* h;
+    char*                p;
+    size_t               n, k;
+
+    slab = (struct slab_head*)s->backing->allocate(
+        s->backing->object, s->slabSize );
+    if ( slab == NULL )
+        return false;
+
+    slab->next    = s->slabs;
+    slab->numLive = 0;
+    slab->cls     = (uint32_t)( c - s->classes );
+    s->slabs      = slab;
+
+    // Blocks are pushed in reverse, so lower addresses are handed out first.
+    n = blocks_per_slab( s, c );
+    for ( k = n; k--; ) {
+        p             = block_at( slab, c->blockSize, k );
+        h             = header_of( p );
+        h->cls        = (uint8_t)slab->cls;
+        h->bFree      = true;
+        h->slabOffset = (uint32_t)( p - (char*)slab );
+        *(void**)p    = c->freeList;
+        c->freeList   = p;
+    }
+
+    c->numFree += n;
+    c->numTotal += n;
+    return true;
+}
+
+//! Pop a block of a class which has free one.
+static void* pop( struct slab_class* c )
+{
+    void* p     = c->freeList;
+    c->freeList = *(void**)p;
+    --c->numFree;
+
+    header_of( p )->bFree = false;
+    ++slab_of( p )->numLive;
+    return p;
+}
+
+void* slab_alloc( slab_allocator_t* s, size_t size )
+{
+    struct slab_class* c;
+    uint8_t*           p;
+    size_t             i;
+
+    for ( i = 0; i < s->numClasses; ++i )
+        if ( s->classes[i].blockSize - HEADER_SIZE >= size )
+            break;
+
+    if ( i == s->numClasses ) {
+        p = (uint8_t*)s->backing->allocate(
+            s->backing->object, HEADER_SIZE + size );
+        if ( p == NULL )
+            return NULL;
+        p[0] = CLASS_LARGE;
+        return p + HEADER_SIZE;
+    }
+
+    c = s->classes + i;
+    if ( c->freeList == NULL && !refill( s, c ) )
+        return NULL;
+
+    return pop( c );
+}
+
+void slab_free( slab_allocator_t* s, void* ptr )
+{
+    struct block_header* h;
+    struct slab_class*   c;
+
+    if ( ptr == NULL )
+        return;
+
+    h = header_of( ptr );
+    if ( h->cls == CLASS_LARGE ) {
+        s->backing->release( s->backing->object, h );
+        return;
+    }
+
+    uassert( h->cls < s->numClasses && !h->bFree );
+    c        = s->classes + h->cls;
+    h->bFree = true;
+    --slab_of( ptr )->numLive;
+    ++c->numFree;
+
+    // Free lists are rebuilt when compaction ends.
+    if ( s->bCompacting )
+        return;
+
+    *(void**)ptr = c->freeList;
+    c->freeList  = ptr;
+}
+
+//! Sort slabs fullest first. Insertion sort, as slabs are few.
+static void sort_slabs( desc_t* s )
+{
+    struct slab_head*  sorted = NULL;
+    struct slab_head*  slab;
+    struct slab_head** pos;
+
+    while ( s->slabs ) {
+        slab     = (struct slab_head*)s->slabs;
+        s->slabs = slab->next;
+
+        pos = &sorted;
+        while ( *pos && ( *pos )->numLive >= slab->numLive )
+            pos = (struct slab_head**)&( *pos )->next;
+
+        slab->next = *pos;
+        *pos       = slab;
+    }
+
+    s->slabs = sorted;
+}
+
+/*! Rebuild free lists from block headers, so blocks of fuller slabs and lower
+    addresses are handed out first.
+    \returns    Bytes returned to backing allocator. */
+static size_t rebuild( desc_t* s, bool bRelease )
+{
+    void**             tails[SLAB_MAX_CLASSES];
+    struct slab_head*  slab;
+    struct slab_head** link;
+    struct slab_class* c;
+    char*              p;
+    size_t             i, k, n, released = 0;
+
+    sort_slabs( s );
+
+    for ( i = 0; i < s->numClasses; ++i ) {
+        c           = s->classes + i;
+        c->freeList = NULL;
+        c->numFree  = 0;
+        c->numTotal = 0;
+        tails[i]    = &c->freeList;
+    }
+
+    for ( link = (struct slab_head**)&s->slabs; ( slab = *link ) != NULL; ) {
+        if ( bRelease && slab->numLive == 0 ) {
+            *link = (struct slab_head*)slab->next;
+            s->backing->release( s->backing->object, slab );
+            released += s->slabSize;
+            continue;
+        }
+
+        c = s->classes + slab->cls;
+        n = blocks_per_slab( s, c );
+        for ( k = 0; k < n; ++k ) {
+            p = block_at( slab, c->blockSize, k );
+            if ( !header_of( p )->bFree )
+                continue;
+
+            *tails[slab->cls] = p;
+            tails[slab->cls]  = (void**)p;
+            ++c->numFree;
+        }
+
+        c->numTotal += n;
+        link = (struct slab_head**)&slab->next;
+    }
+
+    for ( i = 0; i < s->numClasses; ++i )
+        *tails[i] = NULL;
+
+    return released;
+}
+
+size_t slab_allocator_trim( slab_allocator_t* s )
+{
+    uassert( !s->bCompacting );
+    return rebuild( s, true );
+}
+
+void slab_compact_begin( slab_allocator_t* s )
+{
+    uassert( !s->bCompacting );
+    rebuild( s, false );
+    s->bCompacting = true;
+}
+
+void* slab_compact_move( slab_allocator_t* s, void* p )
+{
+    struct block_header* h = header_of( p );
+    struct slab_class*   c;
+    struct slab_head *   from, *to;
+
+    uassert( s->bCompacting );
+    if ( h->cls == CLASS_LARGE )
+        return NULL;
+
+    // Free list head lives in the fullest slab which has room.
+    c = s->classes + h->cls;
+    if ( c->freeList == NULL )
+        return NULL;
+
+    from = slab_of( p );
+    to   = slab_of( c->freeList );
+    if ( to == from || to->numLive < from->numLive )
+        return NULL;
+
+    return pop( c );
+}
+
+size_t slab_compact_end( slab_allocator_t* s )
+{
+    uassert( s->bCompacting );
+    s->bCompacting = false;
+    return slab_allocator_trim( s );
+}
@@ -0,0 +1,137 @@
+/*! \brief Size-class slab allocator.
+    \file slab_allocator.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Requests are rounded up to the smallest size class which fits. Each
+   class keeps a free list of fixed-size blocks carved from slabs, which are
+   taken from a backing allocator_t. Allocation and release pop and push the
+   free list, thus O(1), and blocks of a class never fragment each other.
+   Requests larger than the largest class go to the backing allocator.
+        Every block is preceded by a small header which records its class, as
+   allocator_t::release() doesn't pass the size. Blocks are aligned to
+   SLAB_ALIGN bytes. Slabs are kept until slab_allocator_trim() finds them
+   empty, or slab_allocator_destroy().
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Slab_Allocator
+//! @{
+
+enum
+{
+    SLAB_MAX_CLASSES = 16,
+
+    //! \brief      Alignment of blocks. As large as alignof(max_align_t) of
+    //!             common targets, so blocks can hold anything malloc() does.
+    SLAB_ALIGN = 16,
+
+    //! \brief      Default slab size in bytes.
+    SLAB_DEFAULT_SLAB_SIZE = 4096
+};
+
+//! \brief      A size class.
+struct slab_class
+{
+    size_t blockSize;
+    void*  freeList;
+    size_t numFree;
+    size_t numTotal;
+};
+
+//! \brief      Slab allocator descriptor.
+struct slab_allocator
+{
+    allocator_ref_t   backing;
+    size_t            slabSize;
+    struct slab_class classes[SLAB_MAX_CLASSES];
+    size_t            numClasses;
+
+    //! \brief      Singly linked list of slabs, released on destroy.
+    void* slabs;
+
+    //! \brief      allocator_t interface bound to this instance.
+    allocator_t iface;
+
+    //! \brief      Between slab_compact_begin() and slab_compact_end().
+    bool bCompacting;
+};
+
+typedef struct slab_allocator slab_allocator_t;
+
+/*! \brief      Initialize slab allocator.
+    \param      backing
+                 Allocator for slabs and oversized requests. NULL for
+                g_mallocator.
+    \param      sizeClasses
+                 Ascending block sizes. NULL for default classes of 16 to 1024
+                bytes in powers of two.
+    \param      slabSize
+                 Bytes requested from backing allocator at once. 0 for
+                SLAB_DEFAULT_SLAB_SIZE. Grows to hold at least one block of the
+                largest class. */
+void slab_allocator_init(
+    slab_allocator_t* s,
+    allocator_ref_t   backing,
+    size_t const*     sizeClasses,
+    size_t            numClasses,
+    size_t            slabSize );
+
+//! \brief      Release every slab. Outstanding blocks become invalid, while
+//!             oversized blocks must have been freed beforehand.
+void slab_allocator_destroy( slab_allocator_t* s );
+
+//! \brief      Allocate a block. Returns NULL if backing allocator fails.
+void* slab_alloc( slab_allocator_t* s, size_t size );
+
+//! \brief      Return a block. NULL is ignored.
+void slab_free( slab_allocator_t* s, void* p );
+
+/*! \brief      Return slabs without any live block to backing allocator.
+    \details    Free lists are rebuilt, so blocks of fuller slabs at lower
+   addresses are handed out first.
+    \returns    Number of bytes released. */
+size_t slab_allocator_trim( slab_allocator_t* s );
+
+/*! \brief      Start compaction.
+    \details    Owner of the blocks relocates live ones by slab_compact_move(),
+   then calls slab_compact_end(). Meanwhile, freed blocks aren't reused. */
+void slab_compact_begin( slab_allocator_t* s );
+
+/*! \brief      Take a block to relocate p into.
+    \details    The new block is of the same class, in a slab at least as full
+   as p's one, thus moving objects drains sparse slabs. Copy the contents,
+   then slab_free() p.
+    \returns    NULL if p is better left where it is. */
+void* slab_compact_move( slab_allocator_t* s, void* p );
+
+//! \brief      Finish compaction, then trim.
+//! \returns    Number of bytes released.
+size_t slab_compact_end( slab_allocator_t* s );
+
+//! \brief      Get allocator_t interface which forwards to this instance.
+static inline allocator_ref_t slab_allocator_ref( slab_allocator_t* s )
+{
+    return &s->iface;
+}
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
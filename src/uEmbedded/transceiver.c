@@ -1 +1,49 @@
 #include "transceiver.h"
+
+transceiver_result_t td_readv_generic(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    transceiver_result_t total = 0, r;
+    size_t               i;
+
+    for ( i = 0; i < iovcnt; ++i ) {
+        if ( iov[i].len == 0 )
+            continue;
+
+        r = td_read( desc, (char*)iov[i].base, iov[i].len );
+        if ( r < 0 )
+            return total ? total : r;
+
+        total += r;
+        if ( (size_t)r < iov[i].len )
+            break;
+    }
+
+    return total;
+}
+
+transceiver_result_t td_writev_generic(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    transceiver_result_t total = 0, r;
+    size_t               i;
+
+    for ( i = 0; i < iovcnt; ++i ) {
+        if ( iov[i].len == 0 )
+            continue;
+
+        r = td_write( desc, (char*)iov[i].base, iov[i].len );
+        if ( r < 0 )
+            return total ? total : r;
+
+        total += r;
+        if ( (size_t)r < iov[i].len )
+            break;
+    }
+
+    return total;
+}
@@ -22,12 +22,35 @@ enum
     TRANSCEIVER_INVALID_DATA  = -4,
     TRANSCEIVER_ALREADY_OPEN  = -5,
     TRANSCEIVER_CLOSED        = -6,
+    TRANSCEIVER_NOT_SUPPORTED = -7,
     //! \todo. Add more general error codes during developing process.
 
     TRANSCEIVER_IMPLEMENTATION_DOMAIN = -8000
 };
 
-/*! \brief      Function table to imitate the inheritance feature. */
+/*! \brief          Generic control commands for ioctl. Each implementation
+   should forward commands it does not understand to its underlying transceiver,
+   if any, so that transceivers can be stacked. \details Commands over
+   TRANSCEIVER_IOCTL_IMPLEMENTATION_DOMAIN are regarded as implementation
+   specific. */
+enum
+{
+    //! \brief      Push out every pending byte.
+    TRANSCEIVER_IOCTL_FLUSH = 1,
+
+    TRANSCEIVER_IOCTL_IMPLEMENTATION_DOMAIN = 0x1000
+};
+
+/*! \brief      Scatter/gather element for vectored IO. */
+typedef struct transceiver_iovec
+{
+    void*  base;
+    size_t len;
+} transceiver_iovec_t;
+
+/*! \brief      Function table to imitate the inheritance feature.
+    \details    Members after close are optional, and can be left as NULL.
+   Generic implementation will be used instead. */
 struct transceiver_vtable
 {
     //! \brief      This must be implemented as non-block IO
@@ -45,6 +68,33 @@ struct transceiver_vtable
 
     //! Controls IO
     transceiver_result_t ( *close )( void* /*obj*/ );
+
+    //! \brief      Optional. Scatter read into multiple buffers in order.
+    //!             Falls back to repeated read() calls if NULL.
+    transceiver_result_t ( *readv )(
+        void* /*obj*/,
+        transceiver_iovec_t const* /*iov*/,
+        size_t /*iovcnt*/ );
+
+    //! \brief      Optional. Gather write from multiple buffers in order.
+    //!             Falls back to repeated write() calls if NULL.
+    transceiver_result_t ( *writev )(
+        void* /*obj*/,
+        transceiver_iovec_t const* /*iov*/,
+        size_t /*iovcnt*/ );
+
+    //! \brief      Optional. Lend internal receive buffer to the caller.
+    //! \details    Caller may parse, and even modify the loaned memory in
+    //!             place, until it returns the buffer by release(). Only one
+    //!             loan can be active at once.
+    //! \returns    Number of readable bytes at *buf. Otherwise 0 or negative
+    //!             value to indicate there is no data or the operation failed.
+    transceiver_result_t ( *loan )( void* /*obj*/, char** /*buf*/ );
+
+    //! \brief      Optional. Return loaned buffer. First 'consumed' bytes are
+    //!             removed from receive buffer, rest will be returned by the
+    //!             next read or loan.
+    transceiver_result_t ( *release )( void* /*obj*/, size_t /*consumed*/ );
 };
 
 //! Alias to easy use.
@@ -99,6 +149,58 @@ static inline transceiver_result_t td_close( transceiver_handle_t desc )
     transceiver_vtable_t const* td = ( (tr_desc_t__)desc )->vt_;
     return td->close( (void*)desc );
 }
+
+//! Generic scatter read through read(). Stops on first short read.
+transceiver_result_t td_readv_generic(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt );
+
+//! Generic gather write through write(). Stops on first short write.
+transceiver_result_t td_writev_generic(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt );
+
+//! Read data from the transceiver into multiple buffers.
+static inline transceiver_result_t td_readv(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    transceiver_vtable_t const* td = ( (tr_desc_t__)desc )->vt_;
+    return td->readv ? td->readv( (void*)desc, iov, iovcnt )
+                     : td_readv_generic( desc, iov, iovcnt );
+}
+
+//! Write data from multiple buffers into the transceiver.
+static inline transceiver_result_t td_writev(
+    transceiver_handle_t       desc,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    transceiver_vtable_t const* td = ( (tr_desc_t__)desc )->vt_;
+    return td->writev ? td->writev( (void*)desc, iov, iovcnt )
+                      : td_writev_generic( desc, iov, iovcnt );
+}
+
+//! Borrow receive buffer of the transceiver.
+//! \returns    TRANSCEIVER_NOT_SUPPORTED if the transceiver can't lend.
+static inline transceiver_result_t
+td_loan( transceiver_handle_t desc, char** buf )
+{
+    transceiver_vtable_t const* td = ( (tr_desc_t__)desc )->vt_;
+    return td->loan ? td->loan( (void*)desc, buf ) : TRANSCEIVER_NOT_SUPPORTED;
+}
+
+//! Return borrowed receive buffer.
+static inline transceiver_result_t
+td_release( transceiver_handle_t desc, size_t consumed )
+{
+    transceiver_vtable_t const* td = ( (tr_desc_t__)desc )->vt_;
+    return td->release ? td->release( (void*)desc, consumed )
+                       : TRANSCEIVER_NOT_SUPPORTED;
+}
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
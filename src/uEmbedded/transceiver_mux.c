@@ -0,0 +1,330 @@
+#include "transceiver_mux.h"
+#include <string.h>
+#include "uassert.h"
+
+typedef struct mux_channel channel_t;
+
+static inline size_t min_size( size_t a, size_t b ) { return a < b ? a : b; }
+
+static inline void next_channel( transceiver_mux_t* s )
+{
+    s->cursor = ( s->cursor + 1 ) % s->numChannels;
+    s->bTurn  = false;
+}
+
+transceiver_result_t mux_pump( transceiver_mux_t* s )
+{
+    channel_t*           ch;
+    uint8_t              hdr[MUX_HEADER_SIZE];
+    char*                ptr;
+    size_t               len, frame, idle = 0, pending = 0, i;
+    transceiver_result_t r;
+
+    while ( idle < s->numChannels ) {
+        ch = s->channels + s->cursor;
+
+        // Finish the frame in progress first. It can't be interleaved.
+        if ( s->txRemain ) {
+            ptr = ring_buffer_linear_read( &ch->tx, &len );
+            len = min_size( len, s->txRemain );
+            r   = td_write( s->parent, ptr, len );
+            if ( r < 0 )
+                return r;
+
+            ring_buffer_consume( &ch->tx, (size_t)r );
+            s->txRemain -= (size_t)r;
+            if ( (size_t)r < len )
+                break;
+
+            // Channel closed meanwhile drops frames queued after this one.
+            if ( s->txRemain == 0 && !ch->bOpen )
+                ring_buffer_consume( &ch->tx, ring_buffer_size( &ch->tx ) );
+            continue;
+        }
+
+        // Idle channels don't accumulate credit.
+        if ( !ch->bOpen || ch->tx.buff == NULL
+             || ring_buffer_size( &ch->tx ) == 0 ) {
+            ch->deficit = 0;
+            next_channel( s );
+            ++idle;
+            continue;
+        }
+        idle = 0;
+
+        if ( !s->bTurn ) {
+            ch->deficit += ch->quantum;
+            s->bTurn = true;
+        }
+
+        ring_buffer_peek( &ch->tx, hdr, MUX_HEADER_SIZE );
+        frame = MUX_HEADER_SIZE + ( hdr[1] | (size_t)hdr[2] << 8 );
+        if ( frame > ch->deficit ) {
+            next_channel( s );
+            continue;
+        }
+
+        ch->deficit -= frame;
+        s->txRemain = frame;
+    }
+
+    for ( i = 0; i < s->numChannels; ++i )
+        if ( s->channels[i].tx.buff )
+            pending += ring_buffer_size( &s->channels[i].tx );
+
+    return (transceiver_result_t)pending;
+}
+
+/*! \brief      Receive header of next frame, discarding frames nobody owns.
+    \returns    1 if a frame is ready. Otherwise 0 or error from the parent. */
+static transceiver_result_t rx_header( transceiver_mux_t* s )
+{
+    char                 discard[64];
+    channel_t*           ch;
+    transceiver_result_t r;
+
+    for ( ;; ) {
+        while ( s->hdrLen < MUX_HEADER_SIZE ) {
+            r = td_read(
+                s->parent,
+                (char*)s->hdr + s->hdrLen,
+                MUX_HEADER_SIZE - s->hdrLen );
+            if ( r <= 0 )
+                return r;
+
+            s->hdrLen += (uint8_t)r;
+            if ( s->hdrLen == MUX_HEADER_SIZE )
+                s->rxRemain = (uint16_t)( s->hdr[1] | s->hdr[2] << 8 );
+        }
+
+        ch = s->hdr[0] < s->numChannels ? s->channels + s->hdr[0] : NULL;
+        if ( s->rxRemain && ch && ch->bOpen )
+            return 1;
+
+        while ( s->rxRemain ) {
+            r = td_read(
+                s->parent, discard, min_size( sizeof discard, s->rxRemain ) );
+            if ( r <= 0 )
+                return r;
+            s->rxRemain -= (uint16_t)r;
+        }
+
+        s->numDropped += s->hdrLen != 0;
+        s->hdrLen = 0;
+    }
+}
+
+static inline void rx_advance( transceiver_mux_t* s, size_t consumed )
+{
+    s->rxRemain -= (uint16_t)consumed;
+    if ( s->rxRemain == 0 )
+        s->hdrLen = 0;
+}
+
+transceiver_result_t mux_poll( transceiver_mux_t* s )
+{
+    channel_t*           ch;
+    transceiver_result_t r, n = 0;
+    uint16_t             remain;
+
+    while ( ( r = rx_header( s ) ) > 0 ) {
+        ch = s->channels + s->hdr[0];
+        if ( ch->notify == NULL )
+            break;
+
+        remain = s->rxRemain;
+        ch->notify( ch->obj, (transceiver_handle_t)ch );
+        if ( s->hdrLen == MUX_HEADER_SIZE && s->rxRemain == remain )
+            break;
+        ++n;
+    }
+
+    return r < 0 && n == 0 ? r : n;
+}
+
+static transceiver_result_t
+read_impl( void* obj, char* rdbuf, size_t rdcnt )
+{
+    channel_t*           ch = (channel_t*)obj;
+    transceiver_mux_t*   s  = ch->mux;
+    transceiver_result_t r;
+
+    r = rx_header( s );
+    if ( r <= 0 || s->hdr[0] != ch->id )
+        return r < 0 ? r : 0;
+
+    // Payload goes straight into caller's buffer. Stops at frame boundary.
+    r = td_read( s->parent, rdbuf, min_size( rdcnt, s->rxRemain ) );
+    if ( r > 0 )
+        rx_advance( s, (size_t)r );
+    return r;
+}
+
+static transceiver_result_t writev_impl(
+    void*                      obj,
+    transceiver_iovec_t const* iov,
+    size_t                     iovcnt )
+{
+    channel_t*         ch = (channel_t*)obj;
+    transceiver_mux_t* s  = ch->mux;
+    size_t             total = 0, space, len, i;
+    uint8_t            hdr[MUX_HEADER_SIZE];
+
+    if ( ch->tx.buff == NULL )
+        return TRANSCEIVER_NOT_SUPPORTED;
+
+    for ( i = 0; i < iovcnt; ++i )
+        total += iov[i].len;
+
+    if ( ring_buffer_space( &ch->tx ) < MUX_HEADER_SIZE + total ) {
+        transceiver_result_t r = mux_pump( s );
+        if ( r < 0 )
+            return r;
+    }
+
+    // Every write becomes single frame, truncated to available space.
+    space = ring_buffer_space( &ch->tx );
+    if ( space <= MUX_HEADER_SIZE || total == 0 )
+        return 0;
+
+    space  = min_size( space - MUX_HEADER_SIZE, MUX_MAX_PAYLOAD );
+    total  = min_size( total, space );
+    hdr[0] = ch->id;
+    hdr[1] = (uint8_t)total;
+    hdr[2] = (uint8_t)( total >> 8 );
+    ring_buffer_write( &ch->tx, hdr, MUX_HEADER_SIZE );
+
+    for ( i = 0, len = total; len; ++i ) {
+        size_t n = min_size( iov[i].len, len );
+        ring_buffer_write( &ch->tx, iov[i].base, n );
+        len -= n;
+    }
+
+    return (transceiver_result_t)total;
+}
+
+static transceiver_result_t
+write_impl( void* obj, char const* wrbuf, size_t wrcnt )
+{
+    transceiver_iovec_t iov = { (void*)wrbuf, wrcnt };
+    return writev_impl( obj, &iov, 1 );
+}
+
+static transceiver_result_t ioctl_impl( void* obj, intptr_t cmd )
+{
+    channel_t*           ch = (channel_t*)obj;
+    transceiver_result_t r;
+
+    if ( cmd == TRANSCEIVER_IOCTL_FLUSH ) {
+        r = mux_pump( ch->mux );
+        if ( r < 0 )
+            return r;
+
+        td_ioctl( ch->mux->parent, cmd );
+        return ch->tx.buff
+                 ? (transceiver_result_t)ring_buffer_size( &ch->tx )
+                 : 0;
+    }
+
+    return td_ioctl( ch->mux->parent, cmd );
+}
+
+static transceiver_result_t close_impl( void* obj )
+{
+    channel_t* ch = (channel_t*)obj;
+
+    mux_pump( ch->mux );
+    ch->bOpen = false;
+
+    // Frame in progress is kept, as the stream can't be cut in the middle.
+    // The rest is dropped by mux_pump() once the frame is done.
+    if ( ch->tx.buff && !( ch->mux->txRemain && ch->mux->cursor == ch->id ) )
+        ring_buffer_consume( &ch->tx, ring_buffer_size( &ch->tx ) );
+    return TRANSCEIVER_OK;
+}
+
+static transceiver_result_t loan_impl( void* obj, char** buf )
+{
+    channel_t*           ch = (channel_t*)obj;
+    transceiver_mux_t*   s  = ch->mux;
+    transceiver_result_t r;
+
+    r = rx_header( s );
+    if ( r <= 0 || s->hdr[0] != ch->id )
+        return r < 0 ? r : 0;
+
+    r = td_loan( s->parent, buf );
+    if ( r <= 0 )
+        return r;
+    return (transceiver_result_t)min_size( (size_t)r, s->rxRemain );
+}
+
+static transceiver_result_t release_impl( void* obj, size_t consumed )
+{
+    channel_t*           ch = (channel_t*)obj;
+    transceiver_mux_t*   s  = ch->mux;
+    transceiver_result_t r;
+
+    uassert( consumed <= s->rxRemain );
+    r = td_release( s->parent, consumed );
+    if ( r == TRANSCEIVER_OK )
+        rx_advance( s, consumed );
+    return r;
+}
+
+static transceiver_vtable_t const g_vtable = { read_impl,
+                                               write_impl,
+                                               ioctl_impl,
+                                               close_impl,
+                                               NULL,
+                                               writev_impl,
+                                               loan_impl,
+                                               release_impl };
+
+void mux_init(
+    transceiver_mux_t*   s,
+    transceiver_handle_t parent,
+    struct mux_channel*  channels,
+    size_t               numChannels )
+{
+    uassert( s && parent && channels );
+    uassert( numChannels > 0 && numChannels <= 0xff );
+
+    memset( s, 0, sizeof( *s ) );
+    memset( channels, 0, sizeof( *channels ) * numChannels );
+    s->parent      = parent;
+    s->channels    = channels;
+    s->numChannels = numChannels;
+}
+
+transceiver_handle_t mux_channel_open(
+    transceiver_mux_t* s,
+    uint8_t            id,
+    void*              txbuf,
+    size_t             txSize,
+    size_t             quantum,
+    mux_notify_cb_t    notify,
+    void*              obj )
+{
+    channel_t* ch;
+
+    uassert( id < s->numChannels );
+    uassert( txbuf == NULL || txSize > MUX_HEADER_SIZE + 1 );
+
+    ch = s->channels + id;
+    uassert( !( s->txRemain && s->cursor == id ) );
+
+    memset( ch, 0, sizeof( *ch ) );
+    ch->vt_     = &g_vtable;
+    ch->mux     = s;
+    ch->quantum = quantum ? quantum : MUX_DEFAULT_QUANTUM;
+    ch->notify  = notify;
+    ch->obj     = obj;
+    ch->id      = id;
+    ch->bOpen   = true;
+
+    if ( txbuf )
+        ring_buffer_init( &ch->tx, txbuf, txSize );
+
+    return (transceiver_handle_t)ch;
+}
@@ -0,0 +1,147 @@
+/*! \brief Logical channel multiplexer over a single transceiver.
+    \file transceiver_mux.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Shares one parent transceiver between up to 255 logical channels. Each
+   channel is exposed as an ordinary transceiver_handle_t.
+        On the wire, every write of a channel is carried as a frame of
+   [channel u8][length u16 LE][payload].
+        Writes are queued in per-channel TX buffer, and transmitted by
+   mux_pump() with deficit round robin scheduling. Each channel is credited
+   with its quantum on every round, thus bulk traffic on one channel can't
+   starve the others.
+        Received payload is never buffered by the mux. A read on a channel
+   pulls the payload of current frame straight from the parent into the
+   caller's buffer, and td_loan() lends the parent's loaned buffer as-is.
+   While current frame belongs to another channel, reads return 0. Frames of
+   closed channels are discarded.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "ring_buffer.h"
+#include "transceiver.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Transceiver_Mux
+//! @{
+
+enum
+{
+    //! \brief      Size of frame header.
+    MUX_HEADER_SIZE = 3,
+
+    //! \brief      Maximum payload of single frame.
+    MUX_MAX_PAYLOAD = 0xffff,
+
+    //! \brief      Quantum used when 0 is given.
+    MUX_DEFAULT_QUANTUM = 256
+};
+
+struct transceiver_mux;
+
+//! \brief      Called from mux_poll() when a frame for the channel arrives.
+//!             Read the channel inside the callback to consume it.
+typedef void ( *mux_notify_cb_t )( void* /*obj*/, transceiver_handle_t /*h*/ );
+
+//! \brief      Logical channel.
+struct mux_channel
+{
+    //! \brief      Must be placed at first. See transceiver_handle_t.
+    transceiver_vtable_t const* vt_;
+
+    struct transceiver_mux* mux;
+    ring_buffer_t           tx;
+
+    //! \brief      Bytes credited on each scheduling round.
+    size_t quantum;
+    size_t deficit;
+
+    mux_notify_cb_t notify;
+    void*           obj;
+
+    uint8_t id;
+    bool    bOpen;
+};
+
+//! \brief      Multiplexer descriptor.
+struct transceiver_mux
+{
+    transceiver_handle_t parent;
+    struct mux_channel*  channels;
+    size_t               numChannels;
+
+    // TX scheduler
+    size_t cursor;
+    size_t txRemain;
+    bool   bTurn;
+
+    // RX demultiplexer
+    uint8_t  hdr[MUX_HEADER_SIZE];
+    uint8_t  hdrLen;
+    uint16_t rxRemain;
+
+    //! \brief      Number of received frames discarded.
+    size_t numDropped;
+};
+
+typedef struct transceiver_mux transceiver_mux_t;
+
+/*! \brief      Initialize multiplexer.
+    \param      channels
+                 Channel storage. Index of the array is used as channel id. */
+void mux_init(
+    transceiver_mux_t*   s,
+    transceiver_handle_t parent,
+    struct mux_channel*  channels,
+    size_t               numChannels );
+
+/*! \brief      Open channel.
+    \param      txbuf
+                 TX queue of the channel. Holds frame headers as well. Can be
+                NULL for receive-only channel.
+    \param      quantum
+                 Scheduling weight, in bytes per round.
+    \returns    Transceiver handle of the channel. */
+transceiver_handle_t mux_channel_open(
+    transceiver_mux_t* s,
+    uint8_t            id,
+    void*              txbuf,
+    size_t             txSize,
+    size_t             quantum,
+    mux_notify_cb_t    notify,
+    void*              obj );
+
+/*! \brief      Transmit queued frames until the parent stops accepting data.
+    \returns    Number of bytes still queued, or negative error code. */
+transceiver_result_t mux_pump( transceiver_mux_t* s );
+
+/*! \brief      Dispatch received frames to notify callbacks of channels.
+    \details    Stops on a frame which wasn't consumed by its callback.
+    \returns    Number of frames dispatched, or negative error code. */
+transceiver_result_t mux_poll( transceiver_mux_t* s );
+
+/*! \brief      Get channel id of the frame currently being received.
+    \returns    -1 if header of next frame hasn't arrived yet. */
+static inline int mux_rx_channel( transceiver_mux_t const* s )
+{
+    return s->hdrLen == MUX_HEADER_SIZE ? s->hdr[0] : -1;
+}
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
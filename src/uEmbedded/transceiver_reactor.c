@@ -0,0 +1,298 @@
+#include "transceiver_reactor.h"
+#include <string.h>
+#include "uassert.h"
+
+#if REACTOR_HAS_EPOLL
+#    include <sys/epoll.h>
+#    include <unistd.h>
+#endif
+
+typedef struct reactor_source source_t;
+
+//! Parameter bundle copied into event queue.
+struct reactor_event
+{
+    transceiver_reactor_t* r;
+    struct fslist_node*    n;
+    uint32_t               id;
+    uint32_t               events;
+};
+
+#if REACTOR_HAS_EPOLL
+static inline uint32_t to_epoll( uint32_t interest )
+{
+    return ( interest & REACTOR_READABLE ? EPOLLIN : 0 )
+           | ( interest & REACTOR_WRITABLE ? EPOLLOUT : 0 );
+}
+
+static inline uint32_t from_epoll( uint32_t events )
+{
+    return ( events & EPOLLIN ? REACTOR_READABLE : 0 )
+           | ( events & EPOLLOUT ? REACTOR_WRITABLE : 0 )
+           | ( events & ( EPOLLERR | EPOLLHUP ) ? REACTOR_ERROR : 0 );
+}
+#endif
+
+static inline source_t*
+source_of( transceiver_reactor_t* s, reactor_handle_t rh )
+{
+    source_t* src;
+
+    if ( rh.n == NULL || !fslist_node_in_range( &s->sources, rh.n )
+         || !rh.n->isValid )
+        return NULL;
+
+    src = (source_t*)fslist_data( &s->sources, rh.n );
+    return src->id == rh.id ? src : NULL;
+}
+
+size_t reactor_init(
+    transceiver_reactor_t* s,
+    struct EventQueue*     queue,
+    void*                  buff,
+    size_t                 buffSize )
+{
+    uassert( s && queue && buff );
+
+    s->queue     = queue;
+    s->idGen     = 0;
+    s->numPolled = 0;
+#if REACTOR_HAS_EPOLL
+    s->epfd = epoll_create1( EPOLL_CLOEXEC );
+    if ( s->epfd < 0 )
+        return 0;
+#else
+    s->epfd = -1;
+#endif
+
+    // fslist can't be initialized without room for a node.
+    if ( buffSize < REACTOR_ELEM_SIZE
+         || fslist_init( &s->sources, buff, buffSize, sizeof( source_t ) )
+                == 0 ) {
+        reactor_destroy( s );
+        return 0;
+    }
+    return s->sources.capacity;
+}
+
+void reactor_destroy( transceiver_reactor_t* s )
+{
+#if REACTOR_HAS_EPOLL
+    if ( s->epfd >= 0 )
+        close( s->epfd );
+#endif
+    s->epfd = -1;
+}
+
+static reactor_handle_t add_source(
+    transceiver_reactor_t* s,
+    transceiver_handle_t   h,
+    int                    fd,
+    reactor_poll_cb_t      poll,
+    uint32_t               interest,
+    reactor_event_cb_t     callback,
+    void*                  obj )
+{
+    reactor_handle_t ret = { NULL, 0 };
+    source_t*        src;
+
+    uassert( s && callback );
+    if ( s->sources.inactive == FSLIST_NODEIDX_NONE )
+        return ret;
+
+    ret.n = fslist_insert( &s->sources, NULL );
+    src   = (source_t*)fslist_data( &s->sources, ret.n );
+
+    src->handle   = h;
+    src->poll     = poll;
+    src->callback = callback;
+    src->obj      = obj;
+    src->interest = interest;
+    src->id       = s->idGen++;
+    src->fd       = fd;
+
+    ret.id = src->id;
+    return ret;
+}
+
+reactor_handle_t reactor_add_fd(
+    transceiver_reactor_t* s,
+    transceiver_handle_t   h,
+    int                    fd,
+    uint32_t               interest,
+    reactor_event_cb_t     callback,
+    void*                  obj )
+{
+    reactor_handle_t ret = { NULL, 0 };
+
+#if REACTOR_HAS_EPOLL
+    struct epoll_event ev;
+
+    if ( s->epfd < 0 || fd < 0 )
+        return ret;
+
+    ret = add_source( s, h, fd, NULL, interest, callback, obj );
+    if ( ret.n == NULL )
+        return ret;
+
+    // Node index and registration id let stale events be discarded.
+    memset( &ev, 0, sizeof( ev ) );
+    ev.events = to_epoll( interest );
+    ev.data.u64
+        = fslist_idx( &s->sources, ret.n ) | ( (uint64_t)ret.id << 32 );
+
+    if ( epoll_ctl( s->epfd, EPOLL_CTL_ADD, fd, &ev ) != 0 ) {
+        fslist_erase( &s->sources, ret.n );
+        ret.n = NULL;
+    }
+#else
+    (void)s, (void)h, (void)fd, (void)interest, (void)callback, (void)obj;
+#endif
+    return ret;
+}
+
+reactor_handle_t reactor_add_poll(
+    transceiver_reactor_t* s,
+    transceiver_handle_t   h,
+    reactor_poll_cb_t      poll,
+    uint32_t               interest,
+    reactor_event_cb_t     callback,
+    void*                  obj )
+{
+    reactor_handle_t ret;
+
+    uassert( poll );
+    ret = add_source( s, h, -1, poll, interest, callback, obj );
+    if ( ret.n )
+        ++s->numPolled;
+    return ret;
+}
+
+bool reactor_modify(
+    transceiver_reactor_t* s,
+    reactor_handle_t       rh,
+    uint32_t               interest )
+{
+    source_t* src = source_of( s, rh );
+    if ( src == NULL )
+        return false;
+
+#if REACTOR_HAS_EPOLL
+    if ( src->poll == NULL ) {
+        struct epoll_event ev;
+        memset( &ev, 0, sizeof( ev ) );
+        ev.events = to_epoll( interest );
+        ev.data.u64
+            = fslist_idx( &s->sources, rh.n ) | ( (uint64_t)rh.id << 32 );
+
+        if ( epoll_ctl( s->epfd, EPOLL_CTL_MOD, src->fd, &ev ) != 0 )
+            return false;
+    }
+#endif
+
+    src->interest = interest;
+    return true;
+}
+
+bool reactor_remove( transceiver_reactor_t* s, reactor_handle_t rh )
+{
+    source_t* src = source_of( s, rh );
+    if ( src == NULL )
+        return false;
+
+    if ( src->poll )
+        --s->numPolled;
+#if REACTOR_HAS_EPOLL
+    else
+        epoll_ctl( s->epfd, EPOLL_CTL_DEL, src->fd, NULL );
+#endif
+
+    src->id = (uint32_t)-1;
+    fslist_erase( &s->sources, rh.n );
+    return true;
+}
+
+static void dispatch( void* param )
+{
+    struct reactor_event* ev = (struct reactor_event*)param;
+    reactor_handle_t      rh = { ev->n, ev->id };
+    source_t*             src;
+
+    // Registration might be removed after the event was queued.
+    src = source_of( ev->r, rh );
+    if ( src )
+        src->callback( src->obj, src->handle, ev->events );
+}
+
+//! Returns false if the queue is full, thus the event is dropped.
+static inline bool
+post( transceiver_reactor_t* s, struct fslist_node* n, uint32_t events )
+{
+    struct reactor_event* ev = (struct reactor_event*)AllocEvent(
+        s->queue, dispatch, sizeof( struct reactor_event ) );
+    if ( ev == NULL )
+        return false;
+
+    ev->r      = s;
+    ev->n      = n;
+    ev->id     = ( (source_t*)fslist_data( &s->sources, n ) )->id;
+    ev->events = events;
+    return true;
+}
+
+size_t reactor_wait( transceiver_reactor_t* s, int timeoutMs )
+{
+    struct fslist_node* n;
+    source_t*           src;
+    uint32_t            events;
+    size_t              numPosted = 0;
+
+    uassert( s );
+
+    // Evaluate poll sources first. Any ready source prevents blocking.
+    if ( s->numPolled && s->sources.size ) {
+        for ( n = s->sources.get + s->sources.head; n;
+              n = fslist_next( &s->sources, n ) ) {
+            src = (source_t*)fslist_data( &s->sources, n );
+            if ( src->poll == NULL || src->interest == 0 )
+                continue;
+
+            events = src->poll( src->obj, src->handle, src->interest )
+                     & ( src->interest | REACTOR_ERROR );
+            if ( events && post( s, n, events ) )
+                ++numPosted;
+        }
+    }
+
+#if REACTOR_HAS_EPOLL
+    {
+        enum
+        {
+            NUM_BATCH = 64
+        };
+        struct epoll_event evs[NUM_BATCH];
+        int                i, cnt;
+        fslist_idx_t       idx;
+
+        cnt = epoll_wait( s->epfd, evs, NUM_BATCH, numPosted ? 0 : timeoutMs );
+
+        for ( i = 0; i < cnt; ++i ) {
+            idx = ( fslist_idx_t )( evs[i].data.u64 & 0xffffffffu );
+            n   = s->sources.get + idx;
+            if ( idx >= s->sources.capacity || !n->isValid )
+                continue;
+
+            src = (source_t*)fslist_data( &s->sources, n );
+            if ( src->id != ( uint32_t )( evs[i].data.u64 >> 32 ) )
+                continue;
+
+            if ( post( s, n, from_epoll( evs[i].events ) ) )
+                ++numPosted;
+        }
+    }
+#else
+    (void)timeoutMs;
+#endif
+
+    return numPosted;
+}
@@ -0,0 +1,161 @@
+/*! \brief Readiness reactor for transceivers.
+    \file transceiver_reactor.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-02
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Instead of calling td_read() on every transceiver in a loop, register
+   transceivers with the reactor and let it post readiness notifications into an
+   EventQueue. Only ready handles are touched by the event callbacks.
+        Transceivers backed by a file descriptor are watched through epoll on
+   Linux. Any other transceiver can be registered with a poll callback, which is
+   evaluated on each reactor_wait() call.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "event-procedure.h"
+#include "fslist.h"
+#include "transceiver.h"
+
+#if defined( __linux__ )
+#    define REACTOR_HAS_EPOLL 1
+#else
+#    define REACTOR_HAS_EPOLL 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Transceiver_Reactor
+//! @{
+
+//! \brief      Readiness flags.
+enum
+{
+    REACTOR_READABLE = 0x01,
+    REACTOR_WRITABLE = 0x02,
+    REACTOR_ERROR    = 0x04
+};
+
+//! \brief      Evaluates readiness of non-fd transceiver.
+//! \returns    Combination of REACTOR_* flags currently ready.
+typedef uint32_t ( *reactor_poll_cb_t )(
+    void* /*obj*/,
+    transceiver_handle_t /*h*/,
+    uint32_t /*interest*/ );
+
+//! \brief      Called from ProcessEvent() when a registered handle is ready.
+typedef void ( *reactor_event_cb_t )(
+    void* /*obj*/,
+    transceiver_handle_t /*h*/,
+    uint32_t /*events*/ );
+
+//! \brief      Registration entry. Stored in reactor's internal fslist.
+struct reactor_source
+{
+    transceiver_handle_t handle;
+    reactor_poll_cb_t    poll;
+    reactor_event_cb_t   callback;
+    void*                obj;
+    uint32_t             interest;
+    uint32_t             id;
+    int                  fd;
+};
+
+//! \brief      Reactor descriptor.
+struct transceiver_reactor
+{
+    struct fslist      sources;
+    struct EventQueue* queue;
+    uint32_t           idGen;
+
+    //! \brief      Number of sources registered with a poll callback.
+    size_t numPolled;
+
+    //! \brief      epoll instance. -1 if not available.
+    int epfd;
+};
+
+enum // Required to allocate buffer for size
+{
+    REACTOR_ELEM_SIZE = FSLIST_NODE_SIZE + sizeof( struct reactor_source )
+};
+
+struct reactor_handle
+{
+    struct fslist_node* n;
+    uint32_t            id;
+};
+
+typedef struct transceiver_reactor transceiver_reactor_t;
+typedef struct reactor_handle      reactor_handle_t;
+
+/*! \brief      Initialize reactor.
+    \param      queue
+                 Event queue which receives readiness notifications.
+    \param      buff
+                 Buffer for registration entries. Use REACTOR_ELEM_SIZE to
+                calculate required size.
+    \returns    Number of maximum registrations. 0 if initialization failed. */
+size_t reactor_init(
+    transceiver_reactor_t* s,
+    struct EventQueue*     queue,
+    void*                  buff,
+    size_t                 buffSize );
+
+/*! \brief      Release OS resources. Releasing buffer is up to the user. */
+void reactor_destroy( transceiver_reactor_t* s );
+
+/*! \brief      Register transceiver which is backed by file descriptor.
+    \note       Always fails if REACTOR_HAS_EPOLL is 0.
+    \returns    Registration handle. Its node is NULL on failure. */
+reactor_handle_t reactor_add_fd(
+    transceiver_reactor_t* s,
+    transceiver_handle_t   h,
+    int                    fd,
+    uint32_t               interest,
+    reactor_event_cb_t     callback,
+    void*                  obj );
+
+/*! \brief      Register transceiver with readiness evaluation callback. */
+reactor_handle_t reactor_add_poll(
+    transceiver_reactor_t* s,
+    transceiver_handle_t   h,
+    reactor_poll_cb_t      poll,
+    uint32_t               interest,
+    reactor_event_cb_t     callback,
+    void*                  obj );
+
+/*! \brief      Change interest flags of registration. */
+bool reactor_modify(
+    transceiver_reactor_t* s,
+    reactor_handle_t       rh,
+    uint32_t               interest );
+
+/*! \brief      Unregister. Notifications already queued for this registration
+   are discarded on dispatch. */
+bool reactor_remove( transceiver_reactor_t* s, reactor_handle_t rh );
+
+/*! \brief      Wait for readiness and post notifications into the queue.
+    \param      timeoutMs
+                 Maximum wait time. 0 returns immediately, negative value waits
+                infinitely. If there is any ready poll source, does not wait.
+    \note       Poll sources are evaluated only once per call, so use finite
+   timeout when any of them is registered.
+    \returns    Number of notifications posted. */
+size_t reactor_wait( transceiver_reactor_t* s, int timeoutMs );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
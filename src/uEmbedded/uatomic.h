@@ -0,0 +1,81 @@
+/*! \brief Minimal atomic operations over compiler intrinsics.
+    \file uatomic.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-03
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        Thin wrappers over GCC/Clang __atomic builtins and MSVC Interlocked
+   intrinsics, as C11 <stdatomic.h> isn't available on every target toolchain.
+   Loads acquire, stores release, and successful CAS does both.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+#    include <intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint64_t uatomic_load64( uint64_t volatile* p )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+#elif defined( _MSC_VER )
+    return (uint64_t)_InterlockedCompareExchange64(
+        (__int64 volatile*)p, 0, 0 );
+#else
+#    error "uatomic.h: unsupported compiler"
+#endif
+}
+
+static inline void uatomic_store64( uint64_t volatile* p, uint64_t v )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    __atomic_store_n( p, v, __ATOMIC_RELEASE );
+#elif defined( _MSC_VER )
+    _InterlockedExchange64( (__int64 volatile*)p, (__int64)v );
+#endif
+}
+
+//! \brief      Add and return the new value.
+static inline uint64_t uatomic_add64( uint64_t volatile* p, uint64_t v )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __atomic_add_fetch( p, v, __ATOMIC_ACQ_REL );
+#elif defined( _MSC_VER )
+    return (uint64_t)_InterlockedExchangeAdd64(
+               (__int64 volatile*)p, (__int64)v )
+           + v;
+#endif
+}
+
+/*! \brief      Compare and swap.
+    \param      expected
+                 On failure, receives current value.
+    \returns    true if value was replaced. */
+static inline bool
+uatomic_cas64( uint64_t volatile* p, uint64_t* expected, uint64_t desired )
+{
+#if defined( __GNUC__ ) || defined( __clang__ )
+    return __atomic_compare_exchange_n(
+        p, expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+#elif defined( _MSC_VER )
+    uint64_t prev = (uint64_t)_InterlockedCompareExchange64(
+        (__int64 volatile*)p, (__int64)desired, (__int64)*expected );
+    if ( prev == *expected )
+        return true;
+    *expected = prev;
+    return false;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,652 @@
+#ifndef _GNU_SOURCE
+#    define _GNU_SOURCE // syscall()
+#endif
+#include "uring_transceiver.h"
+#include <string.h>
+#include "uassert.h"
+
+#if URING_TRANSCEIVER_AVAILABLE
+#    include <errno.h>
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <sys/syscall.h>
+#    include <sys/uio.h>
+#    include <unistd.h>
+
+typedef uring_context_t     ctx_t;
+typedef uring_transceiver_t desc_t;
+
+enum
+{
+    OP_IDLE = 0,
+    OP_READ,
+    OP_WRITE,
+
+    //! user_data of cancel requests. Completion is simply ignored.
+    UD_CANCEL = 0xffffffffu
+};
+
+//! Parameter bundle copied into event queue.
+struct uring_event
+{
+    desc_t*              t;
+    uint32_t             event;
+    transceiver_result_t result;
+};
+
+#    define user_data_of( idx, op )                                            \
+        ( (uint64_t)( idx ) | ( (uint64_t)( op ) << 16 ) )
+
+static inline int sys_enter( int fd, unsigned submit, unsigned wait )
+{
+    return (int)syscall(
+        __NR_io_uring_enter,
+        fd,
+        submit,
+        wait,
+        wait ? IORING_ENTER_GETEVENTS : 0,
+        NULL,
+        0 );
+}
+
+static inline char* buf_of( ctx_t* s, uint16_t idx )
+{
+    return s->pool + (size_t)idx * s->bufSize;
+}
+
+static uint16_t buf_alloc( ctx_t* s, desc_t* owner, uint8_t op )
+{
+    uint16_t                  idx = s->freeHead;
+    struct uring_buffer_meta* m;
+
+    if ( idx == URING_BUFFER_NONE )
+        return idx;
+
+    m           = s->meta + idx;
+    s->freeHead = m->nextFree;
+    --s->numFree;
+
+    m->owner = owner;
+    m->op    = op;
+    m->off   = 0;
+    m->len   = 0;
+    return idx;
+}
+
+static void buf_free( ctx_t* s, uint16_t idx )
+{
+    struct uring_buffer_meta* m = s->meta + idx;
+
+    m->owner    = NULL;
+    m->op       = OP_IDLE;
+    m->nextFree = s->freeHead;
+    s->freeHead = idx;
+    ++s->numFree;
+}
+
+static struct io_uring_sqe* get_sqe( ctx_t* s )
+{
+    unsigned tail = *s->sqTail;
+    unsigned head = __atomic_load_n( s->sqHead, __ATOMIC_ACQUIRE );
+
+    // Submission queue is full. Push everything to the kernel.
+    if ( tail - head >= s->sqEntries ) {
+        if ( uring_context_submit( s ) <= 0 )
+            return NULL;
+    }
+
+    struct io_uring_sqe* sqe
+        = (struct io_uring_sqe*)s->sqes + ( tail & *s->sqMask );
+    memset( sqe, 0, sizeof( *sqe ) );
+    return sqe;
+}
+
+static void commit_sqe( ctx_t* s )
+{
+    unsigned tail = *s->sqTail;
+
+    s->sqArray[tail & *s->sqMask] = tail & *s->sqMask;
+    __atomic_store_n( s->sqTail, tail + 1, __ATOMIC_RELEASE );
+    ++s->numPending;
+}
+
+static bool queue_rw( ctx_t* s, uint16_t idx, uint8_t op )
+{
+    struct uring_buffer_meta* m   = s->meta + idx;
+    struct io_uring_sqe*      sqe = get_sqe( s );
+
+    if ( sqe == NULL )
+        return false;
+
+    sqe->fd        = m->owner->fd;
+    sqe->off       = s->offset;
+    sqe->user_data = user_data_of( idx, op );
+
+    if ( op == OP_READ ) {
+        sqe->opcode = s->bFixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->addr   = (uintptr_t)buf_of( s, idx );
+        sqe->len    = (uint32_t)s->bufSize;
+    }
+    else {
+        sqe->opcode = s->bFixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->addr   = (uintptr_t)( buf_of( s, idx ) + m->off );
+        sqe->len    = m->len - m->off;
+    }
+    sqe->buf_index = 0;
+
+    commit_sqe( s );
+    ++m->owner->numInflight;
+    return true;
+}
+
+static bool queue_cancel( ctx_t* s, uint16_t idx, uint8_t op )
+{
+    struct io_uring_sqe* sqe = get_sqe( s );
+    if ( sqe == NULL )
+        return false;
+
+    sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    sqe->fd        = -1;
+    sqe->addr      = user_data_of( idx, op );
+    sqe->user_data = UD_CANCEL;
+    commit_sqe( s );
+    return true;
+}
+
+static void start_read( desc_t* t )
+{
+    ctx_t* s = t->ctx;
+
+    if ( t->rxInflight || t->rxError )
+        return;
+
+    if ( t->rxBuf == URING_BUFFER_NONE ) {
+        t->rxBuf = buf_alloc( s, t, OP_READ );
+        if ( t->rxBuf == URING_BUFFER_NONE )
+            return;
+    }
+
+    t->rxInflight = queue_rw( s, t->rxBuf, OP_READ );
+}
+
+static void dispatch( void* param )
+{
+    struct uring_event* ev = (struct uring_event*)param;
+    desc_t*             t  = ev->t;
+
+    if ( t->callback && t->fd >= 0 )
+        t->callback( t->obj, (transceiver_handle_t)t, ev->event, ev->result );
+}
+
+static void post( desc_t* t, uint32_t event, transceiver_result_t result )
+{
+    struct uring_event ev;
+
+    if ( t->ctx->queue == NULL || t->callback == NULL || t->fd < 0 )
+        return;
+
+    ev.t      = t;
+    ev.event  = event;
+    ev.result = result;
+    QueueEvent( t->ctx->queue, dispatch, &ev, sizeof( ev ) );
+}
+
+static void complete( ctx_t* s, uint64_t ud, int32_t res )
+{
+    uint16_t                  idx;
+    struct uring_buffer_meta* m;
+    desc_t*                   t;
+
+    if ( ud == UD_CANCEL )
+        return;
+
+    idx = (uint16_t)( ud & 0xffff );
+    m   = s->meta + idx;
+    t   = m->owner;
+    uassert( idx < s->numBufs && t );
+    --t->numInflight;
+
+    if ( m->op == OP_READ ) {
+        t->rxInflight = false;
+
+        if ( res > 0 ) {
+            m->off = 0;
+            m->len = (uint32_t)res;
+            post( t, URING_EVENT_READ, res );
+        }
+        else {
+            t->rxError = res == 0 ? TRANSCEIVER_CLOSED : TRANSCEIVER_FAILED;
+            post( t, URING_EVENT_ERROR, t->rxError );
+        }
+        return;
+    }
+
+    // Write completion
+    if ( res < 0 ) {
+        t->txError = TRANSCEIVER_FAILED;
+        buf_free( s, idx );
+        post( t, URING_EVENT_ERROR, t->txError );
+        return;
+    }
+
+    // Short write. Resubmit the rest.
+    m->off += (uint32_t)res;
+    if ( m->off < m->len && t->fd >= 0 && queue_rw( s, idx, OP_WRITE ) )
+        return;
+
+    post( t, URING_EVENT_WRITE, (transceiver_result_t)m->len );
+    buf_free( s, idx );
+}
+
+transceiver_result_t uring_context_submit( uring_context_t* s )
+{
+    int r;
+
+    if ( s->numPending == 0 )
+        return 0;
+
+    r = sys_enter( s->ringfd, s->numPending, 0 );
+    if ( r < 0 )
+        return TRANSCEIVER_FAILED;
+
+    s->numPending -= (unsigned)r;
+    return r;
+}
+
+size_t uring_context_poll( uring_context_t* s, unsigned minComplete )
+{
+    unsigned             head, tail;
+    struct io_uring_cqe* cqe;
+    size_t               numHandled = 0;
+
+    if ( s->numPending || minComplete ) {
+        int r = sys_enter( s->ringfd, s->numPending, minComplete );
+        if ( r > 0 )
+            s->numPending -= (unsigned)r;
+    }
+
+    head = *s->cqHead;
+    for ( ;; ) {
+        tail = __atomic_load_n( s->cqTail, __ATOMIC_ACQUIRE );
+        if ( head == tail )
+            break;
+
+        cqe = (struct io_uring_cqe*)s->cqes + ( head & *s->cqMask );
+        complete( s, cqe->user_data, cqe->res );
+        ++head;
+        ++numHandled;
+
+        __atomic_store_n( s->cqHead, head, __ATOMIC_RELEASE );
+    }
+
+    return numHandled;
+}
+
+static transceiver_result_t
+read_impl( void* obj, char* rdbuf, size_t rdcnt )
+{
+    desc_t*                   t = (desc_t*)obj;
+    struct uring_buffer_meta* m;
+    size_t                    n;
+
+    if ( t->rxBuf == URING_BUFFER_NONE || t->rxInflight ) {
+        start_read( t );
+        return t->rxError;
+    }
+
+    m = t->ctx->meta + t->rxBuf;
+    n = m->len - m->off;
+    if ( n > rdcnt )
+        n = rdcnt;
+
+    memcpy( rdbuf, buf_of( t->ctx, t->rxBuf ) + m->off, n );
+    m->off += (uint32_t)n;
+
+    // Buffer drained. Receive next.
+    if ( m->off == m->len )
+        start_read( t );
+
+    return ( transceiver_result_t )( n );
+}
+
+static transceiver_result_t
+write_impl( void* obj, char const* wrbuf, size_t wrcnt )
+{
+    desc_t*  t = (desc_t*)obj;
+    ctx_t*   s = t->ctx;
+    uint16_t idx;
+    size_t   total = 0, n;
+
+    if ( t->txError )
+        return t->txError;
+
+    // Split into pool buffers as long as there is available one.
+    while ( total < wrcnt ) {
+        idx = buf_alloc( s, t, OP_WRITE );
+        if ( idx == URING_BUFFER_NONE )
+            break;
+
+        n = wrcnt - total < s->bufSize ? wrcnt - total : s->bufSize;
+        memcpy( buf_of( s, idx ), wrbuf + total, n );
+        s->meta[idx].len = (uint32_t)n;
+
+        if ( !queue_rw( s, idx, OP_WRITE ) ) {
+            buf_free( s, idx );
+            break;
+        }
+        total += n;
+    }
+
+    return ( transceiver_result_t )( total );
+}
+
+static transceiver_result_t loan_impl( void* obj, char** buf )
+{
+    desc_t*                   t = (desc_t*)obj;
+    struct uring_buffer_meta* m;
+
+    if ( t->rxBuf == URING_BUFFER_NONE || t->rxInflight ) {
+        start_read( t );
+        return t->rxError;
+    }
+
+    m    = t->ctx->meta + t->rxBuf;
+    *buf = buf_of( t->ctx, t->rxBuf ) + m->off;
+    return ( transceiver_result_t )( m->len - m->off );
+}
+
+static transceiver_result_t release_impl( void* obj, size_t consumed )
+{
+    desc_t*                   t = (desc_t*)obj;
+    struct uring_buffer_meta* m;
+
+    if ( t->rxBuf == URING_BUFFER_NONE || t->rxInflight )
+        return consumed ? TRANSCEIVER_INVALID_DATA : TRANSCEIVER_OK;
+
+    m = t->ctx->meta + t->rxBuf;
+    uassert( consumed <= m->len - m->off );
+    m->off += (uint32_t)consumed;
+
+    if ( m->off == m->len )
+        start_read( t );
+    return TRANSCEIVER_OK;
+}
+
+static transceiver_result_t ioctl_impl( void* obj, intptr_t cmd )
+{
+    desc_t* t = (desc_t*)obj;
+
+    if ( cmd == TRANSCEIVER_IOCTL_FLUSH ) {
+        transceiver_result_t r = uring_context_submit( t->ctx );
+        return r < 0 ? r : TRANSCEIVER_OK;
+    }
+
+    return TRANSCEIVER_NOT_SUPPORTED;
+}
+
+static transceiver_result_t close_impl( void* obj )
+{
+    desc_t*  t = (desc_t*)obj;
+    ctx_t*   s = t->ctx;
+    uint16_t i;
+    int      fd = t->fd;
+
+    if ( fd < 0 )
+        return TRANSCEIVER_CLOSED;
+
+    // Suppress further events and resubmissions.
+    t->fd      = -1;
+    t->rxError = TRANSCEIVER_CLOSED;
+    t->txError = TRANSCEIVER_CLOSED;
+
+    for ( i = 0; i < s->numBufs; ++i )
+        if ( s->meta[i].owner == t && s->meta[i].op != OP_IDLE
+             && ( i != t->rxBuf || t->rxInflight )
+             && !queue_cancel( s, i, s->meta[i].op ) )
+            goto failed;
+
+    // Waiting for a single completion handles nothing only on error.
+    while ( t->numInflight )
+        if ( uring_context_poll( s, 1 ) == 0 )
+            goto failed;
+
+    if ( t->rxBuf != URING_BUFFER_NONE ) {
+        buf_free( s, t->rxBuf );
+        t->rxBuf = URING_BUFFER_NONE;
+    }
+
+    close( fd );
+    return TRANSCEIVER_OK;
+
+failed:
+    // Keep it open, so buffers in flight stay owned and close can be retried.
+    t->fd = fd;
+    return TRANSCEIVER_FAILED;
+}
+
+static transceiver_vtable_t const g_vtable = { read_impl,
+                                               write_impl,
+                                               ioctl_impl,
+                                               close_impl,
+                                               NULL,
+                                               NULL,
+                                               loan_impl,
+                                               release_impl };
+
+transceiver_handle_t uring_transceiver_open(
+    uring_transceiver_t* t,
+    uring_context_t*     ctx,
+    int                  fd,
+    uring_event_cb_t     callback,
+    void*                obj )
+{
+    struct stat st;
+
+    uassert( t && ctx && fd >= 0 );
+
+    // Without RW_CUR_POS every operation goes to offset 0. Refuse seekable
+    // files rather than overwriting their head.
+    if ( ctx->offset == 0
+         && ( fstat( fd, &st ) != 0 || S_ISREG( st.st_mode )
+              || S_ISBLK( st.st_mode ) ) )
+        return 0;
+
+    t->vt_         = &g_vtable;
+    t->ctx         = ctx;
+    t->fd          = fd;
+    t->callback    = callback;
+    t->obj         = obj;
+    t->rxBuf       = URING_BUFFER_NONE;
+    t->rxInflight  = false;
+    t->numInflight = 0;
+    t->rxError     = TRANSCEIVER_OK;
+    t->txError     = TRANSCEIVER_OK;
+
+    start_read( t );
+    return (transceiver_handle_t)t;
+}
+
+transceiver_result_t uring_context_init(
+    uring_context_t*   s,
+    struct EventQueue* queue,
+    unsigned           entries,
+    void*              pool,
+    size_t             poolSize,
+    size_t             bufSize )
+{
+    struct io_uring_params p;
+    size_t                 numBufs, i;
+    uintptr_t              meta;
+    struct iovec           iov;
+
+    uassert( s && pool && bufSize && entries );
+    memset( s, 0, sizeof( *s ) );
+    memset( &p, 0, sizeof( p ) );
+    s->ringfd = -1;
+
+    // Pool buffers first, followed by their bookkeeping at aligned address.
+    numBufs = poolSize / ( bufSize + sizeof( struct uring_buffer_meta ) );
+    if ( numBufs > URING_BUFFER_NONE )
+        numBufs = URING_BUFFER_NONE;
+    for ( ; numBufs; --numBufs ) {
+        meta = ( (uintptr_t)pool + numBufs * bufSize + URING_META_ALIGN - 1 )
+               & ~(uintptr_t)( URING_META_ALIGN - 1 );
+        if ( meta + numBufs * sizeof( struct uring_buffer_meta )
+             <= (uintptr_t)pool + poolSize )
+            break;
+    }
+    if ( numBufs == 0 )
+        return TRANSCEIVER_FAILED;
+
+    s->ringfd = (int)syscall( __NR_io_uring_setup, entries, &p );
+    if ( s->ringfd < 0 )
+        return TRANSCEIVER_FAILED;
+
+    s->sqRingSize = p.sq_off.array + p.sq_entries * sizeof( unsigned );
+    s->cqRingSize
+        = p.cq_off.cqes + p.cq_entries * sizeof( struct io_uring_cqe );
+    if ( p.features & IORING_FEAT_SINGLE_MMAP ) {
+        if ( s->cqRingSize > s->sqRingSize )
+            s->sqRingSize = s->cqRingSize;
+        s->cqRingSize = s->sqRingSize;
+    }
+
+    s->sqRing = mmap(
+        NULL,
+        s->sqRingSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        s->ringfd,
+        IORING_OFF_SQ_RING );
+    if ( s->sqRing == MAP_FAILED )
+        goto failed;
+
+    if ( p.features & IORING_FEAT_SINGLE_MMAP )
+        s->cqRing = s->sqRing;
+    else {
+        s->cqRing = mmap(
+            NULL,
+            s->cqRingSize,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            s->ringfd,
+            IORING_OFF_CQ_RING );
+        if ( s->cqRing == MAP_FAILED )
+            goto failed;
+    }
+
+    s->sqesSize = p.sq_entries * sizeof( struct io_uring_sqe );
+    s->sqes     = mmap(
+        NULL,
+        s->sqesSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        s->ringfd,
+        IORING_OFF_SQES );
+    if ( s->sqes == MAP_FAILED )
+        goto failed;
+
+#    define ring_ptr( base, off ) ( (unsigned*)( (char*)( base ) + ( off ) ) )
+    s->sqHead    = ring_ptr( s->sqRing, p.sq_off.head );
+    s->sqTail    = ring_ptr( s->sqRing, p.sq_off.tail );
+    s->sqMask    = ring_ptr( s->sqRing, p.sq_off.ring_mask );
+    s->sqArray   = ring_ptr( s->sqRing, p.sq_off.array );
+    s->sqEntries = p.sq_entries;
+    s->cqHead    = ring_ptr( s->cqRing, p.cq_off.head );
+    s->cqTail    = ring_ptr( s->cqRing, p.cq_off.tail );
+    s->cqMask    = ring_ptr( s->cqRing, p.cq_off.ring_mask );
+    s->cqes      = (char*)s->cqRing + p.cq_off.cqes;
+#    undef ring_ptr
+
+    s->queue   = queue;
+    s->pool    = (char*)pool;
+    s->bufSize = bufSize;
+    s->numBufs = (uint16_t)numBufs;
+    s->meta    = (struct uring_buffer_meta*)meta;
+    s->offset  = p.features & IORING_FEAT_RW_CUR_POS ? (uint64_t)-1 : 0;
+
+    s->freeHead = URING_BUFFER_NONE;
+    for ( i = numBufs; i--; ) {
+        s->meta[i].nextFree = s->freeHead;
+        s->meta[i].owner    = NULL;
+        s->meta[i].op       = OP_IDLE;
+        s->freeHead         = (uint16_t)i;
+    }
+    s->numFree = s->numBufs;
+
+    // Whole data region is registered as a single fixed buffer. If it's not
+    // permitted (e.g. by memlock limit), falls back to normal read/write.
+    iov.iov_base = s->pool;
+    iov.iov_len  = numBufs * bufSize;
+    s->bFixed    = syscall(
+                    __NR_io_uring_register,
+                    s->ringfd,
+                    IORING_REGISTER_BUFFERS,
+                    &iov,
+                    1 )
+                == 0;
+
+    return TRANSCEIVER_OK;
+
+failed:
+    uring_context_destroy( s );
+    return TRANSCEIVER_FAILED;
+}
+
+void uring_context_destroy( uring_context_t* s )
+{
+    if ( s->sqes && s->sqes != MAP_FAILED )
+        munmap( s->sqes, s->sqesSize );
+    if ( s->cqRing && s->cqRing != MAP_FAILED && s->cqRing != s->sqRing )
+        munmap( s->cqRing, s->cqRingSize );
+    if ( s->sqRing && s->sqRing != MAP_FAILED )
+        munmap( s->sqRing, s->sqRingSize );
+    if ( s->ringfd >= 0 )
+        close( s->ringfd );
+
+    s->sqes = s->cqRing = s->sqRing = NULL;
+    s->ringfd                       = -1;
+}
+
+#else
+
+transceiver_result_t uring_context_init(
+    uring_context_t*   s,
+    struct EventQueue* queue,
+    unsigned           entries,
+    void*              pool,
+    size_t             poolSize,
+    size_t             bufSize )
+{
+    (void)s, (void)queue, (void)entries, (void)pool, (void)poolSize;
+    (void)bufSize;
+    return TRANSCEIVER_NOT_SUPPORTED;
+}
+
+void uring_context_destroy( uring_context_t* s ) { (void)s; }
+
+transceiver_result_t uring_context_submit( uring_context_t* s )
+{
+    (void)s;
+    return TRANSCEIVER_NOT_SUPPORTED;
+}
+
+size_t uring_context_poll( uring_context_t* s, unsigned minComplete )
+{
+    (void)s, (void)minComplete;
+    return 0;
+}
+
+transceiver_handle_t uring_transceiver_open(
+    uring_transceiver_t* t,
+    uring_context_t*     ctx,
+    int                  fd,
+    uring_event_cb_t     callback,
+    void*                obj )
+{
+    (void)t, (void)ctx, (void)fd, (void)callback, (void)obj;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*! \brief Completion based transceiver backend on io_uring.
+    \file uring_transceiver.h
+    \author Seungwoo Kang (ki6080@gmail.com)
+    \version 0.1
+    \date 2019-12-02
+
+    \copyright Copyright (c) 2019. Seungwoo Kang. All rights reserved.
+
+    \details
+        A single uring_context owns an io_uring instance and a buffer pool,
+   which is registered to the kernel as a fixed buffer. Any number of file
+   descriptors can be opened as uring_transceiver on the context, and each of
+   them exposes the usual transceiver_vtable.
+        Writes copy data into a pool buffer and queue a submission entry.
+   Queued entries are not submitted until uring_context_submit() or
+   uring_context_poll() is called, thus many operations share one system call.
+   Each transceiver keeps one read in flight to its own pool buffer. Completed
+   data is returned by td_read(), or lent without copy by td_loan().
+        Completions are delivered as events into EventQueue, when the event
+   callback is given on uring_transceiver_open().
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "event-procedure.h"
+#include "transceiver.h"
+
+#if defined( __linux__ )
+#    define URING_TRANSCEIVER_AVAILABLE 1
+#else
+#    define URING_TRANSCEIVER_AVAILABLE 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @addtogroup uEmbedded_C
+//! @{
+//! @defgroup uEmbedded_C_Uring_Transceiver
+//! @{
+
+//! \brief      Completion event types.
+enum
+{
+    //! \brief      Received data is ready to be read.
+    URING_EVENT_READ = 0x01,
+
+    //! \brief      A queued write has completed. result holds bytes written.
+    URING_EVENT_WRITE = 0x02,
+
+    //! \brief      Operation failed or peer has closed the connection. result
+    //!             holds the error code.
+    URING_EVENT_ERROR = 0x04
+};
+
+//! \brief      Called from ProcessEvent() on completion.
+typedef void ( *uring_event_cb_t )(
+    void* /*obj*/,
+    transceiver_handle_t /*h*/,
+    uint32_t /*event*/,
+    transceiver_result_t /*result*/ );
+
+//! \brief      Per-buffer bookkeeping. Placed at the end of pool memory,
+//!             aligned up to URING_META_ALIGN.
+struct uring_buffer_meta
+{
+    struct uring_transceiver* owner;
+    uint32_t                  off;
+    uint32_t                  len;
+    uint16_t                  nextFree;
+    uint8_t                   op;
+};
+
+//! \brief      io_uring instance and registered buffer pool.
+struct uring_context
+{
+    int                ringfd;
+    struct EventQueue* queue;
+
+    // Submission ring
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    void*     sqes;
+    unsigned  sqEntries;
+    unsigned  numPending;
+
+    // Completion ring
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    void*     cqes;
+
+    // Mappings
+    void*  sqRing;
+    size_t sqRingSize;
+    void*  cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+
+    // Buffer pool
+    char*                     pool;
+    struct uring_buffer_meta* meta;
+    size_t                    bufSize;
+    uint16_t                  numBufs;
+    uint16_t                  freeHead;
+    uint16_t                  numFree;
+    bool                      bFixed;
+    uint64_t                  offset;
+};
+
+//! \brief      Transceiver on uring_context.
+struct uring_transceiver
+{
+    //! \brief      Must be placed at first. See transceiver_handle_t.
+    transceiver_vtable_t const* vt_;
+
+    struct uring_context* ctx;
+    int                   fd;
+    uring_event_cb_t      callback;
+    void*                 obj;
+
+    //! \brief      Buffer for receive. URING_BUFFER_NONE if not assigned.
+    uint16_t rxBuf;
+    bool     rxInflight;
+
+    //! \brief      Number of operations submitted and not completed.
+    uint16_t numInflight;
+
+    //! \brief      Sticky errors of each direction. EOF is reported as
+    //!             TRANSCEIVER_CLOSED.
+    transceiver_result_t rxError;
+    transceiver_result_t txError;
+};
+
+enum
+{
+    URING_BUFFER_NONE = 0xffff,
+
+    //! \brief      Alignment of uring_buffer_meta array in pool memory.
+    URING_META_ALIGN = sizeof( void* )
+};
+
+typedef struct uring_context     uring_context_t;
+typedef struct uring_transceiver uring_transceiver_t;
+
+//! \brief      Calculate pool size required for given number of buffers.
+#define URING_POOL_SIZE( numBufs, bufSize )                                    \
+    ( ( numBufs ) * ( ( bufSize ) + sizeof( struct uring_buffer_meta ) )       \
+      + URING_META_ALIGN - 1 )
+
+/*! \brief      Set up io_uring instance.
+    \param      queue
+                 Event queue which receives completion events. Can be NULL.
+    \param      entries
+                 Number of submission queue entries.
+    \param      pool
+                 Memory for IO buffers. Must be valid until the context is
+                destroyed. Use URING_POOL_SIZE() to calculate required size.
+    \param      bufSize
+                 Size of a single IO buffer. Maximum size of single read or
+                write operation.
+    \returns    TRANSCEIVER_OK on success. */
+transceiver_result_t uring_context_init(
+    uring_context_t*   s,
+    struct EventQueue* queue,
+    unsigned           entries,
+    void*              pool,
+    size_t             poolSize,
+    size_t             bufSize );
+
+/*! \brief      Release io_uring instance. Close all transceivers first. */
+void uring_context_destroy( uring_context_t* s );
+
+/*! \brief      Submit every queued operation in one system call.
+    \returns    Number of operations submitted, or negative error code. */
+transceiver_result_t uring_context_submit( uring_context_t* s );
+
+/*! \brief      Submit queued operations, then handle completions.
+    \param      minComplete
+                 Number of completions to wait for. 0 never blocks.
+    \returns    Number of completions handled. */
+size_t uring_context_poll( uring_context_t* s, unsigned minComplete );
+
+/*! \brief      Open file descriptor as transceiver and start receiving.
+    \details    File descriptor is owned by the transceiver, and closed by
+   td_close(). td_close() cancels operations in flight and waits for their
+   completion. If they can't be reaped, td_close() returns TRANSCEIVER_FAILED
+   and leaves the descriptor open, so it can be retried.
+        Events queued for the transceiver refer to it until they are
+   processed. Thus its memory must stay valid, even after td_close(), until
+   the event queue is flushed.
+        Kernels without IORING_FEAT_RW_CUR_POS always read and write at offset
+   0, so only streams like pipes or sockets are accepted on them.
+    \param      callback
+                 Completion event callback. Can be NULL.
+    \returns    Transceiver handle. 0 if it failed, then fd is not owned. */
+transceiver_handle_t uring_transceiver_open(
+    uring_transceiver_t* t,
+    uring_context_t*     ctx,
+    int                  fd,
+    uring_event_cb_t     callback,
+    void*                obj );
+
+//! @}
+//! @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,132 @@
+#include <Catch2/catch.hpp>
+#include <string>
+#include <vector>
+extern "C" {
+#include <uEmbedded/compress_transceiver.h>
+#include <uEmbedded/loopback_transceiver.h>
+}
+
+namespace {
+std::string sample_text( size_t len )
+{
+    static char const* words[]
+      = { "sensor ", "value ", "timestamp ", "ok ", "error ", "42 ", "\n" };
+    std::string r;
+    for ( unsigned x = 1; r.size() < len; ) {
+        x = x * 1103515245 + 12345;
+        r += words[( x >> 16 ) % 7];
+    }
+    r.resize( len );
+    return r;
+}
+} // namespace
+
+TEST_CASE( "LZ block codec", "[lz_block]" )
+{
+    std::vector<char> work( LZ_WORKMEM_SIZE );
+
+    std::string src = GENERATE(
+      std::string(),
+      std::string( "abc" ),
+      std::string( 1000, 'a' ),
+      sample_text( 4000 ),
+      []() {
+          std::string r( 3000, 0 );
+          for ( auto& c : r )
+              c = (char)rand();
+          return r;
+      }() );
+
+    std::string dst( LZ_COMPRESS_BOUND( src.size() ), 0 );
+    size_t      n
+      = lz_compress( src.data(), src.size(), &dst[0], dst.size(), &work[0] );
+    REQUIRE( n > 0 );
+
+    std::string out( src.size(), 0 );
+    REQUIRE( lz_decompress( dst.data(), n, &out[0], out.size() )
+             == src.size() );
+    REQUIRE( out == src );
+
+    if ( src.size() >= 100 ) {
+        // Output too small, and truncated input.
+        REQUIRE( lz_decompress( dst.data(), n, &out[0], src.size() - 1 )
+                 == LZ_ERROR );
+        REQUIRE( lz_compress( src.data(), src.size(), &dst[0], 8, &work[0] )
+                 == 0 );
+    }
+}
+
+TEST_CASE( "Compressing transceiver", "[compress_transceiver]" )
+{
+    static char     wire0[1 << 16], wire1[1 << 16];
+    loopback_link_t link;
+    loopback_init( &link, NULL, wire0, sizeof wire0, wire1, sizeof wire1 );
+
+    enum { BLOCK = 1024 };
+    static char            memA[COMPRESS_TRANSCEIVER_MEMORY( BLOCK )];
+    static char            memB[COMPRESS_TRANSCEIVER_MEMORY( BLOCK )];
+    compress_transceiver_t a, b;
+
+    auto ha = compress_transceiver_init(
+      &a, loopback_endpoint( &link, 0 ), memA, sizeof memA, BLOCK );
+    auto hb = compress_transceiver_init(
+      &b, loopback_endpoint( &link, 1 ), memB, sizeof memB, BLOCK );
+
+    SECTION( "Stream round trip" )
+    {
+        std::string text = sample_text( 10000 );
+        for ( size_t i = 0; i < text.size(); ) {
+            auto n = std::min<size_t>( 300, text.size() - i );
+            auto r = td_write( ha, &text[i], n );
+            REQUIRE( r > 0 );
+            i += r;
+        }
+        REQUIRE( td_ioctl( ha, TRANSCEIVER_IOCTL_FLUSH ) == 0 );
+
+        std::string got;
+        char        buf[500];
+        transceiver_result_t r;
+        while ( ( r = td_read( hb, buf, sizeof buf ) ) > 0 )
+            got.append( buf, r );
+        REQUIRE( got == text );
+
+        auto ratio = td_ioctl( ha, COMPRESS_IOCTL_TX_RATIO );
+        REQUIRE( ratio > 0 );
+        REQUIRE( ratio < 600 );
+        REQUIRE( td_ioctl( hb, COMPRESS_IOCTL_RX_RATIO ) == ratio );
+        REQUIRE( link.ep[0].stats.bytesWritten < text.size() * 6 / 10 );
+        REQUIRE( td_ioctl( ha, COMPRESS_IOCTL_TX_THROUGHPUT )
+                 == TRANSCEIVER_NOT_SUPPORTED );
+    }
+
+    SECTION( "Incompressible block is sent raw and lent in place" )
+    {
+        std::string noise( 200, 0 );
+        for ( auto& c : noise )
+            c = (char)rand();
+        td_write( ha, &noise[0], noise.size() );
+        td_ioctl( ha, TRANSCEIVER_IOCTL_FLUSH );
+        REQUIRE( a.stats.txWire == noise.size() + COMPRESS_HEADER_SIZE );
+
+        char* p;
+        REQUIRE( td_loan( hb, &p ) == 200 );
+        REQUIRE( std::string( p, 200 ) == noise );
+        td_release( hb, 200 );
+        REQUIRE( td_read( hb, p, 1 ) == 0 );
+    }
+
+    SECTION( "Throughput by clock" )
+    {
+        size_t ticks = 0;
+        compress_transceiver_set_clock(
+          &a, []( void* o ) { return ( *(size_t*)o )++; }, &ticks, 1000 );
+
+        std::string text = sample_text( BLOCK );
+        td_write( ha, &text[0], text.size() );
+
+        // One tick per block; 1 KiB per millisecond.
+        REQUIRE( td_ioctl( ha, COMPRESS_IOCTL_TX_THROUGHPUT ) == 1000 );
+        REQUIRE( td_ioctl( ha, COMPRESS_IOCTL_RESET_STATS ) == 0 );
+        REQUIRE( td_ioctl( ha, COMPRESS_IOCTL_TX_RATIO ) == 0 );
+    }
+}
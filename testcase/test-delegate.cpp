@@ -3,6 +3,10 @@ extern "C"
 {
 #include <uEmbedded/delegate.h>
 }    
+#include <uEmbedded-pp/delegate.hxx>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 
 static delegate_t* evnt = delegate_create(true);
 
@@ -39,4 +43,244 @@ TEST_CASE("delegate test", "[delegate_pool]")
     REQUIRE(v == 15);
 
     delegate_destroy(evnt);
-}
\ No newline at end of file
+}
+
+TEST_CASE( "upp::delegate", "[delegate_pool]" )
+{
+    struct obj
+    {
+        int sum = 0;
+    };
+    using ptr_t = std::weak_ptr<obj>;
+    using dlg_t = upp::delegate<ptr_t, void( int ), 2>;
+
+    static dlg_t* self;
+    dlg_t         d;
+    self = &d;
+
+    auto add = []( std::shared_ptr<obj> const& o, int v ) { o->sum += v; };
+    auto twice
+        = []( std::shared_ptr<obj> const& o, int v ) { o->sum += v * 2; };
+
+    std::vector<std::shared_ptr<obj>> objs;
+    for ( int i = 0; i < 5; ++i ) {
+        objs.push_back( std::make_shared<obj>() );
+        REQUIRE( d.add( objs.back(), add ) );
+    }
+    REQUIRE( d.add( objs[0], twice ) );
+    REQUIRE( d.size() == 6 );
+
+    d( 1 );
+    REQUIRE( objs[0]->sum == 3 );
+    REQUIRE( objs[4]->sum == 1 );
+
+    // Expired objects are dropped on invocation.
+    objs[4].reset();
+    d( 1 );
+    REQUIRE( d.size() == 5 );
+
+    // Remove by object, by function, and by both.
+    REQUIRE( d.remove( ptr_t( objs[1] ) ) == 1 );
+    REQUIRE( d.remove( ptr_t( objs[0] ), twice ) == 1 );
+    REQUIRE( d.size() == 3 );
+    REQUIRE( d.remove( add ) == 3 );
+    REQUIRE( d.empty() );
+
+    SECTION( "Removal during invocation is deferred" )
+    {
+        static int numCall;
+        numCall          = 0;
+        auto self_remove = []( std::shared_ptr<obj> const& o, int ) {
+            ++numCall;
+            self->remove( ptr_t( o ) );
+        };
+
+        for ( int i = 0; i < 4; ++i )
+            d.add( objs[i], self_remove );
+        d( 0 );
+        REQUIRE( numCall == 4 );
+        REQUIRE( d.empty() );
+        d( 0 );
+        REQUIRE( numCall == 4 );
+    }
+
+    SECTION( "Throwing callback applies deferred removals" )
+    {
+        auto remove_and_throw = []( std::shared_ptr<obj> const& o, int ) {
+            self->remove( ptr_t( o ) );
+            throw std::runtime_error( "callback" );
+        };
+
+        d.add( objs[0], remove_and_throw );
+        d.add( objs[1], add );
+        REQUIRE_THROWS( d( 1 ) );
+        REQUIRE( d.size() == 1 );
+
+        // Removal isn't deferred any more.
+        REQUIRE( d.remove( add ) == 1 );
+        REQUIRE( d.empty() );
+    }
+}
+
+TEST_CASE( "delegate grows during call", "[delegate_pool]" )
+{
+    static delegate_t* d;
+    static refhandle_t extra;
+    static int         numValid;
+
+    auto p = refpool_create( 16 );
+    d      = delegate_create( true );
+    extra  = refpool_malloc( p, 4 );
+
+    // Subscribing from a callback reallocates the binding array.
+    auto subscribe = []( refhandle_t const* obj, void* ) {
+        for ( int i = 0; i < 8; ++i )
+            delegate_assign( d, &extra, []( refhandle_t const*, void* ) {} );
+        numValid += ref_is_valid( obj );
+    };
+
+    refhandle_t h[5];
+    for ( auto& e : h ) {
+        e = refpool_malloc( p, 4 );
+        REQUIRE( delegate_assign( d, &e, subscribe ) );
+    }
+
+    numValid = 0;
+    delegate_call( d, NULL );
+    REQUIRE( numValid == 5 );
+    REQUIRE( delegate_size( d ) == 5 + 5 * 8 );
+
+    delegate_destroy( d );
+    refpool_destroy( p );
+}
+
+TEST_CASE( "delegate over caller buffer", "[delegate_pool]" )
+{
+    size_t const NUM_BINDING = 6;
+    alignas( void* ) char buff[512];
+    REQUIRE( delegate_buffer_size( NUM_BINDING ) <= sizeof( buff ) );
+
+    delegate_desc desc = {};
+    desc.bMulticast    = true;
+    desc.buff          = buff;
+    desc.buffSize      = delegate_buffer_size( NUM_BINDING );
+    auto d             = delegate_create_ex( &desc );
+    REQUIRE( (void*)d == buff );
+
+    static int  sum;
+    auto        p   = refpool_create( 16 );
+    auto        add = []( refhandle_t const*, void* v ) { sum += *(int*)v; };
+    refhandle_t h[NUM_BINDING + 1];
+    for ( auto& e : h )
+        e = refpool_malloc( p, 4 );
+
+    // Capacity is fixed.
+    for ( size_t i = 0; i < NUM_BINDING; ++i )
+        REQUIRE( delegate_assign( d, h + i, add ) );
+    REQUIRE( !delegate_assign( d, h + NUM_BINDING, add ) );
+
+    sum   = 0;
+    int v = 1;
+    delegate_call( d, &v );
+    REQUIRE( sum == NUM_BINDING );
+
+    // Expired references are pruned, which makes room.
+    ref_free( h + 0 );
+    ref_free( h + 1 );
+    delegate_call( d, &v );
+    REQUIRE( delegate_size( d ) == NUM_BINDING - 2 );
+    REQUIRE( delegate_delete( d, h + 2, add ) == 1 );
+    REQUIRE( delegate_assign( d, h + NUM_BINDING, add ) );
+    REQUIRE( delegate_size( d ) == NUM_BINDING - 2 );
+
+    delegate_destroy( d );
+    refpool_destroy( p );
+}
+
+TEST_CASE( "delegate post", "[delegate_pool]" )
+{
+    static char buf1[1024], buf2[1024];
+    static int  sum1, sum2;
+    EventQueue  q1, q2;
+    InitEventProcedure( &q1, buf1, sizeof( buf1 ) );
+    InitEventProcedure( &q2, buf2, sizeof( buf2 ) );
+
+    // Second queue stands for one processed by a worker. lk counts locks
+    // taken, and held.
+    int  lk[2]  = {};
+    auto lock   = []( void* o ) { ++( (int*)o )[0], ++( (int*)o )[1]; };
+    auto unlock = []( void* o ) { --( (int*)o )[1]; };
+
+    delegate_target t1 = { &q1, NULL, NULL, NULL };
+    delegate_target t2 = { &q2, lock, unlock, lk };
+
+    auto p = refpool_create( 8 );
+    auto d = delegate_create( true );
+
+    refhandle_t h[3];
+    for ( auto& e : h )
+        e = refpool_malloc( p, 4 );
+
+    auto on1 = []( refhandle_t const*, void* v ) { sum1 += *(int*)v; };
+    auto on2 = []( refhandle_t const*, void* v ) { sum2 += *(int*)v; };
+    delegate_assign( d, h + 0, on1 );
+    delegate_assign_queue( d, h + 1, on2, &t2 );
+    delegate_assign( d, h + 2, on1 );
+
+    sum1 = sum2 = 0;
+    int v       = 3;
+    REQUIRE( delegate_post( d, &t1, &v, sizeof( v ) ) == 2 );
+    REQUIRE( q1.queue.cnt == 1 );
+    REQUIRE( q2.queue.cnt == 1 );
+    REQUIRE( lk[0] == 1 );
+    REQUIRE( lk[1] == 0 );
+
+    // Args are copied, and nothing runs until processed.
+    v = 100;
+    REQUIRE( sum1 == 0 );
+
+    // Subscribers are captured on post; expired ones are skipped.
+    ref_free( h + 2 );
+    delegate_destroy( d );
+
+    ProcessEvent( &q1, NULL, NULL, NULL );
+    REQUIRE( sum1 == 3 );
+    REQUIRE( sum2 == 0 );
+
+    ProcessEvent( &q2, t2.lock, t2.unlock, t2.lockobj );
+    REQUIRE( sum2 == 3 );
+
+    refpool_destroy( p );
+}
+
+TEST_CASE( "delegate post into full queue", "[delegate_pool]" )
+{
+    static char buf[256];
+    EventQueue  q;
+    InitEventProcedure( &q, buf, sizeof( buf ) );
+
+    delegate_target t = { &q, NULL, NULL, NULL };
+    auto            p = refpool_create( 4 );
+    auto            d = delegate_create( true );
+    auto            h = refpool_malloc( p, 4 );
+    delegate_assign( d, &h, []( refhandle_t const*, void* ) {} );
+
+    // Args larger than the whole queue are never queued.
+    char big[sizeof( buf )] = {};
+    REQUIRE( delegate_post( d, &t, big, sizeof( big ) ) == 0 );
+    REQUIRE( q.queue.cnt == 0 );
+
+    // Stops once the queue fills up.
+    size_t n = 0;
+    while ( delegate_post( d, &t, big, 16 ) == 1 )
+        ++n;
+    REQUIRE( n > 0 );
+    REQUIRE( q.queue.cnt == n );
+
+    FlushEvents( &q );
+    REQUIRE( q.queue.cnt == 0 );
+    REQUIRE( delegate_post( d, &t, big, 16 ) == 1 );
+
+    delegate_destroy( d );
+    refpool_destroy( p );
+}
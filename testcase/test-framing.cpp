@@ -0,0 +1,171 @@
+#include <Catch2/catch.hpp>
+#include <string>
+#include <vector>
+extern "C" {
+#include <uEmbedded/buffered_transceiver.h>
+#include <uEmbedded/framing.h>
+}
+
+namespace {
+struct frame_sink
+{
+    std::vector<std::string> frames;
+    std::vector<char*>       ptrs;
+
+    static void on_frame( void* o, char* p, size_t n )
+    {
+        auto s = (frame_sink*)o;
+        s->frames.emplace_back( p, n );
+        s->ptrs.push_back( p );
+    }
+};
+
+std::string encode( framing_type type, std::string const& s )
+{
+    std::string r( framing_encoded_size_max( type, s.size() ), '\0' );
+    r.resize( framing_encode( type, &r[0], r.size(), s.data(), s.size() ) );
+    return r;
+}
+} // namespace
+
+TEST_CASE( "Framing round trip", "[framing]" )
+{
+    framing_type type = GENERATE(
+      FRAMING_LENGTH_PREFIX, FRAMING_SLIP, FRAMING_COBS );
+
+    std::vector<std::string> msgs
+      = { "hello",
+          std::string( "\0\xC0\xDB\0", 4 ),
+          std::string( 300, 'x' ),
+          std::string( 600, '\0' ),
+          "" };
+    msgs[2][253] = '\0';
+
+    std::string stream;
+    for ( auto& m : msgs )
+        stream += encode( type, m );
+
+    char              carry[1024];
+    framing_decoder_t d;
+    framing_decoder_init( &d, type, carry, sizeof carry );
+    frame_sink sink;
+
+    SECTION( "Single chunk decodes in place" )
+    {
+        framing_decode( &d, &stream[0], stream.size(), sink.on_frame, &sink );
+        REQUIRE( sink.ptrs[0] >= &stream[0] );
+        REQUIRE( sink.ptrs[0] < &stream[0] + stream.size() );
+    }
+
+    SECTION( "Partial frames survive across chunks" )
+    {
+        size_t step = GENERATE( 1, 3, 7, 256 );
+        for ( size_t i = 0; i < stream.size(); i += step )
+            framing_decode(
+              &d,
+              &stream[i],
+              std::min( step, stream.size() - i ),
+              sink.on_frame,
+              &sink );
+    }
+
+    SECTION( "Ring buffer input" )
+    {
+        char          rbuf[128];
+        ring_buffer_t rb;
+        ring_buffer_init( &rb, rbuf, sizeof rbuf );
+
+        for ( size_t i = 0; i < stream.size(); ) {
+            size_t n = std::min( ring_buffer_space( &rb ), stream.size() - i );
+            ring_buffer_write( &rb, &stream[i], n );
+            framing_decode_ring( &d, &rb, sink.on_frame, &sink );
+            i += n;
+        }
+    }
+
+    if ( type == FRAMING_SLIP )
+        msgs.pop_back(); // Empty SLIP frames are not delivered.
+
+    REQUIRE( sink.frames == msgs );
+    REQUIRE( d.numErrors == 0 );
+}
+
+TEST_CASE( "Framing errors and encoding", "[framing]" )
+{
+    char              carry[8];
+    framing_decoder_t d;
+    frame_sink        sink;
+
+    SECTION( "Oversized frame across chunks is dropped" )
+    {
+        framing_decoder_init( &d, FRAMING_COBS, carry, sizeof carry );
+        std::string s = encode( FRAMING_COBS, std::string( 20, 'a' ) )
+                        + encode( FRAMING_COBS, "ok" );
+        framing_decode( &d, &s[0], 10, sink.on_frame, &sink );
+        framing_decode( &d, &s[10], s.size() - 10, sink.on_frame, &sink );
+        REQUIRE( d.numErrors == 1 );
+        REQUIRE( sink.frames == std::vector<std::string>{ "ok" } );
+    }
+
+    SECTION( "Malformed SLIP escape" )
+    {
+        framing_decoder_init( &d, FRAMING_SLIP, carry, sizeof carry );
+        char s[] = "\xC0" "ab\xDB" "x\xC0" "cd\xC0";
+        framing_decode( &d, s, sizeof s - 1, sink.on_frame, &sink );
+        REQUIRE( d.numErrors == 1 );
+        REQUIRE( sink.frames == std::vector<std::string>{ "cd" } );
+    }
+
+    SECTION( "Encode into wrapped ring buffer" )
+    {
+        char          rbuf[16];
+        ring_buffer_t rb;
+        ring_buffer_init( &rb, rbuf, sizeof rbuf );
+        ring_buffer_write( &rb, "0123456789", 10 );
+        ring_buffer_consume( &rb, 10 );
+
+        REQUIRE( framing_encode_ring( FRAMING_LENGTH_PREFIX, &rb, "abcdef", 6 )
+                 == 8 );
+        REQUIRE( framing_encode_ring( FRAMING_LENGTH_PREFIX, &rb, "abcdef", 6 )
+                 == 0 );
+
+        framing_decoder_init( &d, FRAMING_LENGTH_PREFIX, carry, sizeof carry );
+        framing_decode_ring( &d, &rb, sink.on_frame, &sink );
+        REQUIRE( sink.frames == std::vector<std::string>{ "abcdef" } );
+    }
+
+    SECTION( "Decode from loaned buffer" )
+    {
+        struct src_t
+        {
+            tranceiver_desc desc;
+            std::string     in;
+        } src;
+        static transceiver_vtable_t const vt
+          = { []( void* o, char* b, size_t n ) -> transceiver_result_t {
+                 auto s = (src_t*)o;
+                 n      = std::min( n, s->in.size() );
+                 memcpy( b, s->in.data(), n );
+                 s->in.erase( 0, n );
+                 return (transceiver_result_t)n;
+             },
+              NULL,
+              []( void*, intptr_t ) { return (transceiver_result_t)0; },
+              []( void* ) { return (transceiver_result_t)0; } };
+        src.desc.vt_ = &vt;
+        src.in
+          = encode( FRAMING_SLIP, "loan" ) + encode( FRAMING_SLIP, "x" );
+
+        buffered_transceiver_t b;
+        char                   rx[64];
+        auto                   h = buffered_transceiver_init(
+          &b, (transceiver_handle_t)&src, NULL, 0, rx, sizeof rx, 0 );
+
+        framing_decoder_init( &d, FRAMING_SLIP, carry, sizeof carry );
+        REQUIRE( framing_decode_loan( &d, h, sink.on_frame, &sink ) == 2 );
+        REQUIRE( sink.frames == std::vector<std::string>{ "loan", "x" } );
+        REQUIRE( sink.ptrs[0] >= rx );
+        REQUIRE( sink.ptrs[0] < rx + sizeof rx );
+        REQUIRE( framing_decode_loan( &d, h, sink.on_frame, &sink ) == 0 );
+    }
+}
@@ -1,13 +1,24 @@
 #include <Catch2/catch.hpp>
 #include <algorithm>
+#include <atomic>
 #include <list>
+#include <thread>
 
 extern "C" {
 #include <uEmbedded/fslist.h>
 }
+#include <uEmbedded-pp/fslist_view.hxx>
+#include <uEmbedded-pp/segmented_fslist.hxx>
 #include <uEmbedded-pp/static_fslist.hxx>
 int v;
 
+// Backing allocator which counts blocks it handed out.
+static size_t      num_alloc;
+static allocator_t counting = {
+    []( void*, size_t sz ) { return ++num_alloc, malloc( sz ); },
+    []( void*, void* p ) { --num_alloc, free( p ); },
+    NULL };
+
 TEST_CASE( "fslist functionalities.", "[fslist]" )
 {
     fslist v;
@@ -106,4 +117,502 @@ TEST_CASE( "fslist Cplusplus version", "[fslist]" )
     }
 
     REQUIRE( std::equal( v.begin(), v.end(), f.begin(), f.end() ) );
-}
\ No newline at end of file
+}
+TEST_CASE( "fslist validity bitmap", "[fslist]" )
+{
+    fslist           v;
+    size_t constexpr CAP  = 4096;
+    char*            buff = (char*)malloc( CAP + 1 );
+
+    // Misaligned buffer is aligned internally.
+    size_t cnt = fslist_init_ex(
+      &v, buff + 1, CAP, sizeof( int ), FSLIST_FLAG_BITMAP );
+    REQUIRE( cnt > 0 );
+    REQUIRE( (uintptr_t)v.bitmap % sizeof( uint64_t ) == 0 );
+    REQUIRE( (char*)( v.data + cnt * sizeof( int ) ) <= buff + 1 + CAP );
+
+    for ( size_t i = 0; i < cnt; ++i )
+        *(int*)fslist_data( &v, fslist_insert( &v, NULL ) ) = (int)i;
+    REQUIRE( fslist_count_range( &v, 0, cnt ) == cnt );
+
+    // Erase every third node
+    for ( size_t i = 0; i < cnt; i += 3 )
+        fslist_erase( &v, v.get + i );
+    REQUIRE( fslist_count_range( &v, 0, cnt ) == v.size );
+    REQUIRE( fslist_count_range( &v, 3, 6 ) == 2 );
+    REQUIRE( fslist_count_range( &v, 60, 130 ) == 46 );
+
+    static std::vector<int> seen;
+    auto push = []( void* p ) { seen.push_back( *(int*)p ); };
+    seen.clear();
+    fslist_forEach_unordered( &v, push );
+    REQUIRE( seen.size() == v.size );
+    REQUIRE( std::is_sorted( seen.begin(), seen.end() ) );
+    REQUIRE( std::none_of(
+      seen.begin(), seen.end(), []( int x ) { return x % 3 == 0; } ) );
+
+    // Same result without bitmap
+    fslist w;
+    fslist_init( &w, buff, CAP, sizeof( int ) );
+    REQUIRE( w.bitmap == NULL );
+    for ( int i = 0; i < 10; ++i )
+        *(int*)fslist_data( &w, fslist_insert( &w, NULL ) ) = i;
+    fslist_erase( &w, w.get + 4 );
+    seen.clear();
+    fslist_forEach_unordered( &w, push );
+    REQUIRE( seen == std::vector<int>{ 0, 1, 2, 3, 5, 6, 7, 8, 9 } );
+
+    free( buff );
+}
+
+TEST_CASE( "fslist bulk operations", "[fslist]" )
+{
+    fslist           a, b;
+    size_t constexpr CAP   = 1024;
+    void*            buff  = malloc( CAP );
+    uint32_t         flags = GENERATE( 0, FSLIST_FLAG_BITMAP );
+    size_t cnt = fslist_init_ex( &a, buff, CAP, sizeof( int ), flags );
+    fslist_init_shared( &b, &a );
+
+    auto values = []( fslist* s ) {
+        std::vector<int> r;
+        for ( auto n = s->size ? s->get + s->head : NULL; n;
+              n      = fslist_next( s, n ) )
+            r.push_back( *(int*)fslist_data( s, n ) );
+        return r;
+    };
+
+    std::vector<fslist_node*> nodes;
+    for ( int i = 0; i < 10; ++i ) {
+        nodes.push_back( fslist_insert( &a, NULL ) );
+        *(int*)fslist_data( &a, nodes.back() ) = i;
+    }
+
+    SECTION( "Erase range and clear" )
+    {
+        REQUIRE( fslist_erase_range( &a, nodes[2], nodes[5] ) == 3 );
+        REQUIRE( values( &a ) == std::vector<int>{ 0, 1, 5, 6, 7, 8, 9 } );
+        REQUIRE( !nodes[3]->isValid );
+
+        REQUIRE( fslist_erase_range( &a, nodes[8], NULL ) == 2 );
+        REQUIRE( a.tail == fslist_idx( &a, nodes[7] ) );
+        REQUIRE( a.size == 5 );
+
+        fslist_clear( &a );
+        REQUIRE( a.size == 0 );
+        REQUIRE( a.head == FSLIST_NODEIDX_NONE );
+        REQUIRE( !nodes[0]->isValid );
+        if ( a.bitmap )
+            REQUIRE( fslist_count_range( &a, 0, cnt ) == 0 );
+
+        // Every node is available again
+        for ( size_t i = 0; i < cnt; ++i )
+            fslist_insert( &a, NULL );
+        REQUIRE( a.inactive == FSLIST_NODEIDX_NONE );
+    }
+
+    SECTION( "Splice within a list and between shared lists" )
+    {
+        REQUIRE( fslist_splice( &a, nodes[1], &a, nodes[7], nodes[9] ) == 0 );
+        REQUIRE( values( &a )
+                 == std::vector<int>{ 0, 7, 8, 1, 2, 3, 4, 5, 6, 9 } );
+
+        REQUIRE( fslist_splice( &b, NULL, &a, nodes[2], nodes[5] ) == 3 );
+        REQUIRE( values( &a ) == std::vector<int>{ 0, 7, 8, 1, 5, 6, 9 } );
+        REQUIRE( values( &b ) == std::vector<int>{ 2, 3, 4 } );
+        REQUIRE( a.size == 7 );
+        REQUIRE( b.size == 3 );
+
+        REQUIRE( fslist_splice( &b, nodes[3], &a, nodes[6], NULL ) == 2 );
+        REQUIRE( values( &b ) == std::vector<int>{ 2, 6, 9, 3, 4 } );
+        REQUIRE( a.tail == fslist_idx( &a, nodes[5] ) );
+
+        // Storage-wide scans on the owner still see nodes moved to b.
+        if ( a.bitmap )
+            REQUIRE( fslist_count_range( &a, 0, cnt ) == 10 );
+
+        fslist_clear( &b );
+        REQUIRE( b.size == 0 );
+        REQUIRE( fslist_insert( &b, NULL ) != NULL );
+    }
+
+    SECTION( "Nodes erased from a shared list return to the owner" )
+    {
+        std::vector<fslist_node*> more;
+        while ( a.inactive != FSLIST_NODEIDX_NONE )
+            more.push_back( fslist_insert( &a, NULL ) );
+
+        fslist_splice( &b, NULL, &a, nodes[0], nodes[4] );
+        fslist_erase( &b, nodes[0] );
+        REQUIRE( fslist_erase_range( &b, nodes[1], nodes[3] ) == 2 );
+        fslist_clear( &b );
+        REQUIRE( b.size == 0 );
+        REQUIRE( b.inactive == FSLIST_NODEIDX_NONE );
+
+        for ( int i = 0; i < 4; ++i )
+            REQUIRE( fslist_insert( &a, NULL ) != NULL );
+        REQUIRE( a.inactive == FSLIST_NODEIDX_NONE );
+        REQUIRE( a.size == cnt );
+
+        fslist_erase( &a, nodes[9] );
+        REQUIRE( fslist_compact( &a, NULL, NULL ) == cnt - 1 );
+    }
+
+    free( buff );
+}
+
+TEST_CASE( "fslist_base bulk operations", "[fslist]" )
+{
+    upp::static_fslist<int, uint16_t, 32> f, g;
+    for ( int i = 0; i < 10; ++i )
+        f.push_back( i );
+
+    auto values = []( auto& l ) {
+        return std::vector<int>( l.begin(), l.end() );
+    };
+
+    SECTION( "Range erase" )
+    {
+        auto first = std::next( f.begin(), 2 ), last = std::next( first, 3 );
+        REQUIRE( *f.erase( first, last ) == 5 );
+        REQUIRE( values( f ) == std::vector<int>{ 0, 1, 5, 6, 7, 8, 9 } );
+        REQUIRE( f.size() == 7 );
+
+        f.erase( std::next( f.begin(), 5 ), f.end() );
+        REQUIRE( values( f ) == std::vector<int>{ 0, 1, 5, 6, 7 } );
+
+        f.clear();
+        REQUIRE( f.empty() );
+        for ( int i = 0; i < 32; ++i )
+            f.push_back( i );
+        REQUIRE( f.size() == 32 );
+    }
+
+    SECTION( "remove_if" )
+    {
+        REQUIRE( f.remove_if( []( int x ) { return x % 3 == 0; } ) == 4 );
+        REQUIRE( values( f ) == std::vector<int>{ 1, 2, 4, 5, 7, 8 } );
+    }
+
+    SECTION( "Splice" )
+    {
+        f.splice( f.begin(), f, std::next( f.begin(), 8 ), f.end() );
+        REQUIRE( values( f )
+                 == std::vector<int>{ 8, 9, 0, 1, 2, 3, 4, 5, 6, 7 } );
+
+        g.push_back( 100 );
+        g.splice(
+          g.begin(), f, std::next( f.begin(), 2 ), std::next( f.begin(), 5 ) );
+        REQUIRE( values( g ) == std::vector<int>{ 0, 1, 2, 100 } );
+        REQUIRE( values( f ) == std::vector<int>{ 8, 9, 3, 4, 5, 6, 7 } );
+
+        g.splice( g.end(), f );
+        REQUIRE( f.empty() );
+        REQUIRE( g.size() == 11 );
+    }
+}
+
+TEST_CASE( "fslist sort and compaction", "[fslist]" )
+{
+    fslist           v;
+    size_t constexpr CAP   = 2048;
+    void*            buff  = malloc( CAP );
+    uint32_t         flags = GENERATE( 0, FSLIST_FLAG_BITMAP );
+    size_t cnt = fslist_init_ex( &v, buff, CAP, sizeof( int ), flags );
+
+    auto values = []( fslist* s ) {
+        std::vector<int> r;
+        for ( auto n = s->size ? s->get + s->head : NULL; n;
+              n      = fslist_next( s, n ) )
+            r.push_back( *(int*)fslist_data( s, n ) );
+        return r;
+    };
+    auto cmp = []( void const* a, void const* b ) {
+        return *(int const*)a - *(int const*)b;
+    };
+
+    // Scatter nodes in memory by inserting at head and erasing some.
+    std::vector<fslist_node*> nodes;
+    for ( int i = 0; i < 40; ++i ) {
+        nodes.push_back( fslist_insert( &v, v.size ? v.get + v.head : NULL ) );
+        *(int*)fslist_data( &v, nodes.back() ) = ( i * 7 ) % 13;
+    }
+    for ( int i = 0; i < 40; i += 4 )
+        fslist_erase( &v, nodes[i] );
+
+    SECTION( "Sort is stable and only relinks" )
+    {
+        auto before = values( &v );
+        auto marker = fslist_data( &v, nodes[1] );
+        fslist_sort( &v, cmp );
+        std::stable_sort( before.begin(), before.end() );
+        REQUIRE( values( &v ) == before );
+        REQUIRE( fslist_data( &v, nodes[1] ) == marker );
+        REQUIRE( v.get[v.tail].next == FSLIST_NODEIDX_NONE );
+    }
+
+    SECTION( "Compaction matches list order to memory order" )
+    {
+        std::vector<fslist_idx_t> remap( cnt );
+        std::vector<int>          old( cnt );
+        for ( size_t i = 0; i < cnt; ++i )
+            old[i] = *(int*)( v.data + i * v.elemSize );
+
+        auto expected = values( &v );
+        bool sorted   = GENERATE( false, true );
+        if ( sorted )
+            std::stable_sort( expected.begin(), expected.end() );
+
+        REQUIRE( fslist_compact( &v, sorted ? +cmp : NULL, remap.data() )
+                 == 30 );
+        REQUIRE( values( &v ) == expected );
+
+        for ( size_t i = 0; i < v.size; ++i ) {
+            REQUIRE( v.get[i].isValid );
+            REQUIRE( *(int*)( v.data + i * v.elemSize ) == expected[i] );
+        }
+        for ( int i = 0; i < 40; ++i ) {
+            auto o = fslist_idx( &v, nodes[i] );
+            if ( i % 4 == 0 )
+                REQUIRE( remap[o] == FSLIST_NODEIDX_NONE );
+            else
+                REQUIRE( *(int*)( v.data + remap[o] * v.elemSize ) == old[o] );
+        }
+        if ( v.bitmap )
+            REQUIRE( fslist_count_range( &v, 0, cnt ) == 30 );
+
+        // Free nodes are still usable
+        while ( v.size < cnt )
+            fslist_insert( &v, NULL );
+        REQUIRE( v.inactive == FSLIST_NODEIDX_NONE );
+    }
+
+    free( buff );
+}
+
+TEST_CASE( "segmented fslist growth", "[fslist]" )
+{
+    num_alloc = 0;
+
+    {
+        upp::segmented_fslist<std::vector<int>, uint16_t, 3> f( &counting );
+        REQUIRE( f.capacity() == 0 );
+        REQUIRE( num_alloc == 0 );
+
+        std::vector<std::vector<int>*> addrs;
+        for ( int i = 0; i < 100; ++i ) {
+            f.emplace_back( 1, i );
+            addrs.push_back( &f.back() );
+        }
+        REQUIRE( f.size() == 100 );
+        REQUIRE( f.capacity() == 104 );
+
+        // Elements never move while the list grows.
+        int k = 0;
+        for ( auto& v : f ) {
+            REQUIRE( &v == addrs[k] );
+            REQUIRE( v[0] == k++ );
+        }
+
+        // Indices are stable, and freed nodes are reused before growing.
+        auto it  = std::next( f.begin(), 10 );
+        auto idx = it.fs_idx__();
+        REQUIRE( ( *f.at__( idx ) )[0] == 10 );
+        f.erase( f.erase( it ) );
+        REQUIRE( f.at__( idx ) == nullptr );
+        f.emplace_front( 1, -1 );
+        f.emplace_front( 1, -2 );
+        REQUIRE( f.capacity() == 104 );
+        REQUIRE( f.front()[0] == -2 );
+        REQUIRE( ( *--f.end() )[0] == 99 );
+
+        f.clear();
+        REQUIRE( f.empty() );
+        REQUIRE( f.reserve( 200 ) );
+        REQUIRE( f.capacity() == 200 );
+        REQUIRE( f.max_size() == 65535 / 8 * 8 );
+    }
+
+    // Every chunk and the directory are released.
+    REQUIRE( num_alloc == 0 );
+}
+
+TEST_CASE( "fslist concurrent free chain", "[fslist]" )
+{
+    fslist           v;
+    size_t constexpr CAP  = 4096;
+    void*            buff = malloc( CAP );
+    size_t           cnt  = fslist_init_ex(
+      &v, buff, CAP, sizeof( int ), FSLIST_FLAG_CONCURRENT );
+    REQUIRE( v.inactive == FSLIST_NODEIDX_NONE );
+
+    SECTION( "Owner thread API works as usual" )
+    {
+        for ( int i = 0; i < 10; ++i )
+            *(int*)fslist_data( &v, fslist_insert( &v, NULL ) ) = i;
+        fslist_erase( &v, v.get + v.head );
+        fslist_erase_range(
+          &v, v.get + v.head, fslist_next( &v, v.get + v.head ) );
+        REQUIRE( v.size == 8 );
+
+        auto n = fslist_alloc_concurrent( &v );
+        REQUIRE( !n->isValid );
+        fslist_link( &v, v.get + v.head, n );
+        REQUIRE( v.head == fslist_idx( &v, n ) );
+        fslist_unlink( &v, n );
+        fslist_release_concurrent( &v, n );
+        REQUIRE( v.size == 8 );
+
+        fslist_clear( &v );
+        for ( size_t i = 0; i < cnt; ++i )
+            REQUIRE( fslist_alloc_concurrent( &v ) );
+        REQUIRE( fslist_alloc_concurrent( &v ) == NULL );
+    }
+
+    SECTION( "Threads allocate and release without lock" )
+    {
+        constexpr int            NUM_THREAD = 4, NUM_ITER = 20000;
+        std::vector<std::thread> threads;
+        std::atomic<int>         numCollision { 0 };
+
+        for ( int t = 0; t < NUM_THREAD; ++t ) {
+            threads.emplace_back( [&, t] {
+                fslist_node* held[8];
+                for ( int i = 0; i < NUM_ITER; ++i ) {
+                    int k = i % 8;
+                    if ( i >= 8 ) {
+                        // Slot must still hold what this thread wrote.
+                        if ( *(int*)fslist_data( &v, held[k] ) != t )
+                            ++numCollision;
+                        fslist_release_concurrent( &v, held[k] );
+                    }
+                    while ( ( held[k] = fslist_alloc_concurrent( &v ) )
+                            == NULL ) { }
+                    *(int*)fslist_data( &v, held[k] ) = t;
+                }
+                for ( auto n : held )
+                    fslist_release_concurrent( &v, n );
+            } );
+        }
+        for ( auto& th : threads )
+            th.join();
+
+        REQUIRE( numCollision == 0 );
+
+        // Every node came back to the free chain.
+        size_t num = 0;
+        while ( fslist_alloc_concurrent( &v ) )
+            ++num;
+        REQUIRE( num == cnt );
+    }
+
+    free( buff );
+}
+
+TEST_CASE( "fslist inlined iteration", "[fslist]" )
+{
+    fslist           v;
+    size_t constexpr CAP  = 1024;
+    void*            buff = malloc( CAP );
+    fslist_init( &v, buff, CAP, sizeof( int ) );
+
+    std::vector<int> expected, seen;
+    for ( int i = 0; i < 20; ++i ) {
+        auto at = i % 2 || v.size == 0 ? NULL : v.get + v.head;
+        *(int*)fslist_data( &v, fslist_insert( &v, at ) ) = i;
+    }
+    for ( auto n = v.get + v.head; n; n = fslist_next( &v, n ) )
+        expected.push_back( *(int*)fslist_data( &v, n ) );
+
+    FSLIST_FOREACH( &v, i ) { seen.push_back( *FSLIST_AT( &v, int, i ) ); }
+    REQUIRE( seen == expected );
+
+    upp::fslist_view<int> view( &v );
+    REQUIRE( std::vector<int>( view.begin(), view.end() ) == expected );
+
+    seen.clear();
+    view.for_each( [&]( int& x ) { seen.push_back( x++ ); } );
+    REQUIRE( seen == expected );
+    REQUIRE( *view.begin() == expected[0] + 1 );
+
+    // Empty list
+    fslist_clear( &v );
+    FSLIST_FOREACH( &v, i ) { FAIL(); }
+    REQUIRE( view.begin() == view.end() );
+
+    free( buff );
+}
+
+TEMPLATE_TEST_CASE(
+  "fslist_base layout policies",
+  "[fslist]",
+  upp::fslist_layout_split,
+  upp::fslist_layout_interleaved,
+  upp::fslist_layout_forward,
+  upp::fslist_layout_forward_interleaved )
+{
+    upp::static_fslist<int, uint16_t, 16, TestType> f;
+    auto values = []( auto& l ) {
+        return std::vector<int>( l.begin(), l.end() );
+    };
+
+    for ( int i = 0; i < 6; ++i )
+        f.push_back( i );
+    f.push_front( -1 );
+    REQUIRE( values( f ) == std::vector<int>{ -1, 0, 1, 2, 3, 4, 5 } );
+
+    auto it = f.emplace_after( std::next( f.begin(), 2 ), 10 );
+    REQUIRE( *it == 10 );
+    f.erase_after( f.begin() );
+    REQUIRE( values( f ) == std::vector<int>{ -1, 1, 10, 2, 3, 4, 5 } );
+
+    // Operations needing predecessor still work without back link.
+    f.erase( std::next( f.begin(), 3 ) );
+    f.emplace( std::next( f.begin(), 1 ), 7 );
+    f.pop_back();
+    f.pop_front();
+    REQUIRE( values( f ) == std::vector<int>{ 7, 1, 10, 3, 4 } );
+    REQUIRE( f.back() == 4 );
+
+    f.splice( f.begin(), f, std::next( f.begin(), 3 ), f.end() );
+    REQUIRE( values( f ) == std::vector<int>{ 3, 4, 7, 1, 10 } );
+    REQUIRE( f.remove_if( []( int x ) { return x > 5; } ) == 2 );
+    REQUIRE( values( f ) == std::vector<int>{ 3, 4, 1 } );
+
+    // Across lists, elements move into the middle in order.
+    upp::static_fslist<int, uint16_t, 16, TestType> g;
+    for ( int i = 20; i < 25; ++i )
+        g.push_back( i );
+    f.splice( std::next( f.begin() ), g, std::next( g.begin() ), g.end() );
+    REQUIRE( values( f ) == std::vector<int>{ 3, 21, 22, 23, 24, 4, 1 } );
+    REQUIRE( values( g ) == std::vector<int>{ 20 } );
+    REQUIRE( f.remove_if( []( int x ) { return x != 4; } ) == 6 );
+    REQUIRE( values( f ) == std::vector<int>{ 4 } );
+    REQUIRE( f.back() == 4 );
+
+    f.clear();
+    for ( int i = 0; i < 16; ++i )
+        f.push_back( i );
+    REQUIRE( f.size() == 16 );
+
+    using iterator = typename decltype( f )::iterator;
+    REQUIRE(
+      std::is_same<
+        typename std::iterator_traits<iterator>::iterator_category,
+        typename std::conditional<
+          TestType::bidirectional,
+          std::bidirectional_iterator_tag,
+          std::forward_iterator_tag>::type>::value );
+}
+
+TEST_CASE( "fslist_base layout footprint", "[fslist]" )
+{
+    using upp::impl::fslist_node;
+    using forward = upp::fslist_layout_forward;
+    REQUIRE(
+      sizeof( fslist_node<uint16_t, false> )
+      < sizeof( fslist_node<uint16_t, true> ) );
+    REQUIRE(
+      sizeof( upp::static_fslist<int, uint16_t, 64, forward> )
+      < sizeof( upp::static_fslist<int, uint16_t, 64> ) );
+}
@@ -0,0 +1,118 @@
+#include <Catch2/catch.hpp>
+#include <string>
+extern "C" {
+#include <uEmbedded/loopback_transceiver.h>
+}
+
+TEST_CASE( "Loopback transceiver", "[loopback_transceiver]" )
+{
+    loopback_link_t link;
+    loopback_config cfg = {};
+    char            wire0[2048], wire1[2048], buf[128];
+    std::string     got;
+
+    SECTION( "Ideal self loop" )
+    {
+        loopback_init( &link, NULL, wire0, sizeof wire0, NULL, 0 );
+        auto h = loopback_endpoint( &link, 0 );
+        REQUIRE( td_write( h, (char*)"hello", 5 ) == 5 );
+        REQUIRE( td_read( h, buf, sizeof buf ) == 5 );
+        REQUIRE( std::string( buf, 5 ) == "hello" );
+    }
+
+    SECTION( "Bandwidth and latency" )
+    {
+        cfg.bytesPerSecond = 1000;
+        cfg.burst          = 10;
+        cfg.latency        = 20;
+        loopback_init( &link, &cfg, wire0, sizeof wire0, wire1, sizeof wire1 );
+        auto a = loopback_endpoint( &link, 0 );
+        auto b = loopback_endpoint( &link, 1 );
+
+        std::string msg( 100, 'x' );
+        REQUIRE( td_write( a, &msg[0], msg.size() ) == 10 );
+        REQUIRE( td_write( a, &msg[0], msg.size() ) == 0 );
+        loopback_advance( &link, 5 );
+        REQUIRE( td_write( a, &msg[0], msg.size() ) == 5 );
+
+        REQUIRE( td_read( b, buf, sizeof buf ) == 0 );
+        REQUIRE( loopback_next_arrival( &link, 1 ) == 20 );
+        loopback_advance( &link, 15 );
+        REQUIRE( td_read( b, buf, sizeof buf ) == 10 );
+        loopback_advance( &link, 5 );
+        REQUIRE( td_read( b, buf, sizeof buf ) == 5 );
+        REQUIRE( td_read( a, buf, sizeof buf ) == 0 );
+    }
+
+    SECTION( "Fragmentation, jitter and partial reads" )
+    {
+        cfg.maxSegment = 3;
+        cfg.latency    = 10;
+        cfg.jitter     = 50;
+        loopback_init( &link, &cfg, wire0, sizeof wire0, wire1, sizeof wire1 );
+        auto a = loopback_endpoint( &link, 0 );
+        auto b = loopback_endpoint( &link, 1 );
+
+        std::string msg = "abcdefghijklmnopqrstuvwxyz";
+        for ( size_t i = 0; i < msg.size(); i += 2 ) {
+            td_write( a, &msg[i], 2 );
+            loopback_advance( &link, 1 );
+        }
+        REQUIRE( link.ep[0].stats.numSegments == 13 );
+
+        while ( got.size() < msg.size() && loopback_now( &link ) < 1000 ) {
+            auto r = td_read( b, buf, 4 );
+            REQUIRE( r >= 0 );
+            REQUIRE( r <= 4 );
+            got.append( buf, r );
+            loopback_advance( &link, 1 );
+        }
+        REQUIRE( got == msg );
+        REQUIRE( link.ep[1].stats.bytesRead == msg.size() );
+    }
+
+    SECTION( "Wire space limits writes" )
+    {
+        loopback_init( &link, NULL, wire0, 64, wire1, sizeof wire1 );
+        auto        b = loopback_endpoint( &link, 1 );
+        std::string msg( 100, 'y' );
+        auto        r = td_write( b, &msg[0], msg.size() );
+        REQUIRE( r > 0 );
+        REQUIRE( r < 64 );
+        REQUIRE( td_write( b, &msg[0], msg.size() ) == 0 );
+    }
+
+    SECTION( "Drops are reproducible by seed" )
+    {
+        cfg.maxSegment = 1;
+        cfg.dropPpm    = 250000;
+        cfg.seed       = 1234;
+
+        size_t dropped[2];
+        for ( int k = 0; k < 2; ++k ) {
+            loopback_init(
+              &link, &cfg, wire0, sizeof wire0, wire1, sizeof wire1 );
+            std::string msg( 100, 'z' );
+            REQUIRE( td_write( loopback_endpoint( &link, 0 ), &msg[0], 100 )
+                     == 100 );
+            dropped[k] = link.ep[0].stats.numDropped;
+            REQUIRE( td_read( loopback_endpoint( &link, 1 ), buf, 128 )
+                     == 100 - (int)dropped[k] );
+        }
+        REQUIRE( dropped[0] == dropped[1] );
+        REQUIRE( dropped[0] > 10 );
+        REQUIRE( dropped[0] < 40 );
+    }
+
+    SECTION( "Close" )
+    {
+        loopback_init( &link, NULL, wire0, sizeof wire0, wire1, sizeof wire1 );
+        auto a = loopback_endpoint( &link, 0 );
+        auto b = loopback_endpoint( &link, 1 );
+        td_write( a, (char*)"bye", 3 );
+        td_close( a );
+        REQUIRE( td_write( b, (char*)"x", 1 ) == TRANSCEIVER_CLOSED );
+        REQUIRE( td_read( b, buf, sizeof buf ) == 3 );
+        REQUIRE( td_read( b, buf, sizeof buf ) == TRANSCEIVER_CLOSED );
+    }
+}
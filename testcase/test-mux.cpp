@@ -0,0 +1,178 @@
+#include <Catch2/catch.hpp>
+#include <string>
+#include <vector>
+extern "C" {
+#include <uEmbedded/buffered_transceiver.h>
+#include <uEmbedded/transceiver_mux.h>
+}
+
+namespace {
+struct link_transceiver
+{
+    tranceiver_desc desc;
+    std::string     in;
+    std::string     out;
+    size_t          maxWrite = (size_t)-1;
+
+    static transceiver_result_t read( void* o, char* b, size_t n )
+    {
+        auto s = (link_transceiver*)o;
+        n      = std::min( n, s->in.size() );
+        memcpy( b, s->in.data(), n );
+        s->in.erase( 0, n );
+        return (transceiver_result_t)n;
+    }
+    static transceiver_result_t write( void* o, char const* b, size_t n )
+    {
+        auto s = (link_transceiver*)o;
+        n      = std::min( n, s->maxWrite );
+        s->out.append( b, n );
+        return (transceiver_result_t)n;
+    }
+    static transceiver_result_t ioctl( void*, intptr_t ) { return 0; }
+    static transceiver_result_t close( void* ) { return 0; }
+
+    link_transceiver()
+    {
+        static transceiver_vtable_t const vt = { read, write, ioctl, close };
+        desc.vt_                             = &vt;
+    }
+
+    transceiver_handle_t handle() { return (transceiver_handle_t)this; }
+};
+
+std::string frame( uint8_t ch, std::string const& payload )
+{
+    std::string r;
+    r += (char)ch;
+    r += (char)( payload.size() & 0xff );
+    r += (char)( payload.size() >> 8 );
+    return r + payload;
+}
+
+//! Splits transmitted stream into channel ids.
+std::vector<int> channels_of( std::string const& s )
+{
+    std::vector<int> r;
+    for ( size_t i = 0; i + MUX_HEADER_SIZE <= s.size(); ) {
+        r.push_back( (uint8_t)s[i] );
+        i += MUX_HEADER_SIZE + ( (uint8_t)s[i + 1] | (uint8_t)s[i + 2] << 8 );
+    }
+    return r;
+}
+} // namespace
+
+TEST_CASE( "Transceiver multiplexer", "[transceiver_mux]" )
+{
+    link_transceiver   link;
+    transceiver_mux_t  mux;
+    struct mux_channel chs[3];
+    char               ctlbuf[64], bulkbuf[1024];
+
+    mux_init( &mux, link.handle(), chs, 3 );
+    auto ctl  = mux_channel_open( &mux, 0, ctlbuf, sizeof ctlbuf, 32, NULL, 0 );
+    auto bulk = mux_channel_open(
+      &mux, 1, bulkbuf, sizeof bulkbuf, 256, NULL, 0 );
+    auto dbg = mux_channel_open( &mux, 2, NULL, 0, 0, NULL, 0 );
+
+    SECTION( "Bulk traffic can't starve control frames" )
+    {
+        std::string big( 200, 'b' );
+        for ( int i = 0; i < 4; ++i )
+            REQUIRE( td_write( bulk, &big[0], big.size() ) == 200 );
+        for ( int i = 0; i < 3; ++i )
+            REQUIRE( td_write( ctl, (char*)"ctrl", 4 ) == 4 );
+
+        REQUIRE( mux_pump( &mux ) == 0 );
+        REQUIRE( channels_of( link.out )
+                 == std::vector<int>{ 0, 0, 0, 1, 1, 1, 1 } );
+
+        link.out.clear();
+        for ( int i = 0; i < 4; ++i )
+            td_write( bulk, &big[0], big.size() );
+        mux_pump( &mux );
+        for ( int i = 0; i < 4; ++i )
+            td_write( bulk, &big[0], big.size() );
+        td_write( ctl, (char*)"ctrl", 4 );
+        mux_pump( &mux );
+
+        // Control frame is sent right after one round of bulk quantum.
+        auto ids = channels_of( link.out );
+        REQUIRE( ids.size() == 9 );
+        REQUIRE( std::find( ids.begin() + 4, ids.end(), 0 ) - ids.begin()
+                 <= 6 );
+    }
+
+    SECTION( "Partial parent writes keep frames intact" )
+    {
+        link.maxWrite = 5;
+        td_write( ctl, (char*)"hello", 5 );
+        td_write( bulk, (char*)"world!", 6 );
+
+        transceiver_result_t pending = 0;
+        for ( int i = 0; i < 10 && ( pending = mux_pump( &mux ) ); ++i ) { }
+        REQUIRE( pending == 0 );
+        REQUIRE( link.out == frame( 0, "hello" ) + frame( 1, "world!" ) );
+        REQUIRE( td_write( dbg, (char*)"x", 1 ) == TRANSCEIVER_NOT_SUPPORTED );
+    }
+
+    SECTION( "Close during a frame sends only that frame" )
+    {
+        link.maxWrite = 2;
+        td_write( ctl, (char*)"hello", 5 );
+        td_write( ctl, (char*)"again", 5 );
+        REQUIRE( mux_pump( &mux ) > 0 );
+        td_close( ctl );
+
+        transceiver_result_t pending = 0;
+        for ( int i = 0; i < 10 && ( pending = mux_pump( &mux ) ); ++i ) { }
+        REQUIRE( pending == 0 );
+        REQUIRE( link.out == frame( 0, "hello" ) );
+    }
+
+    SECTION( "Demultiplex without buffering" )
+    {
+        link.in = frame( 1, "bulk-data" ) + frame( 7, "unknown" )
+                  + frame( 0, "ctl" ) + frame( 2, "dbg" );
+
+        char buf[16];
+        REQUIRE( td_read( ctl, buf, sizeof buf ) == 0 );
+        REQUIRE( mux_rx_channel( &mux ) == 1 );
+        REQUIRE( td_read( bulk, buf, 4 ) == 4 );
+        REQUIRE( td_read( bulk, buf + 4, sizeof buf ) == 5 );
+        REQUIRE( std::string( buf, 9 ) == "bulk-data" );
+
+        REQUIRE( td_read( bulk, buf, sizeof buf ) == 0 );
+        REQUIRE( mux.numDropped == 1 );
+        REQUIRE( td_read( ctl, buf, sizeof buf ) == 3 );
+
+        td_close( dbg );
+        REQUIRE( td_read( ctl, buf, sizeof buf ) == 0 );
+        REQUIRE( mux.numDropped == 2 );
+        REQUIRE( link.in.empty() );
+    }
+
+    SECTION( "Notify and loan through buffered parent" )
+    {
+        buffered_transceiver_t b;
+        char                   rx[64];
+        auto                   h = buffered_transceiver_init(
+          &b, link.handle(), NULL, 0, rx, sizeof rx, 0 );
+
+        std::vector<std::string> got;
+        auto on_frame = []( void* o, transceiver_handle_t ch ) {
+            char* p;
+            auto  n = td_loan( ch, &p );
+            ( (std::vector<std::string>*)o )->emplace_back( p, n );
+            td_release( ch, n );
+        };
+
+        mux_init( &mux, h, chs, 3 );
+        mux_channel_open( &mux, 0, NULL, 0, 0, on_frame, &got );
+        mux_channel_open( &mux, 1, NULL, 0, 0, on_frame, &got );
+
+        link.in = frame( 0, "a" ) + frame( 1, "bc" ) + frame( 0, "def" );
+        REQUIRE( mux_poll( &mux ) == 3 );
+        REQUIRE( got == std::vector<std::string>{ "a", "bc", "def" } );
+    }
+}
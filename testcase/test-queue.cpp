@@ -65,6 +65,41 @@ TEST_CASE( "Queue functionality test", "[Queue]" )
     free( s.buff );
 } 
 
+TEST_CASE( "Queue allocator rejects what doesn't fit", "[Queue]" )
+{
+    queue_allocator s;
+    size_t          buff[16];
+    queue_allocator_init( &s, buff, sizeof( buff ) );
+
+    // Larger than the whole buffer, even when empty.
+    REQUIRE( queue_allocator_push( &s, sizeof( buff ) ) == NULL );
+    REQUIRE( s.cnt == 0 );
+
+    // Fill up, then free the front; wrapping must not overrun the rest.
+    size_t n = 0;
+    while ( queue_allocator_push( &s, sizeof( size_t ) * 2 ) )
+        ++n;
+    REQUIRE( n > 1 );
+    REQUIRE( s.cnt == n );
+
+    queue_allocator_pop( &s );
+    queue_allocator_pop( &s );
+    REQUIRE( queue_allocator_push( &s, sizeof( buff ) / 2 ) == NULL );
+    REQUIRE( s.cnt == n - 2 );
+
+    // Wraps around to the front.
+    size_t* p = (size_t*)queue_allocator_push( &s, sizeof( size_t ) * 2 );
+    REQUIRE( (void*)p < (void*)( buff + 2 ) );
+    *p = 42;
+    for ( size_t i = 0; i < n - 2; ++i )
+        queue_allocator_pop( &s );
+
+    size_t len;
+    REQUIRE( *(size_t*)queue_allocator_peek( &s, &len ) == 42 );
+    queue_allocator_pop( &s );
+    REQUIRE( s.cnt == 0 );
+}
+
 using namespace std;
 
 TEST_CASE( "Buffer test", "[ring_buffer]" )
@@ -74,5 +109,30 @@ TEST_CASE( "Buffer test", "[ring_buffer]" )
 
     ring_buffer_init( &v, buff, sizeof( buff ) );
 
-    // @todo.
+    SECTION( "Linear regions around wrap point" )
+    {
+        size_t len;
+        char*  p = ring_buffer_linear_write( &v, &len );
+        REQUIRE( p == buff );
+        REQUIRE( len == sizeof( buff ) - 1 );
+        REQUIRE( ring_buffer_space( &v ) == sizeof( buff ) - 1 );
+
+        ring_buffer_commit( &v, sizeof( buff ) - 16 );
+        ring_buffer_consume( &v, sizeof( buff ) - 32 );
+
+        p = ring_buffer_linear_write( &v, &len );
+        REQUIRE( len == 16 );
+        memset( p, 'a', len );
+        ring_buffer_commit( &v, len );
+
+        p = ring_buffer_linear_write( &v, &len );
+        REQUIRE( p == buff );
+        REQUIRE( len == sizeof( buff ) - 32 - 1 );
+
+        p = ring_buffer_linear_read( &v, &len );
+        REQUIRE( len == 32 );
+        REQUIRE( p[31] == 'a' );
+        ring_buffer_consume( &v, len );
+        REQUIRE( ring_buffer_size( &v ) == 0 );
+    }
 }
\ No newline at end of file
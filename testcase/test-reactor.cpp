@@ -0,0 +1,162 @@
+#include <Catch2/catch.hpp>
+extern "C" {
+#include <uEmbedded/transceiver_reactor.h>
+}
+
+#if REACTOR_HAS_EPOLL
+#    include <unistd.h>
+#endif
+
+namespace {
+struct fake_transceiver
+{
+    tranceiver_desc desc;
+    int             pending;
+};
+
+uint32_t fake_poll( void* obj, transceiver_handle_t h, uint32_t interest )
+{
+    return ( (fake_transceiver*)h )->pending ? REACTOR_READABLE : 0;
+}
+
+void on_ready( void* obj, transceiver_handle_t h, uint32_t events )
+{
+    *(int*)obj += 1;
+    ( (fake_transceiver*)h )->pending = 0;
+}
+} // namespace
+
+TEST_CASE( "Reactor poll sources", "[transceiver_reactor]" )
+{
+    static char           qbuf[0x1000];
+    static char           rbuf[REACTOR_ELEM_SIZE * 16];
+    EventQueue            queue;
+    transceiver_reactor_t r;
+
+    InitEventProcedure( &queue, qbuf, sizeof( qbuf ) );
+    REQUIRE( reactor_init( &r, &queue, rbuf, sizeof( rbuf ) ) == 16 );
+
+    fake_transceiver t[4] = {};
+    int              cnt  = 0;
+    reactor_handle_t rh[4];
+    for ( int i = 0; i < 4; ++i )
+        rh[i] = reactor_add_poll(
+          &r,
+          (transceiver_handle_t)&t[i],
+          fake_poll,
+          REACTOR_READABLE,
+          on_ready,
+          &cnt );
+
+    t[1].pending = t[3].pending = 1;
+    REQUIRE( reactor_wait( &r, 0 ) == 2 );
+    FlushEvents( &queue );
+    REQUIRE( cnt == 2 );
+    REQUIRE( reactor_wait( &r, 0 ) == 0 );
+
+    SECTION( "Removed registration discards queued events" )
+    {
+        t[2].pending = 1;
+        REQUIRE( reactor_wait( &r, 0 ) == 1 );
+        REQUIRE( reactor_remove( &r, rh[2] ) );
+        FlushEvents( &queue );
+        REQUIRE( cnt == 2 );
+        REQUIRE_FALSE( reactor_remove( &r, rh[2] ) );
+    }
+
+#if REACTOR_HAS_EPOLL
+    SECTION( "File descriptor sources" )
+    {
+        int fds[2];
+        REQUIRE( pipe( fds ) == 0 );
+
+        fake_transceiver p  = {};
+        auto             fh = reactor_add_fd(
+          &r,
+          (transceiver_handle_t)&p,
+          fds[0],
+          REACTOR_READABLE,
+          on_ready,
+          &cnt );
+        REQUIRE( fh.n );
+
+        REQUIRE( reactor_wait( &r, 0 ) == 0 );
+        REQUIRE( write( fds[1], "x", 1 ) == 1 );
+        REQUIRE( reactor_wait( &r, 100 ) == 1 );
+        FlushEvents( &queue );
+        REQUIRE( cnt == 3 );
+
+        REQUIRE( reactor_remove( &r, fh ) );
+        REQUIRE( reactor_wait( &r, 0 ) == 0 );
+        close( fds[0] );
+        close( fds[1] );
+    }
+#endif
+
+    reactor_destroy( &r );
+}
+
+#if REACTOR_HAS_EPOLL
+TEST_CASE( "Reactor epoll sources", "[transceiver_reactor]" )
+{
+    static char           qbuf[256];
+    static char           rbuf[REACTOR_ELEM_SIZE * 4];
+    EventQueue            queue;
+    transceiver_reactor_t r;
+
+    InitEventProcedure( &queue, qbuf, sizeof( qbuf ) );
+
+    // Failed initialization leaves no descriptor behind.
+    REQUIRE( reactor_init( &r, &queue, rbuf, 1 ) == 0 );
+    REQUIRE( r.epfd == -1 );
+    REQUIRE( reactor_init( &r, &queue, rbuf, sizeof( rbuf ) ) == 4 );
+
+    int fds[2];
+    REQUIRE( pipe( fds ) == 0 );
+
+    fake_transceiver p   = {};
+    int              cnt = 0;
+    auto             wh  = reactor_add_fd(
+      &r,
+      (transceiver_handle_t)&p,
+      fds[1],
+      REACTOR_WRITABLE,
+      on_ready,
+      &cnt );
+    REQUIRE( wh.n );
+
+    // Empty pipe is writable at once, until interest is dropped.
+    REQUIRE( reactor_wait( &r, 0 ) == 1 );
+    FlushEvents( &queue );
+    REQUIRE( cnt == 1 );
+    REQUIRE( reactor_modify( &r, wh, 0 ) );
+    REQUIRE( reactor_wait( &r, 0 ) == 0 );
+
+    SECTION( "Removed registration discards queued events" )
+    {
+        REQUIRE( reactor_modify( &r, wh, REACTOR_WRITABLE ) );
+        REQUIRE( reactor_wait( &r, 0 ) == 1 );
+        REQUIRE( reactor_remove( &r, wh ) );
+        FlushEvents( &queue );
+        REQUIRE( cnt == 1 );
+    }
+
+    SECTION( "Events dropped by a full queue aren't counted" )
+    {
+        REQUIRE( reactor_modify( &r, wh, REACTOR_WRITABLE ) );
+
+        size_t n = 0;
+        while ( reactor_wait( &r, 0 ) == 1 )
+            ++n;
+        REQUIRE( n > 0 );
+        REQUIRE( queue.queue.cnt == n );
+
+        FlushEvents( &queue );
+        REQUIRE( cnt == 1 + (int)n );
+    }
+
+    close( fds[0] );
+    close( fds[1] );
+    reactor_destroy( &r );
+}
+#endif
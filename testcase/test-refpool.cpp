@@ -2,7 +2,21 @@
 extern "C"
 {
 #include <uEmbedded/managed_reference_pool.h>
+#include <uEmbedded/slab_allocator.h>
 }
+#include <uEmbedded-pp/ref_ptr.hxx>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Backing allocator which counts blocks it handed out.
+static size_t      numBacking;
+static allocator_t counting = {
+    []( void*, size_t sz ) { return ++numBacking, malloc( sz ); },
+    []( void*, void* p ) { --numBacking, free( p ); },
+    NULL };
 
 TEST_CASE("refpool test", "[managed_reference_pool]")
 {
@@ -47,4 +61,470 @@ TEST_CASE("refpool test", "[managed_reference_pool]")
     REQUIRE(refpool_num_available(p));
 
     refpool_destroy(p);
-}
\ No newline at end of file
+}
+
+TEST_CASE( "slab allocator", "[managed_reference_pool]" )
+{
+    numBacking = 0;
+
+    size_t const     classes[] = { 8, 24, 100 };
+    slab_allocator_t slab;
+    slab_allocator_init( &slab, &counting, classes, 3, 1024 );
+
+    // Blocks of a class come from single slab, in ascending address.
+    char* a = (char*)slab_alloc( &slab, 20 );
+    char* b = (char*)slab_alloc( &slab, 24 );
+    REQUIRE( numBacking == 1 );
+    REQUIRE( b - a == 32 + SLAB_ALIGN );
+    REQUIRE( (uintptr_t)a % SLAB_ALIGN == 0 );
+    REQUIRE( (uintptr_t)a % alignof( std::max_align_t ) == 0 );
+
+    // Freed block is reused first. Classes are rounded up to alignment.
+    slab_free( &slab, a );
+    REQUIRE( slab_alloc( &slab, 16 + 1 ) == a );
+
+    // Oversized requests go to backing allocator.
+    void* big = slab_alloc( &slab, 4000 );
+    REQUIRE( numBacking == 2 );
+    slab_free( &slab, big );
+    REQUIRE( numBacking == 1 );
+
+    std::vector<void*> v;
+    for ( int i = 0; i < 100; ++i )
+        v.push_back( slab_alloc( &slab, 100 ) );
+    REQUIRE( slab.classes[2].numTotal >= 100 );
+    for ( auto p : v )
+        slab_free( &slab, p );
+    REQUIRE( slab.classes[2].numFree == slab.classes[2].numTotal );
+
+    // Emptied slabs go back to backing allocator.
+    size_t numBefore = numBacking;
+    REQUIRE( slab_allocator_trim( &slab ) > 0 );
+    REQUIRE( numBacking < numBefore );
+    REQUIRE( slab.classes[2].numTotal == 0 );
+
+    auto iface = slab_allocator_ref( &slab );
+    void* p = iface->allocate( iface->object, 8 );
+    REQUIRE( p );
+    iface->release( iface->object, p );
+
+    slab_allocator_destroy( &slab );
+    REQUIRE( numBacking == 0 );
+}
+
+TEST_CASE( "refpool over slab", "[managed_reference_pool]" )
+{
+    numBacking = 0;
+
+    refpool_desc desc = {};
+    desc.numMaxRef    = 256;
+    desc.alloc        = &counting;
+    desc.flags        = REFPOOL_FLAG_SLAB;
+    auto p            = refpool_create_ex( &desc );
+    REQUIRE( numBacking == 2 );
+
+    std::vector<refhandle_t> hd;
+    for ( int i = 0; i < 256; ++i ) {
+        hd.push_back( refpool_malloc( p, sizeof( int ) ) );
+        *(int*)ref_lock( &hd.back() ) = i;
+        ref_unlock( &hd.back() );
+    }
+
+    // Small objects share a few slabs instead of 256 heap blocks.
+    REQUIRE( numBacking < 2 + 8 );
+
+    for ( int i = 0; i < 256; i += 2 )
+        REQUIRE( ref_free( &hd[i] ) );
+    for ( int i = 1; i < 256; i += 2 ) {
+        REQUIRE( *(int*)ref_lock( &hd[i] ) == i );
+        ref_unlock( &hd[i] );
+    }
+    REQUIRE( refpool_num_available( p ) == 128 );
+
+    refpool_destroy( p );
+    REQUIRE( numBacking == 0 );
+}
+
+TEST_CASE( "refpool compact handles", "[managed_reference_pool]" )
+{
+    static_assert( sizeof( refid_t ) == 8, "" );
+
+    auto p = refpool_create( 64 );
+    auto q = refpool_create( 64 );
+
+    refid_t a = refpool_malloc_id( p, sizeof( int ) );
+    refid_t b = refpool_malloc_id( q, sizeof( int ) );
+    REQUIRE( a != REFID_NULL );
+    REQUIRE( b != REFID_NULL );
+    REQUIRE( a != b );
+
+    *(int*)refid_lock( a ) = 1;
+    *(int*)refid_lock( b ) = 2;
+    refid_unlock( a );
+    refid_unlock( b );
+
+    // Round trip with full handles
+    refhandle_t h = ref_from_id( a );
+    REQUIRE( *(int*)ref_lock( &h ) == 1 );
+    ref_unlock( &h );
+    REQUIRE( ref_to_id( &h ) == a );
+
+    // Deferred free keeps the object until the last unlock.
+    REQUIRE( refid_lock( a ) );
+    REQUIRE( refid_free( a ) );
+    REQUIRE( !refid_is_valid( a ) );
+    REQUIRE( refid_lock( a ) == NULL );
+    refid_unlock( a );
+    REQUIRE( !ref_is_valid( &h ) );
+    REQUIRE( !refid_free( a ) );
+
+    // Reused slot gets a new generation.
+    refid_t c = refpool_malloc_id( p, sizeof( int ) );
+    REQUIRE( ( c & 0xffffffff ) == ( a & 0xffffffff ) );
+    REQUIRE( c != a );
+    REQUIRE( refid_is_valid( c ) );
+    REQUIRE( !refid_is_valid( a ) );
+
+    // Handles of destroyed pool are invalid.
+    refpool_destroy( q );
+    REQUIRE( !refid_is_valid( b ) );
+    REQUIRE( refid_lock( b ) == NULL );
+    REQUIRE( !refid_is_valid( REFID_NULL ) );
+
+    // Pool taking over the slot doesn't revive them.
+    auto    r = refpool_create( 64 );
+    refid_t d = refpool_malloc_id( r, sizeof( int ) );
+    REQUIRE( d != REFID_NULL );
+    REQUIRE( d != b );
+    REQUIRE( !refid_is_valid( b ) );
+    REQUIRE( refid_lock( b ) == NULL );
+    REQUIRE( refid_is_valid( d ) );
+
+    refpool_destroy( r );
+    refpool_destroy( p );
+}
+
+TEST_CASE( "refpool concurrent mode", "[managed_reference_pool]" )
+{
+    constexpr int NUM_SHARED = 256, NUM_THREAD = 4, NUM_ITER = 20000;
+
+    refpool_desc desc = {};
+    desc.numMaxRef    = NUM_SHARED + NUM_THREAD * 8;
+    desc.flags        = REFPOOL_FLAG_CONCURRENT;
+    auto p            = refpool_create_ex( &desc );
+
+    refhandle_t shared[NUM_SHARED];
+    for ( int i = 0; i < NUM_SHARED; ++i ) {
+        shared[i]                     = refpool_malloc( p, sizeof( int ) );
+        *(int*)ref_lock( shared + i ) = i;
+        ref_unlock( shared + i );
+    }
+
+    std::vector<std::thread> threads;
+    std::atomic<int>         numCorrupt { 0 };
+
+    // Readers lock shared objects while they are being freed.
+    for ( int t = 0; t < NUM_THREAD; ++t ) {
+        threads.emplace_back( [&, t] {
+            refhandle_t own[8];
+            for ( int i = 0; i < NUM_ITER; ++i ) {
+                refhandle_t h = shared[( i * 7 + t ) % NUM_SHARED];
+                if ( auto v = (int*)ref_lock( &h ) ) {
+                    if ( *v != ( i * 7 + t ) % NUM_SHARED )
+                        ++numCorrupt;
+                    ref_unlock( &h );
+                }
+
+                // Churn private objects meanwhile.
+                int k = i % 8;
+                if ( i >= 8 ) {
+                    if ( *(int*)ref_lock( own + k ) != t )
+                        ++numCorrupt;
+                    ref_unlock( own + k );
+                    ref_free( own + k );
+                }
+                own[k]                     = refpool_malloc( p, sizeof( int ) );
+                *(int*)ref_lock( own + k ) = t;
+                ref_unlock( own + k );
+            }
+            for ( auto& h : own )
+                ref_free( &h );
+        } );
+    }
+
+    threads.emplace_back( [&] {
+        for ( auto& h : shared )
+            numCorrupt += !ref_free( &h );
+    } );
+
+    for ( auto& th : threads )
+        th.join();
+
+    REQUIRE( numCorrupt == 0 );
+    for ( auto& h : shared )
+        REQUIRE( !ref_is_valid( &h ) );
+
+    // Every object is reclaimed by the last unlock.
+    REQUIRE( refpool_num_available( p ) == desc.numMaxRef );
+
+    int num = 0;
+    refpool_foreach( p, &num, []( void* n, refhandle_t* ) { ++*(int*)n; } );
+    REQUIRE( num == 0 );
+
+    refpool_destroy( p );
+}
+
+TEST_CASE( "refpool compaction", "[managed_reference_pool]" )
+{
+    numBacking = 0;
+
+    refpool_desc desc = {};
+    desc.numMaxRef    = 1024;
+    desc.alloc        = &counting;
+    desc.flags        = REFPOOL_FLAG_SLAB;
+    auto p            = refpool_create_ex( &desc );
+
+    std::vector<refhandle_t> hd;
+    for ( int i = 0; i < 1024; ++i ) {
+        hd.push_back( refpool_malloc( p, sizeof( int ) ) );
+        *(int*)ref_lock( &hd.back() ) = i;
+        ref_unlock( &hd.back() );
+    }
+    size_t const numFull = numBacking;
+
+    // Leave every slab sparsely used.
+    for ( int i = 0; i < 1024; ++i )
+        if ( i % 8 )
+            ref_free( &hd[i] );
+
+    // Locked object must not move.
+    void* pinned = ref_lock( &hd[8] );
+
+    REQUIRE( refpool_compact( p ) > 0 );
+    REQUIRE( numBacking < numFull );
+    REQUIRE( ref_lock( &hd[8] ) == pinned );
+    ref_unlock( &hd[8] );
+    ref_unlock( &hd[8] );
+
+    for ( int i = 0; i < 1024; i += 8 ) {
+        REQUIRE( *(int*)ref_lock( &hd[i] ) == i );
+        ref_unlock( &hd[i] );
+    }
+
+    // Compacted pool stays usable.
+    refhandle_t h = refpool_malloc( p, sizeof( int ) );
+    REQUIRE( ref_lock( &h ) );
+    ref_unlock( &h );
+
+    SECTION( "Plain allocator pool is left as is" )
+    {
+        auto  q   = refpool_create( 16 );
+        auto  a   = refpool_malloc( q, 64 );
+        void* mem = ref_lock( &a );
+        ref_unlock( &a );
+
+        REQUIRE( refpool_compact( q ) == 0 );
+        REQUIRE( ref_lock( &a ) == mem );
+        ref_unlock( &a );
+        refpool_destroy( q );
+    }
+
+    refpool_destroy( p );
+    REQUIRE( numBacking == 0 );
+}
+
+TEST_CASE( "refpool growth", "[managed_reference_pool]" )
+{
+    refpool_desc desc = {};
+    desc.numMaxRef    = 16;
+    desc.numMaxChunk  = 4;
+    desc.flags        = REFPOOL_FLAG_SHRINK;
+    auto p            = refpool_create_ex( &desc );
+
+    refpool_stats st;
+    refpool_get_stats( p, &st );
+    REQUIRE( st.capacity == 16 );
+
+    std::vector<refhandle_t> hd;
+    for ( int i = 0; i < 64; ++i ) {
+        hd.push_back( refpool_malloc( p, sizeof( int ) ) );
+        *(int*)ref_lock( &hd.back() ) = i;
+        ref_unlock( &hd.back() );
+    }
+
+    // Growth keeps earlier handles valid.
+    for ( int i = 0; i < 64; ++i ) {
+        REQUIRE( *(int*)ref_lock( &hd[i] ) == i );
+        ref_unlock( &hd[i] );
+    }
+    refid_t last = ref_to_id( &hd.back() );
+    REQUIRE( *(int*)refid_lock( last ) == 63 );
+    refid_unlock( last );
+
+    refpool_get_stats( p, &st );
+    REQUIRE( st.capacity == 64 );
+    REQUIRE( st.numGrow == 3 );
+    REQUIRE( st.peak == 64 );
+
+    // Full pool which can't grow gives invalid handle.
+    REQUIRE( refpool_malloc( p, 4 ).id == OBJECTID_NULL );
+
+    int num = 0;
+    refpool_foreach( p, &num, []( void* n, refhandle_t* ) { ++*(int*)n; } );
+    REQUIRE( num == 64 );
+
+    // Drained chunks are released; their handles become invalid.
+    for ( int i = 16; i < 64; ++i )
+        REQUIRE( ref_free( &hd[i] ) );
+
+    // Chunk 1 drained without room to spare, but goes once chunk 2 drains.
+    // One empty chunk is kept as margin.
+    refpool_get_stats( p, &st );
+    REQUIRE( st.numShrink == 2 );
+    REQUIRE( st.capacity == 32 );
+    REQUIRE( st.numLive == 16 );
+    REQUIRE( st.peak == 64 );
+    REQUIRE( !ref_is_valid( &hd[20] ) );
+    REQUIRE( !ref_is_valid( &hd[40] ) );
+    REQUIRE( ref_lock( &hd[40] ) == NULL );
+
+    // Frees in the first chunk make room to release the one left empty.
+    for ( int i = 0; i < 8; ++i )
+        REQUIRE( ref_free( &hd[i] ) );
+    refpool_get_stats( p, &st );
+    REQUIRE( st.numShrink == 3 );
+    REQUIRE( st.capacity == 16 );
+    REQUIRE( !refid_is_valid( last ) );
+    REQUIRE( *(int*)ref_lock( &hd[8] ) == 8 );
+    ref_unlock( &hd[8] );
+
+    refpool_destroy( p );
+}
+
+TEST_CASE( "upp::ref_ptr", "[managed_reference_pool]" )
+{
+    static int numAlive;
+    struct obj
+    {
+        int v;
+        obj( int v_, bool bThrow = false )
+            : v( v_ )
+        {
+            if ( bThrow )
+                throw v;
+            ++numAlive;
+        }
+        ~obj() { --numAlive; }
+    };
+    numAlive = 0;
+
+    static_assert( sizeof( upp::ref_ptr<obj> ) == sizeof( refhandle_t ), "" );
+
+    {
+        upp::ref_pool<obj> pool( 8 );
+        auto               a = pool.make( 1 );
+        REQUIRE( a );
+        REQUIRE( numAlive == 1 );
+        REQUIRE( a.lock()->v == 1 );
+
+        // Destructor runs on the last unlock after free.
+        auto b = pool.make( 2 );
+        {
+            auto g = b.lock();
+            b.reset();
+            REQUIRE( !b );
+            REQUIRE( numAlive == 2 );
+            REQUIRE( g->v == 2 );
+        }
+        REQUIRE( numAlive == 1 );
+
+        // Ownership moves.
+        upp::ref_ptr<obj> c = std::move( a );
+        REQUIRE( !a.lock() );
+        REQUIRE( c.lock()->v == 1 );
+
+        // Failed construction returns the node without destructor.
+        size_t avail = pool.num_available();
+        REQUIRE_THROWS( pool.make( 3, true ) );
+        REQUIRE( pool.num_available() == avail );
+        REQUIRE( numAlive == 1 );
+
+        // Pool destroys objects still alive.
+        c.release();
+    }
+    REQUIRE( numAlive == 0 );
+}
+
+TEST_CASE( "refpool parallel foreach", "[managed_reference_pool]" )
+{
+    constexpr int NUM_OBJ = 100000, NUM_PART = 8;
+
+    refpool_executor_t exec = {
+        []( void*, size_t n, void ( *task )( void*, size_t ), void* arg ) {
+            std::vector<std::thread> th;
+            for ( size_t i = 0; i < n; ++i )
+                th.emplace_back( task, arg, i );
+            for ( auto& t : th )
+                t.join();
+        },
+        NULL };
+
+    refpool_desc desc = {};
+    desc.numMaxRef    = NUM_OBJ / 4;
+    desc.numMaxChunk  = 4;
+    auto p            = refpool_create_ex( &desc );
+
+    std::vector<refhandle_t> hd;
+    for ( int i = 0; i < NUM_OBJ; ++i ) {
+        hd.push_back( refpool_malloc( p, sizeof( int ) ) );
+        *(int*)ref_lock( &hd.back() ) = i;
+        ref_unlock( &hd.back() );
+    }
+
+    struct partial
+    {
+        int64_t sum;
+        int     num;
+    };
+    struct result
+    {
+        int64_t sum;
+        int     num;
+        int     numReduce;
+    } res = {};
+    partial parts[NUM_PART] = {};
+
+    refpool_parallel_desc pd = {};
+    pd.executor              = &exec;
+    pd.numPartition          = NUM_PART;
+    pd.caller                = &res;
+    pd.partials              = parts;
+    pd.partialSize           = sizeof( partial );
+    pd.cb = []( void*, void* part, refhandle_t* h ) {
+        auto v = *(int*)ref_lock( h );
+        ref_unlock( h );
+        ( (partial*)part )->sum += v;
+        ( (partial*)part )->num++;
+
+        // Odd objects free themselves.
+        if ( v & 1 )
+            ref_free( h );
+    };
+    pd.reduce = []( void* r, void* part ) {
+        ( (result*)r )->sum += ( (partial*)part )->sum;
+        ( (result*)r )->num += ( (partial*)part )->num;
+        ( (result*)r )->numReduce++;
+    };
+
+    refpool_foreach_parallel( p, &pd );
+    REQUIRE( res.num == NUM_OBJ );
+    REQUIRE( res.sum == int64_t( NUM_OBJ ) * ( NUM_OBJ - 1 ) / 2 );
+    REQUIRE( res.numReduce == NUM_PART );
+
+    // Objects freed during iteration are reclaimed.
+    REQUIRE( refpool_num_available( p ) == NUM_OBJ / 2 );
+    REQUIRE( !ref_is_valid( &hd[1] ) );
+    REQUIRE( ref_is_valid( &hd[2] ) );
+
+    refpool_destroy( p );
+}
@@ -0,0 +1,158 @@
+#include <Catch2/catch.hpp>
+#include <string>
+extern "C" {
+#include <uEmbedded/buffered_transceiver.h>
+}
+
+namespace {
+//! Memory backed transceiver which records number of calls.
+struct mem_transceiver
+{
+    tranceiver_desc desc;
+    std::string     in;
+    std::string     out;
+    size_t          numRead  = 0;
+    size_t          numWrite = 0;
+    size_t          numFlush = 0;
+    size_t          maxWrite = (size_t)-1;
+
+    static transceiver_result_t read( void* o, char* b, size_t n )
+    {
+        auto s = (mem_transceiver*)o;
+        ++s->numRead;
+        n = std::min( n, s->in.size() );
+        memcpy( b, s->in.data(), n );
+        s->in.erase( 0, n );
+        return (transceiver_result_t)n;
+    }
+    static transceiver_result_t write( void* o, char const* b, size_t n )
+    {
+        auto s = (mem_transceiver*)o;
+        ++s->numWrite;
+        n = std::min( n, s->maxWrite );
+        s->out.append( b, n );
+        return (transceiver_result_t)n;
+    }
+    static transceiver_result_t ioctl( void* o, intptr_t cmd )
+    {
+        ( (mem_transceiver*)o )->numFlush += cmd == TRANSCEIVER_IOCTL_FLUSH;
+        return TRANSCEIVER_OK;
+    }
+    static transceiver_result_t close( void* ) { return TRANSCEIVER_OK; }
+
+    mem_transceiver()
+    {
+        static transceiver_vtable_t const vt = { read, write, ioctl, close };
+        desc.vt_                             = &vt;
+    }
+
+    transceiver_handle_t handle() { return (transceiver_handle_t)this; }
+};
+} // namespace
+
+TEST_CASE( "Buffered transceiver", "[transceiver]" )
+{
+    mem_transceiver        m;
+    buffered_transceiver_t b;
+    char                   tx[64], rx[64];
+
+    auto h = buffered_transceiver_init(
+      &b, m.handle(), tx, sizeof tx, rx, sizeof rx, 32 );
+
+    SECTION( "Small writes are coalesced" )
+    {
+        char msg[] = "abcd";
+        for ( int i = 0; i < 7; ++i )
+            REQUIRE( td_write( h, msg, 4 ) == 4 );
+        REQUIRE( m.numWrite == 0 );
+
+        REQUIRE( td_write( h, msg, 4 ) == 4 );
+        REQUIRE( m.numWrite == 1 );
+        REQUIRE( m.out.size() == 32 );
+
+        REQUIRE( td_write( h, msg, 2 ) == 2 );
+        REQUIRE( td_ioctl( h, TRANSCEIVER_IOCTL_FLUSH ) == 0 );
+        REQUIRE( m.out.size() == 34 );
+        REQUIRE( m.numFlush == 1 );
+    }
+
+    SECTION( "Partial flush keeps remaining bytes" )
+    {
+        m.maxWrite = 5;
+        char msg[] = "0123456789";
+        REQUIRE( td_write( h, msg, 10 ) == 10 );
+        REQUIRE( buffered_transceiver_flush( &b ) == 5 );
+        REQUIRE( buffered_transceiver_flush( &b ) == 0 );
+        REQUIRE( m.out == "0123456789" );
+    }
+
+    SECTION( "Flush on interval" )
+    {
+        b.flushInterval = 10;
+        char msg[]      = "xy";
+        td_write( h, msg, 2 );
+        buffered_transceiver_tick( &b, 5 );
+        REQUIRE( m.out.empty() );
+        buffered_transceiver_tick( &b, 10 );
+        REQUIRE( m.out == "xy" );
+    }
+
+    SECTION( "Read ahead" )
+    {
+        m.in = "hello, world";
+        char buf[16];
+        REQUIRE( td_read( h, buf, 5 ) == 5 );
+        REQUIRE( td_read( h, buf + 5, 7 ) == 7 );
+        REQUIRE( m.numRead == 1 );
+        REQUIRE( std::string( buf, 12 ) == "hello, world" );
+        REQUIRE( td_read( h, buf, 4 ) == 0 );
+    }
+
+    SECTION( "Vectored write and loaned read" )
+    {
+        char                hdr[] = "[", body[] = "payload", crc[] = "]";
+        transceiver_iovec_t iov[] = { { hdr, 1 }, { body, 7 }, { crc, 1 } };
+        REQUIRE( td_writev( h, iov, 3 ) == 9 );
+        REQUIRE( m.numWrite == 0 );
+        td_ioctl( h, TRANSCEIVER_IOCTL_FLUSH );
+        REQUIRE( m.out == "[payload]" );
+
+        m.in = "frame";
+        char* p;
+        REQUIRE( td_loan( h, &p ) == 5 );
+        REQUIRE( memcmp( p, "frame", 5 ) == 0 );
+        REQUIRE( td_release( h, 2 ) == TRANSCEIVER_OK );
+        REQUIRE( td_loan( h, &p ) == 3 );
+        REQUIRE( *p == 'a' );
+        td_release( h, 3 );
+
+        REQUIRE( td_loan( m.handle(), &p ) == TRANSCEIVER_NOT_SUPPORTED );
+    }
+
+    SECTION( "Generic vectored fallback" )
+    {
+        m.maxWrite = 3;
+        char                a[] = "ab", c[] = "cdef";
+        transceiver_iovec_t iov[] = { { a, 2 }, { c, 4 } };
+        REQUIRE( td_writev( m.handle(), iov, 2 ) == 5 );
+        REQUIRE( m.out == "abcde" );
+    }
+
+    SECTION( "Stacked decorators" )
+    {
+        buffered_transceiver_t b2;
+        char                   tx2[16];
+        auto                   h2 = buffered_transceiver_init(
+          &b2, h, tx2, sizeof tx2, NULL, 0, 0 );
+
+        std::string expect;
+        for ( int i = 0; i < 100; ++i ) {
+            char c = 'a' + i % 26;
+            expect += c;
+            REQUIRE( td_write( h2, &c, 1 ) == 1 );
+        }
+        td_ioctl( h2, TRANSCEIVER_IOCTL_FLUSH );
+        REQUIRE( m.out == expect );
+        REQUIRE( m.numWrite < 10 );
+    }
+}
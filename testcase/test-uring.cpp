@@ -0,0 +1,94 @@
+#include <Catch2/catch.hpp>
+#include <string>
+extern "C" {
+#include <uEmbedded/uring_transceiver.h>
+}
+
+#if URING_TRANSCEIVER_AVAILABLE
+#    include <cstdint>
+#    include <unistd.h>
+
+TEST_CASE( "io_uring transceiver over pipe", "[uring_transceiver]" )
+{
+    static char     qbuf[0x1000];
+    static char     pool[URING_POOL_SIZE( 8, 256 )];
+    EventQueue      queue;
+    uring_context_t ctx;
+
+    InitEventProcedure( &queue, qbuf, sizeof( qbuf ) );
+    REQUIRE(
+      uring_context_init( &ctx, &queue, 16, pool, sizeof( pool ), 256 )
+      == TRANSCEIVER_OK );
+    REQUIRE( ctx.numBufs == 8 );
+
+    int fds[2];
+    REQUIRE( pipe( fds ) == 0 );
+
+    struct counter
+    {
+        int read = 0, written = 0;
+    } cnt;
+    auto cb = []( void* o, transceiver_handle_t, uint32_t ev, int32_t res ) {
+        auto c = (counter*)o;
+        if ( ev == URING_EVENT_READ )
+            c->read += res;
+        if ( ev == URING_EVENT_WRITE )
+            c->written += res;
+    };
+
+    uring_transceiver_t rd, wr;
+    auto hr = uring_transceiver_open( &rd, &ctx, fds[0], cb, &cnt );
+    auto hw = uring_transceiver_open( &wr, &ctx, fds[1], NULL, NULL );
+    REQUIRE( ( hr && hw ) );
+
+    // Write end also keeps a read in flight, which fails immediately.
+    uring_context_poll( &ctx, 0 );
+
+    char msg[] = "hello, uring";
+    REQUIRE( td_write( hw, msg, 5 ) == 5 );
+    REQUIRE( td_write( hw, msg + 5, 7 ) == 7 );
+    REQUIRE( ctx.numPending == 2 );
+
+    // Both writes and the read complete by a few calls.
+    for ( int i = 0; i < 100 && cnt.read < 12; ++i ) {
+        uring_context_poll( &ctx, 1 );
+        FlushEvents( &queue );
+    }
+    REQUIRE( cnt.read > 0 );
+
+    std::string got;
+    char        buf[64];
+    for ( int i = 0; i < 100 && got.size() < 12; ++i ) {
+        char* p;
+        auto  n = td_loan( hr, &p );
+        if ( n > 0 ) {
+            got.append( p, n );
+            td_release( hr, n );
+        }
+        uring_context_poll( &ctx, got.size() < 12 );
+    }
+    REQUIRE( got == "hello, uring" );
+    REQUIRE( td_read( hr, buf, sizeof buf ) == 0 );
+
+    REQUIRE( td_close( hw ) == TRANSCEIVER_OK );
+    REQUIRE( td_close( hr ) == TRANSCEIVER_OK );
+    REQUIRE( ctx.numFree == ctx.numBufs );
+    uring_context_destroy( &ctx );
+}
+
+TEST_CASE( "io_uring buffer pool layout", "[uring_transceiver]" )
+{
+    static char     pool[URING_POOL_SIZE( 5, 100 ) + 1];
+    uring_context_t ctx;
+
+    // Odd buffer size on odd address still places bookkeeping aligned.
+    REQUIRE(
+      uring_context_init( &ctx, NULL, 4, pool + 1, sizeof( pool ) - 1, 100 )
+      == TRANSCEIVER_OK );
+    REQUIRE( ctx.numBufs == 5 );
+    REQUIRE( (uintptr_t)ctx.meta % URING_META_ALIGN == 0 );
+    REQUIRE( (char*)( ctx.meta + ctx.numBufs ) <= pool + sizeof( pool ) );
+    REQUIRE( (char*)ctx.meta >= pool + 1 + 5 * 100 );
+    uring_context_destroy( &ctx );
+}
+#endif